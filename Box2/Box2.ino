@@ -1,9 +1,12 @@
 #include "LEDStateMachine.h"
+#include "LEDCompiler.h"
+#include "LedRunner.h"
+#include "LedProfile.h"
 
 #define LED0 (5)
 #define LED1 (6)
 
-LEDStep g_LED0Steps[] = 
+constexpr LEDStep g_LED0Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 2,		20,  	20,  	0 ),
@@ -16,7 +19,7 @@ LEDStep g_LED0Steps[] =
   LEDStep(  eLastInGroup,  0,   100,  60,   0)
 };
 
-LEDStep g_LED1Steps[] = 
+constexpr LEDStep g_LED1Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 1,		200,  	60,  	00 ),
@@ -30,13 +33,17 @@ LEDStep g_LED1Steps[] =
 };
 
 LED g_LED0(LED0);
-LEDQueue g_LED0Queue((LEDStep *)g_LED0Steps, sizeof(g_LED0Steps)/sizeof(LEDStep));
+LEDQueue g_LED0Queue(LED_PROGRAM(g_LED0Steps));
 LedStateMachine g_LED0SM(g_LED0, g_LED0Queue);
 
 LED g_LED1(LED1);
-LEDQueue g_LED1Queue((LEDStep *)g_LED1Steps, sizeof(g_LED1Steps)/sizeof(LEDStep));
+LEDQueue g_LED1Queue(LED_PROGRAM(g_LED1Steps));
 LedStateMachine g_LED1SM(g_LED1, g_LED1Queue);
 
+LedStateMachine* const g_Machines[] = { &g_LED0SM, &g_LED1SM };
+TickScheduler g_Ticker(10000);
+LedRunner g_Runner(g_Machines, sizeof(g_Machines)/sizeof(g_Machines[0]), g_Ticker);
+
 void setup()
 {
 	Serial.begin(115200);
@@ -45,12 +52,22 @@ void setup()
 	pinMode(13, INPUT);
 	pinMode(LED0, OUTPUT);
 	pinMode(LED1, OUTPUT);
+
+	// sleep through the holds, unless loop() has the serial port to poll
+#if !defined(LEDSM_PROFILE) && !defined(LEDSM_TRACE)
+	g_Runner.setSleep(LedRunner::eSleepWatchdog);
+#endif
 }
 
 // the loop function runs over and over again forever
 void loop()
 {
-	g_LED0SM.updateState();
-	g_LED1SM.updateState();
-	delay(10);						// wait for a 1/10 second
+	// runs the due ticks, then sleeps until the next LED changes
+	g_Runner.service();
+
+	// prints the timing figures on a '?', only built with LEDSM_PROFILE
+	LEDSM_PROFILE_POLL(Serial);
+
+	// sends the event trace, only built with LEDSM_TRACE
+	LEDSM_TRACE_DRAIN(Serial);
 }
@@ -1,538 +1,38 @@
 #include "LEDStateMachine.h"
+#include "LEDCompiler.h"
+#include "LedRunner.h"
+#include "LedProfile.h"
 
 #define LED0 (5)
 #define LED1 (6)
 
-LEDStep g_LED0Steps[] = 
+// each LED fades through every level, a level at a time, one down and one up
+constexpr LEDStep g_LED0Steps[] PROGMEM = 
 {
-// 				Flags			Reps	Mag		Fade	Duration
-	LEDStep(	0,				 1,		255,  	65535,  	65535 ),
-	LEDStep(	eLastInGroup,	 0,		254,		65535,	65535 ),
-  LEDStep(  0,         1,   253,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   252,    65535,  65535 ),
-  LEDStep(  0,         1,   251,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   250,    65535,  65535 ),
-  LEDStep(  0,         1,   249,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   248,    65535,  65535 ),
-  LEDStep(  0,         1,   247,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   246,    65535,  65535 ),
-  LEDStep(  0,         1,   245,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   244,    65535,  65535 ),
-  LEDStep(  0,         1,   243,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   242,    65535,  65535 ),
-  LEDStep(  0,         1,   241,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   240,    65535,  65535 ),
-  LEDStep(  0,         1,   239,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   238,    65535,  65535 ),
-  LEDStep(  0,         1,   237,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   236,    65535,  65535 ),
-  LEDStep(  0,         1,   235,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   234,    65535,  65535 ),
-  LEDStep(  0,         1,   233,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   232,    65535,  65535 ),
-  LEDStep(  0,         1,   231,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   230,    65535,  65535 ),
-  LEDStep(  0,         1,   229,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   228,    65535,  65535 ),
-  LEDStep(  0,         1,   227,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   226,    65535,  65535 ),
-  LEDStep(  0,         1,   225,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   224,    65535,  65535 ),
-  LEDStep(  0,         1,   223,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   222,    65535,  65535 ),
-  LEDStep(  0,         1,   221,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   220,    65535,  65535 ),
-  LEDStep(  0,         1,   219,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   218,    65535,  65535 ),
-  LEDStep(  0,         1,   217,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   216,    65535,  65535 ),
-  LEDStep(  0,         1,   215,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   214,    65535,  65535 ),
-  LEDStep(  0,         1,   213,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   212,    65535,  65535 ),
-  LEDStep(  0,         1,   211,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   210,    65535,  65535 ),
-  LEDStep(  0,         1,   209,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   208,    65535,  65535 ),
-  LEDStep(  0,         1,   207,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   206,    65535,  65535 ),
-  LEDStep(  0,         1,   205,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   204,    65535,  65535 ),
-  LEDStep(  0,         1,   203,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   202,    65535,  65535 ),
-  LEDStep(  0,         1,   201,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   200,    65535,  65535 ),
-  LEDStep(  0,         1,   199,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   198,    65535,  65535 ),
-  LEDStep(  0,         1,   197,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   196,    65535,  65535 ),
-  LEDStep(  0,         1,   195,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   194,    65535,  65535 ),
-  LEDStep(  0,         1,   193,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   192,    65535,  65535 ),
-  LEDStep(  0,         1,   191,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   190,    65535,  65535 ),
-  LEDStep(  0,         1,   189,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   188,    65535,  65535 ),
-  LEDStep(  0,         1,   187,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   186,    65535,  65535 ),
-  LEDStep(  0,         1,   185,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   184,    65535,  65535 ),
-  LEDStep(  0,         1,   183,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   182,    65535,  65535 ),
-  LEDStep(  0,         1,   181,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   180,    65535,  65535 ),
-  LEDStep(  0,         1,   179,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   178,    65535,  65535 ),
-  LEDStep(  0,         1,   177,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   176,    65535,  65535 ),
-  LEDStep(  0,         1,   175,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   174,    65535,  65535 ),
-  LEDStep(  0,         1,   173,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   172,    65535,  65535 ),
-  LEDStep(  0,         1,   171,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   170,    65535,  65535 ),
-  LEDStep(  0,         1,   169,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   168,    65535,  65535 ),
-  LEDStep(  0,         1,   167,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   166,    65535,  65535 ),
-  LEDStep(  0,         1,   165,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   164,    65535,  65535 ),
-  LEDStep(  0,         1,   163,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   162,    65535,  65535 ),
-  LEDStep(  0,         1,   161,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   160,    65535,  65535 ),
-  LEDStep(  0,         1,   159,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   158,    65535,  65535 ),
-  LEDStep(  0,         1,   157,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   156,    65535,  65535 ),
-  LEDStep(  0,         1,   155,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   154,    65535,  65535 ),
-  LEDStep(  0,         1,   153,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   152,    65535,  65535 ),
-  LEDStep(  0,         1,   151,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   150,    65535,  65535 ),
-  LEDStep(  0,         1,   149,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   148,    65535,  65535 ),
-  LEDStep(  0,         1,   147,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   146,    65535,  65535 ),
-  LEDStep(  0,         1,   145,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   144,    65535,  65535 ),
-  LEDStep(  0,         1,   143,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   142,    65535,  65535 ),
-  LEDStep(  0,         1,   141,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   140,    65535,  65535 ),
-  LEDStep(  0,         1,   139,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   138,    65535,  65535 ),
-  LEDStep(  0,         1,   137,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   136,    65535,  65535 ),
-  LEDStep(  0,         1,   135,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   134,    65535,  65535 ),
-  LEDStep(  0,         1,   133,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   132,    65535,  65535 ),
-  LEDStep(  0,         1,   131,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   130,    65535,  65535 ),
-  LEDStep(  0,         1,   129,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   128,    65535,  65535 ),
-  LEDStep(  0,         1,   127,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   126,    65535,  65535 ),
-  LEDStep(  0,         1,   125,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   124,    65535,  65535 ),
-  LEDStep(  0,         1,   123,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   122,    65535,  65535 ),
-  LEDStep(  0,         1,   121,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   120,    65535,  65535 ),
-  LEDStep(  0,         1,   119,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   118,    65535,  65535 ),
-  LEDStep(  0,         1,   117,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   116,    65535,  65535 ),
-  LEDStep(  0,         1,   115,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   114,    65535,  65535 ),
-  LEDStep(  0,         1,   113,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   112,    65535,  65535 ),
-  LEDStep(  0,         1,   111,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   110,    65535,  65535 ),
-  LEDStep(  0,         1,   109,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   108,    65535,  65535 ),
-  LEDStep(  0,         1,   107,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   106,    65535,  65535 ),
-  LEDStep(  0,         1,   105,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   104,    65535,  65535 ),
-  LEDStep(  0,         1,   103,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   102,    65535,  65535 ),
-  LEDStep(  0,         1,   101,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   100,    65535,  65535 ),
-  LEDStep(  0,         1,   99,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   98,    65535,  65535 ),
-  LEDStep(  0,         1,   97,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   96,    65535,  65535 ),
-  LEDStep(  0,         1,   95,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   94,    65535,  65535 ),
-  LEDStep(  0,         1,   93,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   92,    65535,  65535 ),
-  LEDStep(  0,         1,   91,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   90,    65535,  65535 ),
-  LEDStep(  0,         1,   89,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   88,    65535,  65535 ),
-  LEDStep(  0,         1,   87,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   86,    65535,  65535 ),
-  LEDStep(  0,         1,   85,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   84,    65535,  65535 ),
-  LEDStep(  0,         1,   83,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   82,    65535,  65535 ),
-  LEDStep(  0,         1,   81,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   80,    65535,  65535 ),
-  LEDStep(  0,         1,   79,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   78,    65535,  65535 ),
-  LEDStep(  0,         1,   77,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   76,    65535,  65535 ),
-  LEDStep(  0,         1,   75,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   74,    65535,  65535 ),
-  LEDStep(  0,         1,   73,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   72,    65535,  65535 ),
-  LEDStep(  0,         1,   71,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   70,    65535,  65535 ),
-  LEDStep(  0,         1,   69,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   68,    65535,  65535 ),
-  LEDStep(  0,         1,   67,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   66,    65535,  65535 ),
-  LEDStep(  0,         1,   65,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   64,    65535,  65535 ),
-  LEDStep(  0,         1,   63,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   62,    65535,  65535 ),
-  LEDStep(  0,         1,   61,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   60,    65535,  65535 ),
-  LEDStep(  0,         1,   59,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   58,    65535,  65535 ),
-  LEDStep(  0,         1,   57,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   56,    65535,  65535 ),
-  LEDStep(  0,         1,   55,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   54,    65535,  65535 ),
-  LEDStep(  0,         1,   53,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   52,    65535,  65535 ),
-  LEDStep(  0,         1,   51,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   50,    65535,  65535 ),
-  LEDStep(  0,         1,   49,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   48,    65535,  65535 ),
-  LEDStep(  0,         1,   47,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   46,    65535,  65535 ),
-  LEDStep(  0,         1,   45,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   44,    65535,  65535 ),
-  LEDStep(  0,         1,   43,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   42,    65535,  65535 ),
-  LEDStep(  0,         1,   41,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   40,    65535,  65535 ),
-  LEDStep(  0,         1,   39,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   38,    65535,  65535 ),
-  LEDStep(  0,         1,   37,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   36,    65535,  65535 ),
-  LEDStep(  0,         1,   35,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   34,    65535,  65535 ),
-  LEDStep(  0,         1,   33,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   32,    65535,  65535 ),
-  LEDStep(  0,         1,   31,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   30,    65535,  65535 ),
-  LEDStep(  0,         1,   29,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   28,    65535,  65535 ),
-  LEDStep(  0,         1,   27,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   26,    65535,  65535 ),
-  LEDStep(  0,         1,   25,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   24,    65535,  65535 ),
-  LEDStep(  0,         1,   23,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   22,    65535,  65535 ),
-  LEDStep(  0,         1,   21,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   20,    65535,  65535 ),
-  LEDStep(  0,         1,   19,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   18,    65535,  65535 ),
-  LEDStep(  0,         1,   17,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   16,    65535,  65535 ),
-  LEDStep(  0,         1,   15,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   14,    65535,  65535 ),
-  LEDStep(  0,         1,   13,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   12,    65535,  65535 ),
-  LEDStep(  0,         1,   11,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   10,    65535,  65535 ),
-  LEDStep(  0,         1,   9,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   8,    65535,  65535 ),
-  LEDStep(  0,         1,   7,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   6,    65535,  65535 ),
-  LEDStep(  0,         1,   5,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   4,    65535,  65535 ),
-  LEDStep(  0,         1,   3,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   2,    65535,  65535 ),
-  LEDStep(  0,         1,   1,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   0,    65535,  65535 )
+// 				Flags					Reps	Mag		Fade	Duration
+	LEDStep(	0,						 1,		255,	65535,	65535 ),
+	LEDStep(	eLastInGroup | eSweep | 1,	 0,		0,		65535,	65535 ),
 };
 
-LEDStep g_LED1Steps[] = 
+constexpr LEDStep g_LED1Steps[] PROGMEM = 
 {
-// 				Flags			Reps	Mag		Fade	Duration
-  LEDStep(  0,         1,   0,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   1,    65535,  65535 ),
-  LEDStep(  0,         1,   2,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   3,    65535,  65535 ),
-  LEDStep(  0,         1,   4,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   5,    65535,  65535 ),
-  LEDStep(  0,         1,   6,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   7,    65535,  65535 ),
-  LEDStep(  0,         1,   8,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   9,    65535,  65535 ),
-  LEDStep(  0,         1,   10,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   11,    65535,  65535 ),
-  LEDStep(  0,         1,   12,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   13,    65535,  65535 ),
-  LEDStep(  0,         1,   14,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   15,    65535,  65535 ),
-  LEDStep(  0,         1,   16,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   17,    65535,  65535 ),
-  LEDStep(  0,         1,   18,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   19,    65535,  65535 ),
-  LEDStep(  0,         1,   20,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   21,    65535,  65535 ),
-  LEDStep(  0,         1,   22,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   23,    65535,  65535 ),
-  LEDStep(  0,         1,   24,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   25,    65535,  65535 ),
-  LEDStep(  0,         1,   26,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   27,    65535,  65535 ),
-  LEDStep(  0,         1,   28,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   29,    65535,  65535 ),
-  LEDStep(  0,         1,   30,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   31,    65535,  65535 ),
-  LEDStep(  0,         1,   32,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   33,    65535,  65535 ),
-  LEDStep(  0,         1,   34,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   35,    65535,  65535 ),
-  LEDStep(  0,         1,   36,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   37,    65535,  65535 ),
-  LEDStep(  0,         1,   38,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   39,    65535,  65535 ),
-  LEDStep(  0,         1,   40,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   41,    65535,  65535 ),
-  LEDStep(  0,         1,   42,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   43,    65535,  65535 ),
-  LEDStep(  0,         1,   44,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   45,    65535,  65535 ),
-  LEDStep(  0,         1,   46,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   47,    65535,  65535 ),
-  LEDStep(  0,         1,   48,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   49,    65535,  65535 ),
-  LEDStep(  0,         1,   50,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   51,    65535,  65535 ),
-  LEDStep(  0,         1,   52,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   53,    65535,  65535 ),
-  LEDStep(  0,         1,   54,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   55,    65535,  65535 ),
-  LEDStep(  0,         1,   56,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   57,    65535,  65535 ),
-  LEDStep(  0,         1,   58,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   59,    65535,  65535 ),
-  LEDStep(  0,         1,   60,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   61,    65535,  65535 ),
-  LEDStep(  0,         1,   62,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   63,    65535,  65535 ),
-  LEDStep(  0,         1,   64,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   65,    65535,  65535 ),
-  LEDStep(  0,         1,   66,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   67,    65535,  65535 ),
-  LEDStep(  0,         1,   68,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   69,    65535,  65535 ),
-  LEDStep(  0,         1,   70,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   71,    65535,  65535 ),
-  LEDStep(  0,         1,   72,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   73,    65535,  65535 ),
-  LEDStep(  0,         1,   74,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   75,    65535,  65535 ),
-  LEDStep(  0,         1,   76,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   77,    65535,  65535 ),
-  LEDStep(  0,         1,   78,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   79,    65535,  65535 ),
-  LEDStep(  0,         1,   80,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   81,    65535,  65535 ),
-  LEDStep(  0,         1,   82,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   83,    65535,  65535 ),
-  LEDStep(  0,         1,   84,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   85,    65535,  65535 ),
-  LEDStep(  0,         1,   86,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   87,    65535,  65535 ),
-  LEDStep(  0,         1,   88,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   89,    65535,  65535 ),
-  LEDStep(  0,         1,   90,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   91,    65535,  65535 ),
-  LEDStep(  0,         1,   92,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   93,    65535,  65535 ),
-  LEDStep(  0,         1,   94,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   95,    65535,  65535 ),
-  LEDStep(  0,         1,   96,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   97,    65535,  65535 ),
-  LEDStep(  0,         1,   98,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   99,    65535,  65535 ),
-  LEDStep(  0,         1,   100,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   101,    65535,  65535 ),
-  LEDStep(  0,         1,   102,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   103,    65535,  65535 ),
-  LEDStep(  0,         1,   104,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   105,    65535,  65535 ),
-  LEDStep(  0,         1,   106,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   107,    65535,  65535 ),
-  LEDStep(  0,         1,   108,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   109,    65535,  65535 ),
-  LEDStep(  0,         1,   110,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   111,    65535,  65535 ),
-  LEDStep(  0,         1,   112,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   113,    65535,  65535 ),
-  LEDStep(  0,         1,   114,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   115,    65535,  65535 ),
-  LEDStep(  0,         1,   116,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   117,    65535,  65535 ),
-  LEDStep(  0,         1,   118,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   119,    65535,  65535 ),
-  LEDStep(  0,         1,   120,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   121,    65535,  65535 ),
-  LEDStep(  0,         1,   122,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   123,    65535,  65535 ),
-  LEDStep(  0,         1,   124,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   125,    65535,  65535 ),
-  LEDStep(  0,         1,   126,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   127,    65535,  65535 ),
-  LEDStep(  0,         1,   128,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   129,    65535,  65535 ),
-  LEDStep(  0,         1,   130,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   131,    65535,  65535 ),
-  LEDStep(  0,         1,   132,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   133,    65535,  65535 ),
-  LEDStep(  0,         1,   134,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   135,    65535,  65535 ),
-  LEDStep(  0,         1,   136,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   137,    65535,  65535 ),
-  LEDStep(  0,         1,   138,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   139,    65535,  65535 ),
-  LEDStep(  0,         1,   140,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   141,    65535,  65535 ),
-  LEDStep(  0,         1,   142,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   143,    65535,  65535 ),
-  LEDStep(  0,         1,   144,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   145,    65535,  65535 ),
-  LEDStep(  0,         1,   146,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   147,    65535,  65535 ),
-  LEDStep(  0,         1,   148,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   149,    65535,  65535 ),
-  LEDStep(  0,         1,   150,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   151,    65535,  65535 ),
-  LEDStep(  0,         1,   152,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   153,    65535,  65535 ),
-  LEDStep(  0,         1,   154,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   155,    65535,  65535 ),
-  LEDStep(  0,         1,   156,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   157,    65535,  65535 ),
-  LEDStep(  0,         1,   158,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   159,    65535,  65535 ),
-  LEDStep(  0,         1,   160,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   161,    65535,  65535 ),
-  LEDStep(  0,         1,   162,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   163,    65535,  65535 ),
-  LEDStep(  0,         1,   164,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   165,    65535,  65535 ),
-  LEDStep(  0,         1,   166,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   167,    65535,  65535 ),
-  LEDStep(  0,         1,   168,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   169,    65535,  65535 ),
-  LEDStep(  0,         1,   170,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   171,    65535,  65535 ),
-  LEDStep(  0,         1,   172,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   173,    65535,  65535 ),
-  LEDStep(  0,         1,   174,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   175,    65535,  65535 ),
-  LEDStep(  0,         1,   176,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   177,    65535,  65535 ),
-  LEDStep(  0,         1,   178,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   179,    65535,  65535 ),
-  LEDStep(  0,         1,   180,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   181,    65535,  65535 ),
-  LEDStep(  0,         1,   182,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   183,    65535,  65535 ),
-  LEDStep(  0,         1,   184,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   185,    65535,  65535 ),
-  LEDStep(  0,         1,   186,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   187,    65535,  65535 ),
-  LEDStep(  0,         1,   188,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   189,    65535,  65535 ),
-  LEDStep(  0,         1,   190,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   191,    65535,  65535 ),
-  LEDStep(  0,         1,   192,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   193,    65535,  65535 ),
-  LEDStep(  0,         1,   194,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   195,    65535,  65535 ),
-  LEDStep(  0,         1,   196,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   197,    65535,  65535 ),
-  LEDStep(  0,         1,   198,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   199,    65535,  65535 ),
-  LEDStep(  0,         1,   200,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   201,    65535,  65535 ),
-  LEDStep(  0,         1,   202,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   203,    65535,  65535 ),
-  LEDStep(  0,         1,   204,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   205,    65535,  65535 ),
-  LEDStep(  0,         1,   206,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   207,    65535,  65535 ),
-  LEDStep(  0,         1,   208,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   209,    65535,  65535 ),
-  LEDStep(  0,         1,   210,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   211,    65535,  65535 ),
-  LEDStep(  0,         1,   212,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   213,    65535,  65535 ),
-  LEDStep(  0,         1,   214,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   215,    65535,  65535 ),
-  LEDStep(  0,         1,   216,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   217,    65535,  65535 ),
-  LEDStep(  0,         1,   218,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   219,    65535,  65535 ),
-  LEDStep(  0,         1,   220,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   221,    65535,  65535 ),
-  LEDStep(  0,         1,   222,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   223,    65535,  65535 ),
-  LEDStep(  0,         1,   224,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   225,    65535,  65535 ),
-  LEDStep(  0,         1,   226,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   227,    65535,  65535 ),
-  LEDStep(  0,         1,   228,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   229,    65535,  65535 ),
-  LEDStep(  0,         1,   230,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   231,    65535,  65535 ),
-  LEDStep(  0,         1,   232,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   233,    65535,  65535 ),
-  LEDStep(  0,         1,   234,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   235,    65535,  65535 ),
-  LEDStep(  0,         1,   236,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   237,    65535,  65535 ),
-  LEDStep(  0,         1,   238,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   239,    65535,  65535 ),
-  LEDStep(  0,         1,   240,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   241,    65535,  65535 ),
-  LEDStep(  0,         1,   242,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   243,    65535,  65535 ),
-  LEDStep(  0,         1,   244,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   245,    65535,  65535 ),
-  LEDStep(  0,         1,   246,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   247,    65535,  65535 ),
-  LEDStep(  0,         1,   248,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   249,    65535,  65535 ),
-  LEDStep(  0,         1,   250,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   251,    65535,  65535 ),
-  LEDStep(  0,         1,   252,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   253,    65535,  65535 ),
-  LEDStep(  0,         1,   254,    65535,    65535 ),
-  LEDStep(  eLastInGroup,  0,   255,    65535,  65535 )
+// 				Flags					Reps	Mag		Fade	Duration
+	LEDStep(	0,						 1,		0,		65535,	65535 ),
+	LEDStep(	eLastInGroup | eSweep | 1,	 0,		255,	65535,	65535 ),
 };
 
 LED g_LED0(LED0);
-LEDQueue g_LED0Queue((LEDStep *)g_LED0Steps, sizeof(g_LED0Steps)/sizeof(LEDStep));
+LEDQueue g_LED0Queue(LED_PROGRAM(g_LED0Steps));
 LedStateMachine g_LED0SM(g_LED0, g_LED0Queue);
 
 LED g_LED1(LED1);
-LEDQueue g_LED1Queue((LEDStep *)g_LED1Steps, sizeof(g_LED1Steps)/sizeof(LEDStep));
+LEDQueue g_LED1Queue(LED_PROGRAM(g_LED1Steps));
 LedStateMachine g_LED1SM(g_LED1, g_LED1Queue);
 
+LedStateMachine* const g_Machines[] = { &g_LED0SM, &g_LED1SM };
+TickScheduler g_Ticker(10000);
+LedRunner g_Runner(g_Machines, sizeof(g_Machines)/sizeof(g_Machines[0]), g_Ticker);
+
 void setup()
 {
 	Serial.begin(115200);
@@ -541,12 +41,22 @@ void setup()
 	pinMode(13, INPUT);
 	pinMode(LED0, OUTPUT);
 	pinMode(LED1, OUTPUT);
+
+	// sleep through the holds, unless loop() has the serial port to poll
+#if !defined(LEDSM_PROFILE) && !defined(LEDSM_TRACE)
+	g_Runner.setSleep(LedRunner::eSleepWatchdog);
+#endif
 }
 
 // the loop function runs over and over again forever
 void loop()
 {
-	g_LED0SM.updateState();
-	g_LED1SM.updateState();
-	delay(10);						// wait for a 1/10 second
+	// runs the due ticks, then sleeps until the next LED changes
+	g_Runner.service();
+
+	// prints the timing figures on a '?', only built with LEDSM_PROFILE
+	LEDSM_PROFILE_POLL(Serial);
+
+	// sends the event trace, only built with LEDSM_TRACE
+	LEDSM_TRACE_DRAIN(Serial);
 }
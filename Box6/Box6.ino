@@ -1,4 +1,7 @@
 #include "LEDStateMachine.h"
+#include "LEDCompiler.h"
+#include "LedRunner.h"
+#include "LedProfile.h"
 
 #define LED0 (5)
 #define LED1 (6)
@@ -6,7 +9,7 @@
 #define LED3 (10)
 #define LED4 (11)
 
-LEDStep g_LED0Steps[] = 
+constexpr LEDStep g_LED0Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 1,		0,  	0,  200 ),
@@ -17,7 +20,7 @@ LEDStep g_LED0Steps[] =
   LEDStep(  eLastInGroup,  0,   255,    0,  50 )
 };
 
-LEDStep g_LED1Steps[] = 
+constexpr LEDStep g_LED1Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 1,		255,  	0,  	50 ),
@@ -28,7 +31,7 @@ LEDStep g_LED1Steps[] =
   LEDStep(  eLastInGroup,  0,   0,    0,  20 )
 };
 
-LEDStep g_LED2Steps[] = 
+constexpr LEDStep g_LED2Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 1,		0,  	0,  	50 ),
@@ -40,7 +43,7 @@ LEDStep g_LED2Steps[] =
   LEDStep(  eLastInGroup,  0,   0,    0,  10 )
 };
 
-LEDStep g_LED3Steps[] = 
+constexpr LEDStep g_LED3Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(  0,         1,   0,    0,    100 ),
@@ -52,7 +55,7 @@ LEDStep g_LED3Steps[] =
   LEDStep(  eLastInGroup,  0,   0,    0,  30 )
 };
 
-LEDStep g_LED4Steps[] = 
+constexpr LEDStep g_LED4Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
   LEDStep(  0,         1,   0,    0,    150 ),
@@ -65,25 +68,29 @@ LEDStep g_LED4Steps[] =
 };
 
 LED g_LED0(LED0);
-LEDQueue g_LED0Queue((LEDStep *)g_LED0Steps, sizeof(g_LED0Steps)/sizeof(LEDStep));
+LEDQueue g_LED0Queue(LED_PROGRAM(g_LED0Steps));
 LedStateMachine g_LED0SM(g_LED0, g_LED0Queue);
 
 LED g_LED1(LED1);
-LEDQueue g_LED1Queue((LEDStep *)g_LED1Steps, sizeof(g_LED1Steps)/sizeof(LEDStep));
+LEDQueue g_LED1Queue(LED_PROGRAM(g_LED1Steps));
 LedStateMachine g_LED1SM(g_LED1, g_LED1Queue);
 
 LED g_LED2(LED2);
-LEDQueue g_LED2Queue((LEDStep *)g_LED2Steps, sizeof(g_LED2Steps)/sizeof(LEDStep));
+LEDQueue g_LED2Queue(LED_PROGRAM(g_LED2Steps));
 LedStateMachine g_LED2SM(g_LED2, g_LED2Queue);
 
 LED g_LED3(LED3);
-LEDQueue g_LED3Queue((LEDStep *)g_LED3Steps, sizeof(g_LED3Steps)/sizeof(LEDStep));
+LEDQueue g_LED3Queue(LED_PROGRAM(g_LED3Steps));
 LedStateMachine g_LED3SM(g_LED3, g_LED3Queue);
 
 LED g_LED4(LED4);
-LEDQueue g_LED4Queue((LEDStep *)g_LED4Steps, sizeof(g_LED4Steps)/sizeof(LEDStep));
+LEDQueue g_LED4Queue(LED_PROGRAM(g_LED4Steps));
 LedStateMachine g_LED4SM(g_LED4, g_LED4Queue);
 
+LedStateMachine* const g_Machines[] = { &g_LED0SM, &g_LED1SM, &g_LED2SM, &g_LED3SM, &g_LED4SM };
+TickScheduler g_Ticker(10000);
+LedRunner g_Runner(g_Machines, sizeof(g_Machines)/sizeof(g_Machines[0]), g_Ticker);
+
 void setup()
 {
 	Serial.begin(115200);
@@ -95,15 +102,22 @@ void setup()
 	pinMode(LED2, OUTPUT);
 	pinMode(LED3, OUTPUT);
 	pinMode(LED4, OUTPUT);
+
+	// sleep through the holds, unless loop() has the serial port to poll
+#if !defined(LEDSM_PROFILE) && !defined(LEDSM_TRACE)
+	g_Runner.setSleep(LedRunner::eSleepWatchdog);
+#endif
 }
 
 // the loop function runs over and over again forever
 void loop()
 {
-	g_LED0SM.updateState();
-	g_LED1SM.updateState();
-	g_LED2SM.updateState();
-	g_LED3SM.updateState();
-	g_LED4SM.updateState();
-	delay(10);						// wait for a 1/10 second
+	// runs the due ticks, then sleeps until the next LED changes
+	g_Runner.service();
+
+	// prints the timing figures on a '?', only built with LEDSM_PROFILE
+	LEDSM_PROFILE_POLL(Serial);
+
+	// sends the event trace, only built with LEDSM_TRACE
+	LEDSM_TRACE_DRAIN(Serial);
 }
@@ -1,4 +1,7 @@
 #include "LEDStateMachine.h"
+#include "LEDCompiler.h"
+#include "LedRunner.h"
+#include "LedProfile.h"
 
 #define LED0 (5)
 #define LED1 (6)
@@ -8,7 +11,7 @@
 #define LED5 (11)
 
 LED g_LED1(LED1);
-LEDStep g_LED1Steps[] = 
+constexpr LEDStep g_LED1Steps[] PROGMEM = 
 {
 // 				Flags			Reps	Mag		Fade	Duration
 	LEDStep(	0,				 4,		255,  	80,  	100 ),
@@ -17,10 +20,14 @@ LEDStep g_LED1Steps[] =
 	LEDStep(	eLastInGroup,	 0,		22,		80,		100 )
 };
 
-LEDQueue g_LED1Queue((LEDStep *)g_LED1Steps, sizeof(g_LED1Steps)/sizeof(LEDStep));
+LEDQueue g_LED1Queue(LED_PROGRAM(g_LED1Steps));
 
 LedStateMachine g_LED1SM(g_LED1, g_LED1Queue);
 
+LedStateMachine* const g_Machines[] = { &g_LED1SM };
+TickScheduler g_Ticker(10000);
+LedRunner g_Runner(g_Machines, sizeof(g_Machines)/sizeof(g_Machines[0]), g_Ticker);
+
 void setup()
 {
 	Serial.begin(115200);
@@ -28,11 +35,22 @@ void setup()
 	// initialize digital pin LED_BUILTIN as an output.
 	pinMode(13, INPUT);
 	pinMode(LED1, OUTPUT);
+
+	// sleep through the holds, unless loop() has the serial port to poll
+#if !defined(LEDSM_PROFILE) && !defined(LEDSM_TRACE)
+	g_Runner.setSleep(LedRunner::eSleepWatchdog);
+#endif
 }
 
 // the loop function runs over and over again forever
 void loop()
 {
-	g_LED1SM.updateState();
-	delay(10);						// wait for a 1/10 second
+	// runs the due ticks, then sleeps until the next LED changes
+	g_Runner.service();
+
+	// prints the timing figures on a '?', only built with LEDSM_PROFILE
+	LEDSM_PROFILE_POLL(Serial);
+
+	// sends the event trace, only built with LEDSM_TRACE
+	LEDSM_TRACE_DRAIN(Serial);
 }
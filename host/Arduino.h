@@ -0,0 +1,162 @@
+/**
+* @file Arduino.h
+* @brief host stand-in for the parts of the Arduino core the LED library uses
+*
+* This lets libraries/LEDStateMachine and the Box sketches build with the
+* native compiler. Time is simulated: millis()/micros() only move when
+* delay() or hostAdvanceMicros() is called, so host runs are repeatable.
+* Timer 0 keeps the core's millis()/micros() clock from its overflow
+* interrupt, every 1024 us, as on the part. Timer 1 overflows every
+* 2040 us of simulated time, and runs TIMER1_OVF_vect if its interrupt
+* is enabled (see avr/interrupt.h); the watchdog runs WDT_vect.
+*/
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+
+// flash access collapses to plain memory on the host
+#define PROGMEM
+#define PGM_P				const char*
+#define memcpy_P			memcpy
+#define pgm_read_byte(p)	(*(const uint8_t*)(p))
+#define pgm_read_word(p)	(*(const uint16_t*)(p))
+#define pgm_read_dword(p)	(*(const uint32_t*)(p))
+#define F(s)				(s)
+
+#define INPUT				0x0
+#define OUTPUT				0x1
+#define LOW					0x0
+#define HIGH				0x1
+
+#define DEC					10
+#define HEX					16
+
+#define HOST_NUM_PINS		20
+
+#ifndef F_CPU
+#define F_CPU				16000000UL
+#endif
+
+typedef uint8_t byte;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long a_Ms);
+void delayMicroseconds(unsigned int a_Us);
+void pinMode(uint8_t a_Pin, uint8_t a_Mode);
+void digitalWrite(uint8_t a_Pin, uint8_t a_Value);
+void analogWrite(uint8_t a_Pin, int a_Value);
+
+/**
+* Host only - move the simulated clock forward
+*
+* @param a_Us - number of microseconds to advance
+*/
+void hostAdvanceMicros(unsigned long a_Us);
+
+/**
+* Host only - the simulated time, which micros() should agree with
+*
+* @return - microseconds since power up
+*/
+unsigned long hostMicros(void);
+
+// last value written to each pin with analogWrite/digitalWrite
+extern uint8_t g_HostPinValues[HOST_NUM_PINS];
+// number of analogWrite calls made
+extern unsigned long g_HostAnalogWrites;
+
+/**
+* The Print class mirrors the Arduino one, everything funnels into write()
+*/
+class Print
+{
+public:
+	virtual ~Print(void) {}
+	virtual size_t write(uint8_t a_Byte) = 0;
+	size_t write(const uint8_t* a_Buffer, size_t a_Size);
+	virtual int availableForWrite(void) { return 0; }
+
+	size_t print(const char* a_String);
+	size_t print(char a_Char);
+	size_t print(int a_Value, int a_Base = DEC);
+	size_t print(unsigned int a_Value, int a_Base = DEC);
+	size_t print(long a_Value, int a_Base = DEC);
+	size_t print(unsigned long a_Value, int a_Base = DEC);
+	size_t println(void);
+	size_t println(const char* a_String);
+	size_t println(char a_Char);
+	size_t println(int a_Value, int a_Base = DEC);
+	size_t println(unsigned int a_Value, int a_Base = DEC);
+	size_t println(long a_Value, int a_Base = DEC);
+	size_t println(unsigned long a_Value, int a_Base = DEC);
+
+protected:
+	size_t printNumber(unsigned long a_Value, int a_Base);
+};
+
+/**
+* The Stream class adds the receive side
+*/
+class Stream : public Print
+{
+public:
+	virtual int available(void) = 0;
+	virtual int read(void) = 0;
+	virtual int peek(void) = 0;
+};
+
+/**
+* Pseudo serial port. Transmitted bytes are kept in a buffer that host
+* code can inspect, received bytes are whatever host code injects.
+*/
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial(void);
+
+	void begin(unsigned long a_Baud)	{ m_Baud = a_Baud; }
+	void end(void)						{}
+
+	virtual size_t write(uint8_t a_Byte);
+	using Print::write;
+	virtual int availableForWrite(void);
+	virtual int available(void);
+	virtual int read(void);
+	virtual int peek(void);
+	void flush(void)					{}
+
+	/**
+	* Host only - queue bytes as if they arrived on the RX pin
+	*
+	* @return the number of bytes that fit in the receive buffer
+	*/
+	size_t hostInject(const uint8_t* a_Buffer, size_t a_Size);
+
+	/**
+	* Host only - take bytes that were transmitted
+	*
+	* @return the number of bytes copied into a_Buffer
+	*/
+	size_t hostDrain(uint8_t* a_Buffer, size_t a_Size);
+
+	// same ring size the AVR core uses
+	static const int m_BufferSize = 64;
+
+protected:
+	unsigned long m_Baud;
+	uint8_t m_Rx[m_BufferSize];
+	int m_RxHead;
+	int m_RxTail;
+	uint8_t m_Tx[m_BufferSize];
+	int m_TxHead;
+	int m_TxTail;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,445 @@
+/**
+* @file arduino_shim.cpp
+* @brief implements the host stand-in for the Arduino core
+*/
+#include "Arduino.h"
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// timer 1 overflow period with the Arduino core's setup, see LedTimer.h
+static const unsigned long s_Timer1Us = 510UL * 64 / (F_CPU / 1000000UL);
+// timer 0 overflow period, the core runs it at clock / 64
+static const unsigned long s_Timer0Us = 256UL * 64 / (F_CPU / 1000000UL);
+// the watchdog's shortest period, 16 ms nominal; the oscillator of a
+// real part is a few percent off and the library must not count on it
+static const unsigned long s_WdtUs = 16900;
+
+static unsigned long s_Micros = 0;
+static unsigned long s_Timer0Overflows = 0;	// overflows already counted or flagged
+static uint8_t s_Timer0Fract = 0;
+static unsigned long s_WdtStart = 0;
+static bool s_Timer1Pending = false;
+
+// only there when something registers the interrupt
+extern "C" void TIMER1_OVF_vect(void) __attribute__((weak));
+extern "C" void WDT_vect(void) __attribute__((weak));
+
+/**
+* The Arduino core's init() enables the timer 0 overflow interrupt and
+* turns interrupts on before setup()
+*/
+static struct HostPowerOn
+{
+	HostPowerOn(void) { TIMSK0 = _BV(TOIE0); SREG = _BV(SREG_I); }
+} s_PowerOn;
+
+volatile uint8_t g_HostIo[HOST_IO_SIZE];
+uint8_t g_HostPinValues[HOST_NUM_PINS];
+unsigned long g_HostAnalogWrites = 0;
+unsigned long g_HostSleeps = 0;
+
+// the Arduino core's millis() clock, kept by the timer 0 overflow
+extern "C"
+{
+volatile unsigned long timer0_overflow_count = 0;
+volatile unsigned long timer0_millis = 0;
+}
+
+HardwareSerial Serial;
+
+unsigned long millis(void)
+{
+	return timer0_millis;
+}
+
+/**
+* The Arduino core's micros(), overflows counted and the timer 0 count
+*
+* @note - the core's only moves in 4 us steps, the host adds back the
+*  microseconds it drops so host runs can time things finer
+*/
+unsigned long micros(void)
+{
+	unsigned long l_Overflows = timer0_overflow_count;
+	uint8_t l_Count = TCNT0;
+
+	if ((TIFR0 & _BV(TOV0)) && l_Count < 255)
+		l_Overflows++;
+	return ((l_Overflows << 8) + l_Count) * (s_Timer0Us / 256) + s_Micros % (s_Timer0Us / 256);
+}
+
+unsigned long hostMicros(void)
+{
+	return s_Micros;
+}
+
+/**
+* The Arduino core's timer 0 overflow interrupt
+*/
+static void timer0Overflow(void)
+{
+	timer0_millis += 1;
+	s_Timer0Fract += 3;
+	if (s_Timer0Fract >= 125)
+	{
+		s_Timer0Fract -= 125;
+		timer0_millis += 1;
+	}
+	timer0_overflow_count++;
+}
+
+/**
+* Bring timer 0 up to the clock. Each overflow since the last call runs
+* the core's interrupt if it is enabled, or sets TOV0 if it is not.
+*
+* @note - the overflows are counted even with interrupts off, nothing on
+*  the host holds them off for a millisecond
+*/
+static void runTimer0(void)
+{
+	unsigned long l_Overflows = s_Micros / s_Timer0Us;
+
+	TCNT0 = (uint8_t)(s_Micros / (s_Timer0Us / 256));
+	for (; s_Timer0Overflows != l_Overflows; s_Timer0Overflows++)
+	{
+		if (TIMSK0 & _BV(TOIE0))
+			timer0Overflow();
+		else
+			g_HostIo[0x35] |= _BV(TOV0);
+	}
+	// one left pending while it was masked runs once it is enabled
+	if ((TIFR0 & _BV(TOV0)) && (TIMSK0 & _BV(TOIE0)) && (SREG & _BV(SREG_I)))
+	{
+		TIFR0 = _BV(TOV0);
+		timer0Overflow();
+	}
+}
+
+/**
+* Run the timer 1 overflow interrupt if it is pending, enabled and
+* interrupts are on
+*/
+static void runTimer1(void)
+{
+	if (s_Timer1Pending && (SREG & _BV(SREG_I)) && (TIMSK1 & _BV(TOIE1)) && TIMER1_OVF_vect)
+	{
+		s_Timer1Pending = false;
+		SREG &= ~_BV(SREG_I);
+		TIMER1_OVF_vect();
+		SREG |= _BV(SREG_I);
+	}
+}
+
+/**
+* Run the watchdog interrupt if it is flagged, enabled and interrupts
+* are on
+*/
+static void runWdt(void)
+{
+	if ((WDTCSR & _BV(WDIF)) && (WDTCSR & _BV(WDIE)) && (SREG & _BV(SREG_I)) && WDT_vect)
+	{
+		WDTCSR &= ~_BV(WDIF);
+		SREG &= ~_BV(SREG_I);
+		WDT_vect();
+		SREG |= _BV(SREG_I);
+	}
+}
+
+/**
+* When the watchdog times out next
+*
+* @note - a watchdog enabled without a wdt_reset() counts from now
+*/
+static unsigned long wdtDue(void)
+{
+	uint8_t l_Prescale = (WDTCSR & 7) | ((WDTCSR >> 2) & 8);
+	unsigned long l_Period = s_WdtUs << l_Prescale;
+
+	if (s_WdtStart + l_Period <= s_Micros)
+		s_WdtStart = s_Micros;
+	return s_WdtStart + l_Period;
+}
+
+void wdt_reset(void)
+{
+	s_WdtStart = s_Micros;
+}
+
+/**
+* Move the clock on, stopping at every timer 1 overflow and watchdog
+* timeout on the way
+*
+* @note - the timer 1 overflow only goes pending while its interrupt is
+*  enabled, which stands in for LedTimer::begin() clearing TOV1 (writing
+*  1 to TIFR1 does not clear anything here)
+*/
+void hostAdvanceMicros(unsigned long a_Us)
+{
+	unsigned long l_End = s_Micros + a_Us;
+
+	// the interrupts may spend time of their own
+	while (s_Micros < l_End)
+	{
+		unsigned long l_Timer1 = (s_Micros / s_Timer1Us + 1) * s_Timer1Us;
+		unsigned long l_Wdt = (WDTCSR & _BV(WDIE)) ? wdtDue() : l_End;
+		unsigned long l_Step = l_End;
+
+		if (l_Timer1 < l_Step)
+			l_Step = l_Timer1;
+		if (l_Wdt < l_Step)
+			l_Step = l_Wdt;
+
+		s_Micros = l_Step;
+		runTimer0();
+		if (s_Micros == l_Timer1 && (TIMSK1 & _BV(TOIE1)))
+		{
+			s_Timer1Pending = true;
+			runTimer1();
+		}
+		if (s_Micros == l_Wdt && (WDTCSR & _BV(WDIE)))
+		{
+			// interrupt mode runs on, the next timeout is a period later
+			s_WdtStart = l_Wdt;
+			WDTCSR |= _BV(WDIF);
+			runWdt();
+		}
+	}
+}
+
+void delay(unsigned long a_Ms)
+{
+	hostAdvanceMicros(a_Ms * 1000);
+}
+
+void delayMicroseconds(unsigned int a_Us)
+{
+	hostAdvanceMicros(a_Us);
+}
+
+void cli(void)
+{
+	SREG &= ~_BV(SREG_I);
+}
+
+void sei(void)
+{
+	SREG |= _BV(SREG_I);
+	runTimer0();
+	runTimer1();
+	runWdt();
+}
+
+void set_sleep_mode(uint8_t a_Mode)
+{
+	(void)a_Mode;
+}
+
+void sleep_enable(void)
+{
+}
+
+void sleep_disable(void)
+{
+}
+
+/**
+* Sleep until the next enabled interrupt: the timer 0 overflow, every
+* 1024 us on a 16 MHz 328, a timer 1 overflow or the watchdog
+*/
+void sleep_cpu(void)
+{
+	// with none of them enabled the part would sleep for good
+	unsigned long l_Wake = ~0UL;
+	unsigned long l_Timer1 = (s_Micros / s_Timer1Us + 1) * s_Timer1Us;
+
+	++g_HostSleeps;
+	if (TIMSK0 & _BV(TOIE0))
+		l_Wake = (s_Micros / s_Timer0Us + 1) * s_Timer0Us;
+	if ((TIMSK1 & _BV(TOIE1)) && l_Timer1 < l_Wake)
+		l_Wake = l_Timer1;
+	if ((WDTCSR & _BV(WDIE)) && wdtDue() < l_Wake)
+		l_Wake = wdtDue();
+	hostAdvanceMicros(l_Wake - s_Micros);
+}
+
+void sleep_mode(void)
+{
+	sleep_cpu();
+}
+
+void pinMode(uint8_t a_Pin, uint8_t a_Mode)
+{
+	(void)a_Pin;
+	(void)a_Mode;
+}
+
+void digitalWrite(uint8_t a_Pin, uint8_t a_Value)
+{
+	if (a_Pin < HOST_NUM_PINS)
+		g_HostPinValues[a_Pin] = a_Value ? 255 : 0;
+}
+
+void analogWrite(uint8_t a_Pin, int a_Value)
+{
+	++g_HostAnalogWrites;
+	if (a_Pin < HOST_NUM_PINS)
+		g_HostPinValues[a_Pin] = (uint8_t)a_Value;
+}
+
+/**
+* Write a buffer one byte at a time
+*/
+size_t Print::write(const uint8_t* a_Buffer, size_t a_Size)
+{
+	size_t l_Count = 0;
+
+	while (a_Size--)
+		l_Count += write(*a_Buffer++);
+	return l_Count;
+}
+
+size_t Print::print(const char* a_String)
+{
+	return write((const uint8_t*)a_String, strlen(a_String));
+}
+
+size_t Print::print(char a_Char)
+{
+	return write((uint8_t)a_Char);
+}
+
+size_t Print::print(int a_Value, int a_Base)
+{
+	return print((long)a_Value, a_Base);
+}
+
+size_t Print::print(unsigned int a_Value, int a_Base)
+{
+	return print((unsigned long)a_Value, a_Base);
+}
+
+size_t Print::print(long a_Value, int a_Base)
+{
+	if (a_Value < 0 && a_Base == DEC)
+		return print('-') + printNumber(-(unsigned long)a_Value, a_Base);
+	return printNumber((unsigned long)a_Value, a_Base);
+}
+
+size_t Print::print(unsigned long a_Value, int a_Base)
+{
+	return printNumber(a_Value, a_Base);
+}
+
+size_t Print::println(void)
+{
+	return print("\r\n");
+}
+
+size_t Print::println(const char* a_String)		{ return print(a_String) + println(); }
+size_t Print::println(char a_Char)				{ return print(a_Char) + println(); }
+size_t Print::println(int a_Value, int a_Base)	{ return print(a_Value, a_Base) + println(); }
+size_t Print::println(unsigned int a_Value, int a_Base) { return print(a_Value, a_Base) + println(); }
+size_t Print::println(long a_Value, int a_Base)	{ return print(a_Value, a_Base) + println(); }
+size_t Print::println(unsigned long a_Value, int a_Base) { return print(a_Value, a_Base) + println(); }
+
+/**
+* Print a number in the given base, same output as the Arduino core
+*/
+size_t Print::printNumber(unsigned long a_Value, int a_Base)
+{
+	char l_Buffer[8 * sizeof(long) + 1];
+	char* l_Str = &l_Buffer[sizeof(l_Buffer) - 1];
+
+	*l_Str = '\0';
+	if (a_Base < 2)
+		a_Base = 10;
+	do
+	{
+		char l_Digit = a_Value % a_Base;
+		a_Value /= a_Base;
+		*--l_Str = l_Digit < 10 ? l_Digit + '0' : l_Digit + 'A' - 10;
+	} while (a_Value);
+
+	return print(l_Str);
+}
+
+HardwareSerial::HardwareSerial(void) : m_Baud(0), m_RxHead(0), m_RxTail(0), m_TxHead(0), m_TxTail(0)
+{
+}
+
+/**
+* Queue a byte for transmit. If nobody drains the TX ring it behaves like
+* the wire: the oldest byte goes out after one character time.
+*/
+size_t HardwareSerial::write(uint8_t a_Byte)
+{
+	int l_Next = (m_TxHead + 1) % m_BufferSize;
+
+	if (l_Next == m_TxTail)
+	{
+		// full - the real core would spin here until a byte is shifted out
+		hostAdvanceMicros(m_Baud ? 10000000UL / m_Baud : 0);
+		m_TxTail = (m_TxTail + 1) % m_BufferSize;
+	}
+	m_Tx[m_TxHead] = a_Byte;
+	m_TxHead = l_Next;
+	return 1;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+	return (m_TxTail - m_TxHead - 1 + m_BufferSize) % m_BufferSize;
+}
+
+int HardwareSerial::available(void)
+{
+	return (m_RxHead - m_RxTail + m_BufferSize) % m_BufferSize;
+}
+
+int HardwareSerial::read(void)
+{
+	int l_Byte;
+
+	if (m_RxHead == m_RxTail)
+		return -1;
+	l_Byte = m_Rx[m_RxTail];
+	m_RxTail = (m_RxTail + 1) % m_BufferSize;
+	return l_Byte;
+}
+
+int HardwareSerial::peek(void)
+{
+	if (m_RxHead == m_RxTail)
+		return -1;
+	return m_Rx[m_RxTail];
+}
+
+size_t HardwareSerial::hostInject(const uint8_t* a_Buffer, size_t a_Size)
+{
+	size_t l_Count = 0;
+
+	while (l_Count < a_Size)
+	{
+		int l_Next = (m_RxHead + 1) % m_BufferSize;
+
+		// full - the real core drops the byte
+		if (l_Next == m_RxTail)
+			break;
+		m_Rx[m_RxHead] = a_Buffer[l_Count++];
+		m_RxHead = l_Next;
+	}
+	return l_Count;
+}
+
+size_t HardwareSerial::hostDrain(uint8_t* a_Buffer, size_t a_Size)
+{
+	size_t l_Count = 0;
+
+	while (l_Count < a_Size && m_TxTail != m_TxHead)
+	{
+		a_Buffer[l_Count++] = m_Tx[m_TxTail];
+		m_TxTail = (m_TxTail + 1) % m_BufferSize;
+	}
+	return l_Count;
+}
@@ -0,0 +1,19 @@
+/**
+* @file interrupt.h
+* @brief host stand-in for avr/interrupt.h
+*
+* Interrupts are run by the simulated clock in arduino_shim.cpp. An
+* overflow while the I bit is clear stays pending until sei(), the way
+* the interrupt flag holds it on the part.
+*/
+#ifndef __HOST_AVR_INTERRUPT_H__
+#define __HOST_AVR_INTERRUPT_H__
+
+#include <avr/io.h>
+
+#define ISR(vector)		extern "C" void vector(void); extern "C" void vector(void)
+
+void cli(void);
+void sei(void);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+* @file io.h
+* @brief host stand-in for avr/io.h, a mock ATmega328 register file
+*
+* The registers are bytes of g_HostIo at their data space addresses on the
+* 328, so code that takes a register's address (PwmPin keeps a pointer to
+* its OCRnx) works the same as on the part. Nothing behind the registers
+* runs, except the timer 0 count, its overflow flag and the watchdog,
+* which the simulated clock in arduino_shim.cpp keeps; host tools look at
+* g_HostIo to see what was written.
+*/
+#ifndef __HOST_AVR_IO_H__
+#define __HOST_AVR_IO_H__
+
+#include <stdint.h>
+
+#define HOST_IO_SIZE	0x100
+
+extern volatile uint8_t g_HostIo[HOST_IO_SIZE];
+
+#define _BV(bit)		(1 << (bit))
+
+// status register, the I bit is the global interrupt enable
+#define SREG			g_HostIo[0x5F]
+#define SREG_I			7
+
+/**
+* An interrupt flag register, where writing a 1 clears the flag
+*/
+struct HostFlagRegister
+{
+	volatile uint8_t& m_Reg;
+
+	void operator=(uint8_t a_Value)	{ m_Reg &= ~a_Value; }
+	operator uint8_t() const		{ return m_Reg; }
+};
+
+// interrupt flags and masks, TIFR1 is not read back (see arduino_shim.cpp)
+#define TIFR0			(HostFlagRegister{ g_HostIo[0x35] })
+#define TIFR1			g_HostIo[0x36]
+#define TIMSK0			g_HostIo[0x6E]
+#define TIMSK1			g_HostIo[0x6F]
+#define TOV0			0
+#define TOV1			0
+#define TOIE0			0
+#define TOIE1			0
+
+// watchdog, the timed sequence is not checked
+#define MCUSR			g_HostIo[0x54]
+#define WDRF			3
+#define WDTCSR			g_HostIo[0x60]
+#define WDIF			7
+#define WDIE			6
+#define WDP3			5
+#define WDCE			4
+#define WDE				3
+#define WDP2			2
+#define WDP1			1
+#define WDP0			0
+
+// timer 0, pins 6 and 5
+#define TCCR0A			g_HostIo[0x44]
+#define TCCR0B			g_HostIo[0x45]
+#define TCNT0			g_HostIo[0x46]
+#define OCR0A			g_HostIo[0x47]
+#define OCR0B			g_HostIo[0x48]
+
+// timer 1, pins 9 and 10
+#define TCCR1A			g_HostIo[0x80]
+#define TCCR1B			g_HostIo[0x81]
+#define TCNT1L			g_HostIo[0x84]
+#define TCNT1H			g_HostIo[0x85]
+#define OCR1AL			g_HostIo[0x88]
+#define OCR1AH			g_HostIo[0x89]
+#define OCR1BL			g_HostIo[0x8A]
+#define OCR1BH			g_HostIo[0x8B]
+
+// timer 2, pins 11 and 3
+#define TCCR2A			g_HostIo[0xB0]
+#define TCCR2B			g_HostIo[0xB1]
+#define TCNT2			g_HostIo[0xB2]
+#define OCR2A			g_HostIo[0xB3]
+#define OCR2B			g_HostIo[0xB4]
+
+// TCCRnA compare output bits, the same positions on all three timers
+#define COM0A1			7
+#define COM0A0			6
+#define COM0B1			5
+#define COM0B0			4
+#define COM1A1			7
+#define COM1A0			6
+#define COM1B1			5
+#define COM1B0			4
+#define COM2A1			7
+#define COM2A0			6
+#define COM2B1			5
+#define COM2B0			4
+
+#endif
@@ -0,0 +1,24 @@
+/**
+* @file sleep.h
+* @brief host stand-in for avr/sleep.h
+*
+* sleep_mode() moves the simulated clock to the next enabled interrupt:
+* the timer 0 overflow, every 1024 us with the Arduino core, a timer 1
+* overflow or the watchdog.
+*/
+#ifndef __HOST_AVR_SLEEP_H__
+#define __HOST_AVR_SLEEP_H__
+
+#define SLEEP_MODE_IDLE			0
+#define SLEEP_MODE_PWR_DOWN		2
+
+void set_sleep_mode(uint8_t a_Mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+void sleep_mode(void);
+
+// number of times the simulated MCU went to sleep
+extern unsigned long g_HostSleeps;
+
+#endif
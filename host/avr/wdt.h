@@ -0,0 +1,13 @@
+/**
+* @file wdt.h
+* @brief host stand-in for avr/wdt.h
+*
+* The watchdog runs off the simulated clock in arduino_shim.cpp, a little
+* slow the way the 128 kHz oscillator of a real part is.
+*/
+#ifndef __HOST_AVR_WDT_H__
+#define __HOST_AVR_WDT_H__
+
+void wdt_reset(void);
+
+#endif
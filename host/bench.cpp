@@ -0,0 +1,772 @@
+/**
+* @file bench.cpp
+* @brief times LedStateMachine::updateState() on every Box sketch
+*
+* Every state machine of every sketch is ticked a fixed number of times.
+* Each tick is timed on its own and charged to the state the machine was
+* in when the tick started; the cost of reading the clock is measured up
+* front and taken back out.
+*
+* Easing is timed on its own over a spread of fades, for whichever easing
+* the build picked (see LEDSM_EXACT_EASING).
+*
+* Packed tables (see LEDPack.h) are played against the same steps as an
+* ordinary flash table, checked tick for tick, and the cost of reading a
+* step each way is timed. Sweeps are checked the same way against the
+* steps they stand for.
+*
+* Starting a group is timed on a table of long groups read through to
+* eLastInGroup and on the same table indexed with LEDQueue::indexGroups(),
+* which are checked against each other tick for tick, and selectGroup()
+* is checked against the index. LedRunner::selectGroup() is checked to
+* start a group on the next tick while the runner is skipping ahead, its
+* machines against ones ticked every tick.
+*
+* LedStateMachine::seekTo() is checked against ticking the same table
+* from the start, and a seek an hour in is timed against ticking there.
+*
+* Then each sketch's loop() is run against the simulated clock, in idle
+* and in watchdog sleep, to show how many ticks LedRunner skips, how often
+* the MCU wakes up and how often a PWM pin is written, and that the
+* watchdog sleeps leave micros() on the simulated time.
+*
+* Last, each sketch runs for a simulated minute with loop() blocked 25 ms
+* at a time, ticking from loop() and then from LedTimer's interrupt, to
+* compare how late the ticks run. The host clock stands still inside the
+* interrupt, so LedTimer::getMaxIsrTime() only means something on the part.
+*
+* usage: bench [ticks per state machine]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <avr/sleep.h>
+#include <vector>
+#include "sketches.h"
+#include "LedTimer.h"
+#include "LEDPack.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+static const int s_NumStates = LedStateMachine::eStateSteady + 1;
+
+static const char* const s_StateNames[s_NumStates] =
+{
+	"eStateIdle",
+	"eStateDelay",
+	"eStateMessageBegin",
+	"eStateEasing",
+	"eStateSteady",
+};
+
+/**
+* Per state totals
+*/
+struct StateTimes
+{
+	unsigned long m_Ticks[s_NumStates];
+	double m_Nanos[s_NumStates];
+};
+
+/**
+* Measure what an empty timed region costs
+*
+* @return - nanoseconds to subtract from each timed tick
+*/
+static double clockOverhead(void)
+{
+	const int l_Samples = 1000000;
+	BenchClock::time_point l_Start = BenchClock::now();
+
+	for (int i = 0; i < l_Samples; i++)
+	{
+		BenchClock::time_point l_A = BenchClock::now();
+		BenchClock::time_point l_B = BenchClock::now();
+		(void)l_A;
+		(void)l_B;
+	}
+	return std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() / l_Samples / 2;
+}
+
+/**
+* Tick one state machine, charging each tick to the state it started in
+*/
+static void timeMachine(LedStateMachine& a_Machine, unsigned long a_Ticks, double a_Overhead, StateTimes& a_Times)
+{
+	for (unsigned long i = 0; i < a_Ticks; i++)
+	{
+		int l_State = a_Machine.getState();
+		BenchClock::time_point l_Start = BenchClock::now();
+
+		a_Machine.updateState();
+
+		double l_Nanos = std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() - a_Overhead;
+		a_Times.m_Ticks[l_State]++;
+		a_Times.m_Nanos[l_State] += l_Nanos > 0 ? l_Nanos : 0;
+	}
+}
+
+/**
+* Tick one state machine without any per tick timing
+*
+* @return - nanoseconds per tick
+*/
+static double runMachine(LedStateMachine& a_Machine, unsigned long a_Ticks)
+{
+	BenchClock::time_point l_Start = BenchClock::now();
+
+	for (unsigned long i = 0; i < a_Ticks; i++)
+	{
+		a_Machine.updateState();
+	}
+	return std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() / a_Ticks;
+}
+
+static void printRow(const char* a_Name, unsigned long a_Ticks, double a_Nanos)
+{
+	if (0 == a_Ticks)
+	{
+		printf("    %-20s %12lu %10s %14s\n", a_Name, a_Ticks, "-", "-");
+		return;
+	}
+
+	double l_PerTick = a_Nanos / a_Ticks;
+	printf("    %-20s %12lu %10.2f %14.0f\n", a_Name, a_Ticks, l_PerTick, l_PerTick > 0 ? 1e9 / l_PerTick : 0);
+}
+
+/**
+* Run Easing over a spread of fades, timing prepare() and the per tick
+* step(), and count the fades that do not finish on their end magnitude
+*/
+static void benchEasing(void)
+{
+	static const uint16_t s_Times[] = { 1, 2, 3, 7, 10, 30, 100, 255, 256, 1000, 65535 };
+	const int l_NumTimes = sizeof(s_Times)/sizeof(s_Times[0]);
+	std::vector<LEDEasingSetup> l_Setups;
+	std::vector<uint8_t> l_Start;
+	std::vector<uint8_t> l_End;
+	std::vector<uint16_t> l_Time;
+	BenchClock::time_point l_Begin;
+	double l_PrepareNanos;
+	double l_StepNanos;
+	unsigned long l_Steps = 0;
+	unsigned long l_Missed = 0;
+	unsigned l_Sink = 0;
+
+	for (int l_From = 0; l_From < 256; l_From += 17)
+	{
+		for (int l_To = 0; l_To < 256; l_To += 15)
+		{
+			for (int t = 0; t < l_NumTimes; t++)
+			{
+				l_Start.push_back(l_From);
+				l_End.push_back(l_To);
+				l_Time.push_back(s_Times[t]);
+			}
+		}
+	}
+	l_Setups.resize(l_Start.size());
+
+	l_Begin = BenchClock::now();
+	for (size_t i = 0; i < l_Setups.size(); i++)
+	{
+		l_Setups[i] = Easing::prepare(l_Start[i], l_End[i], l_Time[i]);
+	}
+	l_PrepareNanos = std::chrono::duration<double, std::nano>(BenchClock::now() - l_Begin).count() / l_Setups.size();
+
+	l_Begin = BenchClock::now();
+	for (size_t i = 0; i < l_Setups.size(); i++)
+	{
+		LEDEasingState l_State;
+		uint8_t l_Value = l_Start[i];
+
+		Easing::begin(l_State, l_Value, l_Setups[i]);
+		for (uint16_t t = 0; t < l_Time[i]; t++)
+		{
+			l_Value = Easing::step(l_State, l_Setups[i]);
+			l_Sink += l_Value;
+		}
+		l_Steps += l_Time[i];
+		l_Missed += l_Value != l_End[i];
+	}
+	l_StepNanos = std::chrono::duration<double, std::nano>(BenchClock::now() - l_Begin).count() / l_Steps;
+
+	printf("%-10s %14s %14s %14s %10s\n", "Easing", "prepare ns", "step ns", "fades", "missed end");
+	printf("%-10s %14.2f %14.2f %14lu %10lu\n\n",
+#ifdef LEDSM_EXACT_EASING
+		"exact",
+#else
+		"17.15",
+#endif
+		l_PrepareNanos, l_StepNanos, (unsigned long)l_Setups.size(), l_Missed);
+	if (0 == l_Sink)
+		printf("\n");
+}
+
+// a fade written out a level at a time, with 1 tick steps so it wraps often
+static constexpr uint8_t s_PackedRamp[] PROGMEM =
+{
+	LED_PACK_RUN(2, 128, -2),
+		LED_PACK_STEP(0, 1, 255),				LED_PACK_V1(1),	LED_PACK_V1(1),
+		LED_PACK_STEP(eLastInGroup, 0, 254),	LED_PACK_V1(1),	LED_PACK_V1(1),
+	LED_PACK_END
+};
+
+// groups that cross run boundaries, repeat, and varints of every size
+static constexpr uint8_t s_PackedMixed[] PROGMEM =
+{
+	LED_PACK_RUN(3, 5, 7),
+		LED_PACK_STEP(0, 2, 10),				LED_PACK_V1(3),		LED_PACK_V1(1),
+		LED_PACK_STEP(eLastInGroup, 0, 40),		LED_PACK_V2(130),	LED_PACK_V1(0),
+		LED_PACK_STEP(0, 1, 90),				LED_PACK_V1(2),		LED_PACK_V1(4),
+	LED_PACK_RUN(1, 1, 0),
+		LED_PACK_STEP(eLastInGroup, 0, 255),	LED_PACK_V1(9),		LED_PACK_V3(16400),
+	LED_PACK_RUN(2, 3, -30),
+		LED_PACK_STEP(0, 3, 200),				LED_PACK_V1(5),		LED_PACK_V1(5),
+		LED_PACK_STEP(eLastInGroup, 0, 100),	LED_PACK_V1(5),		LED_PACK_V1(0),
+	LED_PACK_END
+};
+
+static const LEDStep s_PlainMixed[] PROGMEM =
+{
+	LEDStep(	0,				2,	10,		3,		1 ),
+	LEDStep(	eLastInGroup,	0,	40,		130,	0 ),
+	LEDStep(	0,				1,	90,		2,		4 ),
+	LEDStep(	0,				2,	17,		3,		1 ),
+	LEDStep(	eLastInGroup,	0,	47,		130,	0 ),
+	LEDStep(	0,				1,	97,		2,		4 ),
+	LEDStep(	0,				2,	24,		3,		1 ),
+	LEDStep(	eLastInGroup,	0,	54,		130,	0 ),
+	LEDStep(	0,				1,	104,	2,		4 ),
+	LEDStep(	0,				2,	31,		3,		1 ),
+	LEDStep(	eLastInGroup,	0,	61,		130,	0 ),
+	LEDStep(	0,				1,	111,	2,		4 ),
+	LEDStep(	0,				2,	38,		3,		1 ),
+	LEDStep(	eLastInGroup,	0,	68,		130,	0 ),
+	LEDStep(	0,				1,	118,	2,		4 ),
+	LEDStep(	eLastInGroup,	0,	255,	9,		16400 ),
+	LEDStep(	0,				3,	200,	5,		5 ),
+	LEDStep(	eLastInGroup,	0,	100,	5,		0 ),
+	LEDStep(	0,				3,	170,	5,		5 ),
+	LEDStep(	eLastInGroup,	0,	70,		5,		0 ),
+	LEDStep(	0,				3,	140,	5,		5 ),
+	LEDStep(	eLastInGroup,	0,	40,		5,		0 ),
+};
+
+/**
+* Read every step of a table the way the state machine does, a group at a time
+*
+* @return - nanoseconds per step
+*/
+static double walkQueue(LEDQueue& a_Queue, unsigned long a_Steps, unsigned& a_Sink)
+{
+	BenchClock::time_point l_Start = BenchClock::now();
+	unsigned long l_Done = 0;
+
+	a_Queue.reset();
+	while (l_Done < a_Steps)
+	{
+		uint8_t l_Count;
+
+		a_Sink += a_Queue.startGroup(l_Count)->getLEDMagnitude();
+		for (uint8_t i = 1; i < l_Count; i++)
+		{
+			a_Sink += a_Queue.retrieveNextMessage()->getLEDMagnitude();
+		}
+		l_Done += l_Count;
+	}
+	return std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() / l_Done;
+}
+
+/**
+* Play a packed table and the same steps from an ordinary flash table
+*
+* @return - false if the LEDs ever differ
+*/
+static bool benchPacked(const char* a_Name, const LEDPacked& a_Packed, const LEDStep* a_Plain, uint16_t a_Count, size_t a_Bytes, unsigned long a_Ticks)
+{
+	LEDQueue l_PackedQueue(a_Packed);
+	LEDQueue l_PlainQueue(a_Plain, a_Count, LEDQueue::eStorageProgmem);
+	LED l_PackedLED(5);
+	LED l_PlainLED(6);
+	LedStateMachine l_PackedSM(l_PackedLED, l_PackedQueue);
+	LedStateMachine l_PlainSM(l_PlainLED, l_PlainQueue);
+	unsigned long l_Mismatch = 0;
+	unsigned l_Sink = 0;
+
+	for (unsigned long t = 0; t < a_Ticks; t++)
+	{
+		l_PackedSM.updateState();
+		l_PlainSM.updateState();
+		l_Mismatch += l_PackedLED.getMagnitude() != l_PlainLED.getMagnitude();
+	}
+
+	double l_PlainNanos = walkQueue(l_PlainQueue, a_Ticks, l_Sink);
+	double l_PackedNanos = walkQueue(l_PackedQueue, a_Ticks, l_Sink);
+
+	printf("%-10s %8u %10u %10u %12.2f %12.2f %10lu\n", a_Name, a_Count, (unsigned)(a_Count * sizeof(LEDStep)), (unsigned)a_Bytes,
+		l_PlainNanos, l_PackedNanos, l_Mismatch);
+	if (0 == l_Sink)
+		printf("\n");
+	return 0 == l_Mismatch;
+}
+
+// sweeps down, up past a step size that does not divide the distance,
+// starting on their end level, and in a group that repeats
+static const LEDStep s_Sweeps[] PROGMEM =
+{
+	LEDStep(	0,							1,	200,	3,	2 ),
+	LEDStep(	eSweep | 7,					0,	20,		2,	1 ),
+	LEDStep(	eLastInGroup | eSweep | 50,	0,	255,	1,	3 ),
+	LEDStep(	0,							3,	10,		0,	4 ),
+	LEDStep(	eSweep,						0,	10,		2,	0 ),
+	LEDStep(	eLastInGroup | eSweep,		0,	40,		1,	0 ),
+};
+
+/**
+* Write a table's sweeps out as ordinary steps
+*
+* @note - each group is assumed to start on a step that is not a sweep
+*/
+static std::vector<LEDStep> expandSweeps(const LEDStep* a_Table, size_t a_Count)
+{
+	std::vector<LEDStep> l_Steps;
+	uint8_t l_Level = 0;
+
+	for (size_t i = 0; i < a_Count; i++)
+	{
+		const LEDStep& l_Step = a_Table[i];
+		uint8_t l_Flags = l_Step.getFlags() & ~(eSweep | eSweepStepMask);
+		uint8_t l_Reps = l_Step.getRepetitions();
+
+		if (!l_Step.isSweep())
+		{
+			l_Steps.push_back(LEDStep(l_Flags, l_Reps, l_Step.getLEDMagnitude(), l_Step.getEasing(), l_Step.getDuration()));
+			l_Level = l_Step.getLEDMagnitude();
+			continue;
+		}
+		do
+		{
+			int l_Next = l_Level < l_Step.getLEDMagnitude() ? l_Level + l_Step.getSweepStep() : l_Level - l_Step.getSweepStep();
+
+			if ((l_Level < l_Step.getLEDMagnitude()) != (l_Next < l_Step.getLEDMagnitude()) || l_Level == l_Step.getLEDMagnitude())
+				l_Next = l_Step.getLEDMagnitude();
+			l_Level = l_Next;
+			l_Steps.push_back(LEDStep(l_Level == l_Step.getLEDMagnitude() ? l_Flags : 0, l_Reps, l_Level, l_Step.getEasing(), l_Step.getDuration()));
+			l_Reps = 0;
+		} while (l_Level != l_Step.getLEDMagnitude());
+	}
+	return l_Steps;
+}
+
+/**
+* Time startGroup() over every group of a table, again and again
+*
+* @return - nanoseconds per group
+*/
+static double startGroups(LEDQueue& a_Queue, unsigned long a_Groups, unsigned& a_Sink)
+{
+	BenchClock::time_point l_Start = BenchClock::now();
+	uint8_t l_Count;
+
+	a_Queue.reset();
+	for (unsigned long i = 0; i < a_Groups; i++)
+	{
+		a_Sink += a_Queue.startGroup(l_Count)->getLEDMagnitude() + l_Count;
+	}
+	return std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() / a_Groups;
+}
+
+/**
+* Play a table of long groups read through and indexed, and pick each
+* group of the indexed one with selectGroup()
+*
+* @return - false if the LEDs ever differ or a group is not where the
+*  index says
+*/
+static bool benchGroups(unsigned long a_Ticks)
+{
+	const uint16_t l_NumGroups = 8;
+	const uint8_t l_Length = 32;
+	std::vector<LEDStep> l_Steps;
+	LEDGroupSpan l_Index[l_NumGroups];
+	unsigned long l_Mismatch = 0;
+	unsigned l_Sink = 0;
+
+	for (uint16_t g = 0; g < l_NumGroups; g++)
+	{
+		for (uint8_t i = 0; i < l_Length; i++)
+		{
+			l_Steps.push_back(LEDStep(i == l_Length - 1 ? eLastInGroup : 0, i ? 0 : 1 + g % 3, (g * 31 + i * 7) & 0xff, 1 + i % 3, i & 1));
+		}
+	}
+
+	LEDQueue l_ScanQueue(l_Steps.data(), l_Steps.size());
+	LEDQueue l_IndexQueue(l_Steps.data(), l_Steps.size());
+	LED l_ScanLED(5);
+	LED l_IndexLED(6);
+	LedStateMachine l_ScanSM(l_ScanLED, l_ScanQueue);
+	LedStateMachine l_IndexSM(l_IndexLED, l_IndexQueue);
+
+	l_Mismatch += l_NumGroups != l_IndexQueue.indexGroups(l_Index, l_NumGroups);
+	for (unsigned long t = 0; t < a_Ticks; t++)
+	{
+		l_ScanSM.updateState();
+		l_IndexSM.updateState();
+		l_Mismatch += l_ScanLED.getMagnitude() != l_IndexLED.getMagnitude();
+	}
+
+	for (uint16_t g = l_NumGroups; g--; )
+	{
+		uint8_t l_Count;
+
+		l_Mismatch += !l_IndexQueue.selectGroup(g);
+		l_Mismatch += l_IndexQueue.startGroup(l_Count) != &l_Steps[g * l_Length] || l_Count != l_Length;
+	}
+	l_Mismatch += l_IndexQueue.selectGroup(l_NumGroups);
+
+	double l_ScanNanos = startGroups(l_ScanQueue, a_Ticks / l_Length, l_Sink);
+	double l_IndexNanos = startGroups(l_IndexQueue, a_Ticks / l_Length, l_Sink);
+
+	printf("%-10s %8s %8s %12s %12s %10s\n", "startGroup", "groups", "steps", "scan ns", "index ns", "mismatch");
+	printf("%-10s %8u %8u %12.2f %12.2f %10lu\n\n", "long", l_NumGroups, l_Length, l_ScanNanos, l_IndexNanos, l_Mismatch);
+	if (0 == l_Sink)
+		printf("\n");
+	return 0 == l_Mismatch;
+}
+
+/**
+* Pick groups through LedRunner::selectGroup() part way through the long
+* holds the runner skips, and play its machines against copies that are
+* ticked every tick and pick the same groups
+*
+* @return - false if a group waits past the next tick, or the LEDs ever
+*  differ
+*/
+static bool benchWake(unsigned long a_Ticks)
+{
+	static const LEDStep s_Holds[] =
+	{
+		LEDStep(eLastInGroup, 1, 20, 0, 30000),
+		LEDStep(eLastInGroup, 1, 200, 0, 50),
+		LEDStep(eLastInGroup, 2, 90, 400, 20000),
+	};
+	static const LEDStep s_Fades[] =
+	{
+		LEDStep(0, 1, 100, 3000, 20000),
+		LEDStep(eLastInGroup, 0, 5, 0, 4000),
+	};
+	const uint32_t l_Period = 10000;
+	const uint32_t l_Step = 700;
+	LEDGroupSpan l_Index[3];
+	LEDQueue l_HoldQueue(s_Holds, 3);
+	LEDQueue l_FadeQueue(s_Fades, 2);
+	LEDQueue l_HoldCopy(s_Holds, 3);
+	LEDQueue l_FadeCopy(s_Fades, 2);
+	LED l_HoldLED(5);
+	LED l_FadeLED(6);
+	LED l_HoldCopyLED(9);
+	LED l_FadeCopyLED(10);
+	LedStateMachine l_HoldSM(l_HoldLED, l_HoldQueue);
+	LedStateMachine l_FadeSM(l_FadeLED, l_FadeQueue);
+	LedStateMachine l_HoldCopySM(l_HoldCopyLED, l_HoldCopy);
+	LedStateMachine l_FadeCopySM(l_FadeCopyLED, l_FadeCopy);
+	LedStateMachine* const l_Machines[] = { &l_HoldSM, &l_FadeSM };
+	TickScheduler l_Ticker(l_Period);
+	LedRunner l_Runner(l_Machines, 2, l_Ticker);
+	unsigned long l_Picks = 0;
+	unsigned long l_Selects = 0;
+	unsigned long l_Late = 0;
+	unsigned long l_Mismatch = 0;
+	unsigned long l_Next = 0;
+	uint32_t l_Started = 0;
+	bool l_Waiting = false;
+
+	l_Mismatch += 3 != l_HoldQueue.indexGroups(l_Index, 3);
+	l_HoldCopy.indexGroups(l_Index, 3);
+	l_Ticker.start(0);
+
+	// micros() wraps on a long run, the runner has to take that too
+	for (unsigned long t = 0; t < a_Ticks * l_Period; t += l_Step)
+	{
+		// the copies tick on the grid, before the runner's tick there
+		if (t / l_Period != (t - l_Step) / l_Period || 0 == t)
+		{
+			l_HoldCopySM.updateState();
+			l_FadeCopySM.updateState();
+		}
+		l_Runner.service((uint32_t)t);
+		l_Mismatch += l_HoldLED.getMagnitude() != l_HoldCopyLED.getMagnitude();
+		l_Mismatch += l_FadeLED.getMagnitude() != l_FadeCopyLED.getMagnitude();
+
+		// the group picked has to be out of eStateIdle by the next tick
+		if (l_Waiting && (int32_t)((uint32_t)t - l_Started) >= 0)
+		{
+			l_Late += LedStateMachine::eStateIdle == l_HoldSM.getState();
+			l_Waiting = false;
+		}
+
+		if (t >= l_Next)
+		{
+			// group 3 is not there, that machine plays on
+			uint16_t l_Group = l_Picks++ % 4;
+
+			l_Mismatch += l_Runner.selectGroup(0, l_Group, (uint32_t)t) != l_HoldCopySM.selectGroup(l_Group);
+			if (l_Group < 3)
+			{
+				l_Started = l_Ticker.getDeadline();
+				l_Late += (int32_t)(l_Started - (uint32_t)t) > (int32_t)l_Period;
+				l_Waiting = true;
+				++l_Selects;
+			}
+			l_Next = t + (250 + t % 4001) * l_Period + t % l_Period;
+		}
+	}
+
+	printf("%-10s %8s %12s %10s %10s\n", "wake", "selects", "skipped", "late", "mismatch");
+	printf("%-10s %8lu %12lu %10lu %10lu\n\n", "holds", l_Selects, (unsigned long)l_Runner.getSkippedTicks(), l_Late, l_Mismatch);
+	return 0 == l_Late && 0 == l_Mismatch;
+}
+
+/**
+* Play a table with sweeps against its sweeps written out
+*
+* @return - false if the LEDs ever differ
+*/
+static bool benchSweeps(unsigned long a_Ticks)
+{
+	std::vector<LEDStep> l_Expanded = expandSweeps(s_Sweeps, sizeof(s_Sweeps)/sizeof(LEDStep));
+	LEDQueue l_SweepQueue(s_Sweeps, sizeof(s_Sweeps)/sizeof(LEDStep), LEDQueue::eStorageProgmem);
+	LEDQueue l_ExpandedQueue(l_Expanded.data(), l_Expanded.size());
+	LED l_SweepLED(5);
+	LED l_ExpandedLED(6);
+	LedStateMachine l_SweepSM(l_SweepLED, l_SweepQueue);
+	LedStateMachine l_ExpandedSM(l_ExpandedLED, l_ExpandedQueue);
+	unsigned long l_Mismatch = 0;
+	double l_SweepNanos;
+	double l_ExpandedNanos;
+
+	for (unsigned long t = 0; t < a_Ticks; t++)
+	{
+		l_SweepSM.updateState();
+		l_ExpandedSM.updateState();
+		l_Mismatch += l_SweepLED.getMagnitude() != l_ExpandedLED.getMagnitude();
+	}
+
+	l_SweepSM.reset();
+	l_ExpandedSM.reset();
+	l_SweepNanos = runMachine(l_SweepSM, a_Ticks);
+	l_ExpandedNanos = runMachine(l_ExpandedSM, a_Ticks);
+
+	printf("%-10s %8s %10s %12s %12s %10s\n", "eSweep", "steps", "expanded", "sweep ns", "steps ns", "mismatch");
+	printf("%-10s %8u %10u %12.2f %12.2f %10lu\n\n", "mixed", (unsigned)(sizeof(s_Sweeps)/sizeof(LEDStep)), (unsigned)l_Expanded.size(),
+		l_SweepNanos, l_ExpandedNanos, l_Mismatch);
+	return 0 == l_Mismatch;
+}
+
+/**
+* Check LedStateMachine::seekTo() against ticking a second machine on a
+* copy of the same queue, then time a seek an hour in
+*
+* @return - false if a seek ever lands somewhere updateState() did not
+*/
+static bool benchSeek(const HostSketch& a_Host, unsigned long a_Ticks)
+{
+	const uint32_t l_Hour = 360000;
+	bool l_Ok = true;
+
+	for (int l_Channel = 0; l_Channel < a_Host.m_NumMachines; l_Channel++)
+	{
+		LedStateMachine& l_Machine = *a_Host.m_Machines[l_Channel];
+		LEDQueue l_Queue(l_Machine.getQueue());
+		LED l_LED(5);
+		LedStateMachine l_Ticked(l_LED, l_Queue);
+		unsigned long l_Seeks = 0;
+		unsigned long l_Mismatch = 0;
+		unsigned long l_Next = 0;
+		int l_Reps = 0;
+		double l_SeekNanos;
+		double l_TickNanos;
+
+		l_Ticked.reset();
+		for (unsigned long t = 0; t < a_Ticks; t++)
+		{
+			if (t == l_Next)
+			{
+				// land on a spread of places, part way through fades included
+				l_Machine.seekTo(t);
+				++l_Seeks;
+				l_Mismatch += l_Machine.getState() != l_Ticked.getState();
+				l_Mismatch += l_Machine.getLED().getMagnitude() != l_LED.getMagnitude();
+				l_Next += 997 + (t * 7919) % 1013;
+			}
+			l_Ticked.updateState();
+			l_Machine.updateState();
+			l_Mismatch += l_Machine.getLED().getMagnitude() != l_LED.getMagnitude();
+		}
+
+		BenchClock::time_point l_Start = BenchClock::now();
+
+		do
+		{
+			l_Machine.seekTo(l_Hour + l_Reps);
+		} while (++l_Reps < 1000 && BenchClock::now() - l_Start < std::chrono::milliseconds(200));
+		l_SeekNanos = std::chrono::duration<double, std::nano>(BenchClock::now() - l_Start).count() / l_Reps;
+
+		l_Ticked.reset();
+		l_TickNanos = runMachine(l_Ticked, l_Hour) * l_Hour;
+
+		printf("%-10s %3d %8lu %14.2f %14.2f %10lu\n", a_Host.m_Name, l_Channel, l_Seeks, l_SeekNanos / 1000, l_TickNanos / 1000, l_Mismatch);
+		l_Machine.reset();
+		l_Ok &= (0 == l_Mismatch);
+	}
+	return l_Ok;
+}
+
+/**
+* Run a sketch with loop() blocked for a_BlockMs at a time, ticking from
+* loop() between the blocks and then from LedTimer, and compare how late
+* the ticks run
+*/
+static void benchTimer(const HostSketch& a_Host, unsigned long a_BlockMs)
+{
+	const unsigned long l_Seconds = 60;
+	unsigned long l_End;
+
+	for (int i = 0; i < a_Host.m_NumMachines; i++)
+	{
+		a_Host.m_Machines[i]->reset();
+	}
+	a_Host.m_Runner->setSleep(LedRunner::eSleepOff);
+	a_Host.m_Ticker->start(micros());
+	a_Host.m_Ticker->clearStats();
+	l_End = micros() + l_Seconds * 1000000UL;
+	while ((long)(micros() - l_End) < 0)
+	{
+		a_Host.m_Loop();
+		delay(a_BlockMs);
+	}
+
+	for (int i = 0; i < a_Host.m_NumMachines; i++)
+	{
+		a_Host.m_Machines[i]->reset();
+	}
+	LedTimer l_Timer(*a_Host.m_Runner, a_Host.m_Ticker->getPeriod());
+
+	l_Timer.begin();
+	l_End = micros() + l_Seconds * 1000000UL;
+	while ((long)(micros() - l_End) < 0)
+	{
+		delay(a_BlockMs);
+	}
+	l_Timer.end();
+
+	printf("%-10s %8lu %12lu %12lu %12lu\n", a_Host.m_Name, a_BlockMs, (unsigned long)a_Host.m_Ticker->getMaxLate(),
+		(unsigned long)l_Timer.getTicks(), (unsigned long)l_Timer.getMaxLate());
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Ticks = argc > 1 ? strtoul(argv[1], NULL, 0) : 4000000UL;
+	double l_Overhead = clockOverhead();
+
+	printf("%lu ticks per state machine, clock overhead %.1f ns\n\n", l_Ticks, l_Overhead);
+
+	for (int l_Sketch = 0; l_Sketch < g_NumHostSketches; l_Sketch++)
+	{
+		const HostSketch& l_Host = g_HostSketches[l_Sketch];
+
+		for (int l_Channel = 0; l_Channel < l_Host.m_NumMachines; l_Channel++)
+		{
+			LedStateMachine& l_Machine = *l_Host.m_Machines[l_Channel];
+			StateTimes l_Times = {};
+
+			l_Machine.reset();
+			timeMachine(l_Machine, l_Ticks, l_Overhead, l_Times);
+			double l_Untimed = runMachine(l_Machine, l_Ticks);
+
+			printf("%s channel %d\n", l_Host.m_Name, l_Channel);
+			printf("    %-20s %12s %10s %14s\n", "state", "ticks", "ns/tick", "ticks/s");
+			for (int l_State = 0; l_State < s_NumStates; l_State++)
+			{
+				printRow(s_StateNames[l_State], l_Times.m_Ticks[l_State], l_Times.m_Nanos[l_State]);
+			}
+			printRow("all (untimed)", l_Ticks, l_Untimed * l_Ticks);
+			printf("\n");
+		}
+	}
+
+	benchEasing();
+
+	// packed tables against the same steps unpacked
+	static LEDStep s_PlainRamp[256];
+	bool l_PackOk = true;
+
+	for (int i = 0; i < 256; i++)
+	{
+		s_PlainRamp[i] = LEDStep(i & 1 ? eLastInGroup : 0, i & 1 ? 0 : 1, 255 - i, 1, 1);
+	}
+	printf("%-10s %8s %10s %10s %12s %12s %10s\n", "LEDPack", "steps", "bytes", "packed", "flash ns", "packed ns", "mismatch");
+	l_PackOk &= benchPacked("ramp", LED_PACKED(s_PackedRamp), s_PlainRamp, 256, sizeof(s_PackedRamp), l_Ticks);
+	l_PackOk &= benchPacked("mixed", LED_PACKED(s_PackedMixed), s_PlainMixed, sizeof(s_PlainMixed)/sizeof(LEDStep), sizeof(s_PackedMixed), l_Ticks);
+	printf("\n");
+
+	l_PackOk &= benchSweeps(l_Ticks);
+	l_PackOk &= benchGroups(l_Ticks);
+	l_PackOk &= benchWake(l_Ticks);
+
+	// seeking against ticking, and an hour in each way
+	bool l_SeekOk = true;
+
+	printf("%-10s %3s %8s %14s %14s %10s\n", "seekTo", "ch", "seeks", "1 h seek us", "1 h ticks us", "mismatch");
+	for (int l_Sketch = 0; l_Sketch < g_NumHostSketches; l_Sketch++)
+	{
+		l_SeekOk &= benchSeek(g_HostSketches[l_Sketch], l_Ticks);
+	}
+	printf("\n");
+
+	// now the whole sketch, an hour of simulated time in each sleep mode
+	const unsigned long l_Seconds = 3600;
+	static const char* const s_SleepNames[] = { "off", "idle", "watchdog" };
+	bool l_ClockOk = true;
+
+	printf("%-10s %-8s %14s %14s %14s %12s %12s %10s\n", "loop()", "sleep", "ticks run", "ticks skipped", "wakeups/s", "overruns", "writes/s", "clock us");
+	for (int l_Sketch = 0; l_Sketch < g_NumHostSketches; l_Sketch++)
+	{
+		const HostSketch& l_Host = g_HostSketches[l_Sketch];
+
+		for (int l_Mode = LedRunner::eSleepIdle; l_Mode <= LedRunner::eSleepWatchdog; l_Mode++)
+		{
+			unsigned long l_End = micros() + l_Seconds * 1000000UL;
+			unsigned long l_Sleeps = g_HostSleeps;
+			uint32_t l_Ticks = l_Host.m_Ticker->getTicks();
+			uint32_t l_Skipped = l_Host.m_Runner->getSkippedTicks();
+			unsigned long l_Writes = g_HostAnalogWrites;
+			long l_ClockError;
+
+			l_Host.m_Runner->setSleep((LedRunner::SleepMode)l_Mode);
+			while ((long)(micros() - l_End) < 0)
+			{
+				l_Host.m_Loop();
+			}
+			l_Skipped = l_Host.m_Runner->getSkippedTicks() - l_Skipped;
+			l_Ticks = l_Host.m_Ticker->getTicks() - l_Ticks - l_Skipped;
+
+			// the watchdog sleeps must hand micros() back where it would be
+			l_ClockError = (long)(micros() - hostMicros());
+			l_ClockOk &= (0 == l_ClockError);
+			printf("%-10s %-8s %14lu %14lu %14.1f %12lu %12.1f %10ld\n", l_Host.m_Name, s_SleepNames[l_Mode], (unsigned long)l_Ticks,
+				(unsigned long)l_Skipped, (double)(g_HostSleeps - l_Sleeps) / l_Seconds, (unsigned long)l_Host.m_Ticker->getOverruns(),
+				(double)(g_HostAnalogWrites - l_Writes) / l_Seconds, l_ClockError);
+		}
+	}
+	printf("\n");
+
+	// ticking from the timer interrupt while loop() blocks
+	printf("%-10s %8s %12s %12s %12s\n", "LedTimer", "block ms", "loop late us", "isr ticks", "isr late us");
+	for (int l_Sketch = 0; l_Sketch < g_NumHostSketches; l_Sketch++)
+	{
+		benchTimer(g_HostSketches[l_Sketch], 25);
+	}
+	return (l_PackOk && l_SeekOk && l_ClockOk) ? 0 : 1;
+}
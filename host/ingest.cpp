@@ -0,0 +1,253 @@
+/**
+* @file ingest.cpp
+* @brief streams step groups into LEDStream over a simulated 115200 baud link
+*
+* The board side is five state machines on eStorageRing queues, ticked
+* every millisecond by a LedRunner, with LEDStream reading Serial. The
+* host side sends group frames one byte time apart through the receive
+* buffer, the way the UART interrupt would fill it, and keeps within the
+* credits the board sends back. Bytes that find the receive buffer full
+* are lost, as they would be on the part.
+*
+* Every step is a 1 tick steady level, so the LEDs can take steps faster
+* than the link brings them and the link is the limit. At the end the
+* sender stops and the rings are left to play out; every step sent has to
+* be credited back, and every good step played. Groups whose first step
+* has no repetitions have to be thrown away and credited back too.
+*
+* usage: ingest [seconds] [corrupt every n-th frame] [no repetitions in
+*  every n-th frame]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "LEDStream.h"
+#include "LedRunner.h"
+
+#define INGEST_BAUD		115200UL
+#define INGEST_CHANNELS	5
+#define INGEST_RING		64
+#define INGEST_GROUP	8
+
+static LEDStep s_Rings[INGEST_CHANNELS][INGEST_RING];
+static LEDQueue s_Queue0(s_Rings[0], INGEST_RING, LEDQueue::eStorageRing);
+static LEDQueue s_Queue1(s_Rings[1], INGEST_RING, LEDQueue::eStorageRing);
+static LEDQueue s_Queue2(s_Rings[2], INGEST_RING, LEDQueue::eStorageRing);
+static LEDQueue s_Queue3(s_Rings[3], INGEST_RING, LEDQueue::eStorageRing);
+static LEDQueue s_Queue4(s_Rings[4], INGEST_RING, LEDQueue::eStorageRing);
+static LEDQueue* const s_Queues[INGEST_CHANNELS] = { &s_Queue0, &s_Queue1, &s_Queue2, &s_Queue3, &s_Queue4 };
+
+static LED s_LED0(5), s_LED1(6), s_LED2(9), s_LED3(10), s_LED4(11);
+static LedStateMachine s_Machine0(s_LED0, s_Queue0);
+static LedStateMachine s_Machine1(s_LED1, s_Queue1);
+static LedStateMachine s_Machine2(s_LED2, s_Queue2);
+static LedStateMachine s_Machine3(s_LED3, s_Queue3);
+static LedStateMachine s_Machine4(s_LED4, s_Queue4);
+static LedStateMachine* const s_Machines[INGEST_CHANNELS] = { &s_Machine0, &s_Machine1, &s_Machine2, &s_Machine3, &s_Machine4 };
+
+static TickScheduler s_Ticker(1000);
+static LedRunner s_Runner(s_Machines, INGEST_CHANNELS, s_Ticker);
+static LEDStream s_Stream(Serial, s_Queues, INGEST_CHANNELS);
+
+/**
+* The host end of the link
+*/
+struct IngestHost
+{
+	uint8_t m_Frame[5 + 1 + LEDStream::eMaxGroupSteps * LEDStream::eStepBytes];
+	int m_FrameSize;
+	int m_FrameSent;
+	uint8_t m_Next;						// channel to try first for the next frame
+	uint8_t m_Level;
+
+	uint16_t m_Sent[INGEST_CHANNELS];	// steps sent, wraps like the credit
+	uint16_t m_Done[INGEST_CHANNELS];	// last credit
+	uint8_t m_Capacity[INGEST_CHANNELS];	// 0 until the first credit
+
+	unsigned long m_Frames;
+	unsigned long m_Corrupted;
+	unsigned long m_Rejected;
+	unsigned long m_GoodSteps;
+	unsigned long m_Bytes;
+	unsigned long m_Overruns;
+
+	// credit frame parser
+	uint8_t m_Rx[8];
+	int m_RxCount;
+};
+
+/**
+* Build the next group frame for a channel with room for it
+*
+* @return - false if no channel has the credit
+*/
+static bool nextFrame(IngestHost& a_Host, unsigned long a_CorruptEvery, unsigned long a_RejectEvery)
+{
+	bool l_NoReps = a_RejectEvery && 0 == (a_Host.m_Frames + 1) % a_RejectEvery;
+
+	for (int i = 0; i < INGEST_CHANNELS; i++)
+	{
+		uint8_t l_Channel = (a_Host.m_Next + i) % INGEST_CHANNELS;
+		uint16_t l_InFlight = a_Host.m_Sent[l_Channel] - a_Host.m_Done[l_Channel];
+		uint8_t* l_Out = a_Host.m_Frame;
+		uint8_t l_Sum = 0;
+
+		if (0 == a_Host.m_Capacity[l_Channel] || l_InFlight + INGEST_GROUP > a_Host.m_Capacity[l_Channel])
+			continue;
+
+		*l_Out++ = LEDStream::eStreamSync;
+		*l_Out++ = 1 + INGEST_GROUP * LEDStream::eStepBytes;
+		*l_Out++ = LEDStream::eFrameGroup;
+		*l_Out++ = l_Channel;
+		for (int j = 0; j < INGEST_GROUP; j++)
+		{
+			// flags, repetitions, magnitude, easing, duration
+			*l_Out++ = 0;
+			*l_Out++ = 0 == j && !l_NoReps ? 1 : 0;
+			*l_Out++ = a_Host.m_Level;
+			*l_Out++ = 0;
+			*l_Out++ = 0;
+			*l_Out++ = 1;
+			*l_Out++ = 0;
+			a_Host.m_Level += 37;
+		}
+		for (uint8_t* l_Byte = a_Host.m_Frame + 1; l_Byte < l_Out; l_Byte++)
+			l_Sum += *l_Byte;
+		*l_Out++ = -l_Sum;
+
+		a_Host.m_FrameSize = l_Out - a_Host.m_Frame;
+		a_Host.m_FrameSent = 0;
+		a_Host.m_Sent[l_Channel] += INGEST_GROUP;
+		a_Host.m_Next = l_Channel + 1;
+		++a_Host.m_Frames;
+
+		if (a_CorruptEvery && 0 == a_Host.m_Frames % a_CorruptEvery)
+		{
+			// a flipped bit in the last step's magnitude
+			a_Host.m_Frame[a_Host.m_FrameSize - 6] ^= 0x10;
+			++a_Host.m_Corrupted;
+		}
+		else if (l_NoReps)
+		{
+			++a_Host.m_Rejected;
+		}
+		else
+		{
+			a_Host.m_GoodSteps += INGEST_GROUP;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+* Read back whatever the board has transmitted
+*/
+static void readCredits(IngestHost& a_Host)
+{
+	uint8_t l_Buffer[64];
+	size_t l_Count = Serial.hostDrain(l_Buffer, sizeof(l_Buffer));
+
+	for (size_t i = 0; i < l_Count; i++)
+	{
+		if (0 == a_Host.m_RxCount && LEDStream::eStreamSync != l_Buffer[i])
+			continue;
+		a_Host.m_Rx[a_Host.m_RxCount++] = l_Buffer[i];
+		if (a_Host.m_RxCount < (int)sizeof(a_Host.m_Rx))
+			continue;
+
+		uint8_t l_Sum = 0;
+
+		for (int j = 1; j < (int)sizeof(a_Host.m_Rx); j++)
+			l_Sum += a_Host.m_Rx[j];
+		if (0 == l_Sum && LEDStream::eFrameCredit == a_Host.m_Rx[2] && a_Host.m_Rx[3] < INGEST_CHANNELS)
+		{
+			a_Host.m_Done[a_Host.m_Rx[3]] = a_Host.m_Rx[4] | (a_Host.m_Rx[5] << 8);
+			a_Host.m_Capacity[a_Host.m_Rx[3]] = a_Host.m_Rx[6];
+		}
+		a_Host.m_RxCount = 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Seconds = argc > 1 ? strtoul(argv[1], NULL, 0) : 60;
+	unsigned long l_CorruptEvery = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+	unsigned long l_RejectEvery = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+	unsigned long l_ByteTimes = l_Seconds * (INGEST_BAUD / 10);
+	unsigned long l_Now = 0;
+	IngestHost l_Host;
+	bool l_Ok = true;
+
+	memset(&l_Host, 0, sizeof(l_Host));
+
+	Serial.begin(INGEST_BAUD);
+	s_Runner.setSleep(LedRunner::eSleepOff);
+	s_Stream.begin();
+
+	// one pass of the board's loop() per byte time on the wire
+	for (unsigned long l_Byte = 0; ; l_Byte++)
+	{
+		unsigned long l_Due = (unsigned long long)l_Byte * 1000000 / (INGEST_BAUD / 10);
+		bool l_Sending = l_Byte < l_ByteTimes;
+
+		hostAdvanceMicros(l_Due - l_Now);
+		l_Now = l_Due;
+
+		readCredits(l_Host);
+		if (l_Host.m_FrameSent < l_Host.m_FrameSize || (l_Sending && nextFrame(l_Host, l_CorruptEvery, l_RejectEvery)))
+		{
+			if (Serial.hostInject(&l_Host.m_Frame[l_Host.m_FrameSent], 1))
+				++l_Host.m_Bytes;
+			else
+				++l_Host.m_Overruns;
+			++l_Host.m_FrameSent;
+		}
+
+		s_Runner.service();
+		s_Stream.service();
+
+		if (!l_Sending && l_Host.m_FrameSent == l_Host.m_FrameSize)
+		{
+			bool l_Drained = true;
+
+			for (int i = 0; i < INGEST_CHANNELS; i++)
+				l_Drained &= (l_Host.m_Done[i] == l_Host.m_Sent[i]);
+			if (l_Drained)
+				break;
+			if (l_Byte > l_ByteTimes + INGEST_BAUD)
+			{
+				printf("FAIL credits never came back\n");
+				l_Ok = false;
+				break;
+			}
+		}
+	}
+
+	double l_Steps = s_Stream.getSteps();
+
+	printf("%lu s at %lu baud, %d channels, %d step rings, %d step groups\n", l_Seconds, INGEST_BAUD, INGEST_CHANNELS, INGEST_RING, INGEST_GROUP);
+	printf("%-22s %12.0f\n", "steps/s", l_Steps / l_Seconds);
+	printf("%-22s %11.1f%%\n", "line busy", 100.0 * l_Host.m_Bytes / l_ByteTimes);
+	printf("%-22s %12lu\n", "frames sent", l_Host.m_Frames);
+	printf("%-22s %12lu\n", "frames corrupted", l_Host.m_Corrupted);
+	printf("%-22s %12u\n", "bad frames", s_Stream.getBadFrames());
+	printf("%-22s %12lu\n", "frames without reps", l_Host.m_Rejected);
+	printf("%-22s %12u\n", "rejected frames", s_Stream.getRejected());
+	printf("%-22s %12u\n", "ring overflows", s_Stream.getOverflows());
+	printf("%-22s %12lu\n", "rx overruns", l_Host.m_Overruns);
+
+	if (s_Stream.getSteps() != l_Host.m_GoodSteps || s_Stream.getBadFrames() != l_Host.m_Corrupted ||
+		s_Stream.getRejected() != l_Host.m_Rejected)
+	{
+		printf("FAIL %lu good steps sent, %lu taken\n", l_Host.m_GoodSteps, (unsigned long)s_Stream.getSteps());
+		l_Ok = false;
+	}
+	if (s_Stream.getOverflows() || l_Host.m_Overruns)
+	{
+		printf("FAIL flow control let data through that had no room\n");
+		l_Ok = false;
+	}
+	return l_Ok ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+/**
+* @file lanecheck.cpp
+* @brief checks preempt and resume of the mbed LedStateMachine across
+*  PacketLanes, against a mock SPI with TLC59711s on it
+*
+* Every group is first played on its own, from a reset machine, and the
+* frame the chips show is kept for each tick it plays. Then the groups
+* are queued on their lanes at set ticks, and the frames each one shows
+* while it plays must be the same, tick for tick, however often it was
+* put aside and picked up again. The cases:
+*
+*	- a lane 2 group preempting the lane 0 one on every tick of it, in
+*	  its easings and its steady holds
+*	- nested preemption: lane 1 over lane 0, then lane 2 over lane 1
+*	- a lane 0 group arriving while a lane 1 group is put aside, which
+*	  waits for the lane 1 group to finish
+*	- the side button dismissing the playing group with others put
+*	  aside, which pick up where they stopped
+*
+* Throughout, a group that can preempt shows on the tick it is queued,
+* no group plays while one above its lane is put aside, and at the end
+* every lane is empty and nothing is left put aside.
+*
+* usage: lanecheck
+*/
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "led_state_machine.h"
+
+#define LANECHECK_LANES		3
+#define LANECHECK_SLOTS		16
+#define LANECHECK_MAX_TICKS	5000
+
+DigitalOut g_DisplayPower;
+
+typedef std::string Frame;
+
+/**
+* One step of a group, its levels made from m_Seed
+*/
+struct StepDef
+{
+	uint16_t m_Easing;
+	uint16_t m_Duration;
+	uint8_t m_Seed;
+};
+
+struct GroupDef
+{
+	const char* m_Name;
+	uint8_t m_Lane;
+	uint8_t m_Id;
+	bool m_Preemptable;
+	uint16_t m_Repetitions;
+	const StepDef* m_Steps;
+	uint8_t m_NumSteps;
+};
+
+// every group starts on a step with no easing, so what it shows does not
+// depend on what was shown before it
+static const StepDef s_AmbientSteps[] = { { 0, 6, 1 }, { 40, 15, 2 }, { 25, 0, 3 }, { 0, 10, 4 } };
+static const StepDef s_NoticeSteps[] = { { 0, 3, 5 }, { 20, 8, 6 }, { 12, 0, 7 } };
+static const StepDef s_AlertSteps[] = { { 0, 4, 8 }, { 6, 5, 9 } };
+static const StepDef s_LaterSteps[] = { { 0, 5, 10 }, { 10, 5, 11 } };
+
+#define STEPS(s)	s, sizeof(s)/sizeof(s[0])
+
+enum { eAmbient, eNotice, eAlert, eLater, eGroups };
+
+static const GroupDef s_Groups[eGroups] =
+{
+	{ "ambient",	0, 1, true,		2, STEPS(s_AmbientSteps) },
+	{ "notice",		1, 2, true,		2, STEPS(s_NoticeSteps) },
+	{ "alert",		2, 3, false,	3, STEPS(s_AlertSteps) },
+	{ "later",		0, 4, true,		1, STEPS(s_LaterSteps) },
+};
+
+// queue a group, or press the side button
+struct Event
+{
+	int m_Tick;
+	int m_Group;		// eDismiss to dismiss
+};
+
+enum { eDismiss = -1 };
+
+/**
+* What one group showed while it played
+*/
+struct Played
+{
+	std::vector<Frame> m_Frames;
+	int m_First;		// tick it first showed, -1 if it never did
+	int m_Last;
+};
+
+static int s_Failures = 0;
+
+static void check(bool a_Ok, const char* a_Case, const char* a_What, int a_Tick)
+{
+	if (!a_Ok)
+	{
+		if (s_Failures < 20)
+			printf("FAIL %s, tick %d: %s\n", a_Case, a_Tick, a_What);
+		++s_Failures;
+	}
+}
+
+/**
+* The board: three lanes, the TLC59711s and the state machine
+*/
+struct Board
+{
+	Board(void)
+	{
+		for (int i = 0; i < LANECHECK_LANES; i++)
+			m_Queues[i] = new PacketQueue(m_Slots[i], LANECHECK_SLOTS);
+		m_Lanes = new PacketLanes(m_Queues, LANECHECK_LANES);
+		m_Tlc = new TLC59711Async(m_Spi);
+		m_Machine = new LedStateMachine(*m_Tlc, *m_Lanes);
+	}
+
+	~Board(void)
+	{
+		delete m_Machine;
+		delete m_Tlc;
+		delete m_Lanes;
+		for (int i = 0; i < LANECHECK_LANES; i++)
+			delete m_Queues[i];
+	}
+
+	/**
+	* Put a group's steps on its lane, the producer's way
+	*/
+	void queue(const GroupDef& a_Group)
+	{
+		PacketQueue& l_Queue = *m_Queues[a_Group.m_Lane];
+
+		for (int s = 0; s < a_Group.m_NumSteps; s++)
+		{
+			const StepDef& l_Step = a_Group.m_Steps[s];
+			Packet* l_Packet = l_Queue.reserve();
+			uint8_t l_Flags = 0;
+
+			if (0 == s && a_Group.m_Preemptable)
+				l_Flags |= HeadsUpMessageProtocol::ePreemptable;
+			if (a_Group.m_NumSteps - 1 == s)
+				l_Flags |= HeadsUpMessageProtocol::eLastInGroupMask;
+			l_Packet->hostSet(l_Flags, a_Group.m_Id, a_Group.m_Repetitions, l_Step.m_Easing, l_Step.m_Duration);
+			for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+			{
+				l_Packet->getLeds()[i].setRed(l_Step.m_Seed * 29 + i * 41);
+				l_Packet->getLeds()[i].setGreen(l_Step.m_Seed * 71 + i * 13);
+				l_Packet->getLeds()[i].setBlue(l_Step.m_Seed * 17 + i * 97);
+			}
+		}
+		l_Queue.producerCommit();
+	}
+
+	/**
+	* What the chips show once the wire is quiet
+	*/
+	Frame shown(void)
+	{
+		while (m_Spi.hostBusy())
+			m_Spi.hostComplete();
+		return Frame((const char*)m_Spi.m_Last, m_Spi.m_LastLength);
+	}
+
+	bool idle(void)
+	{
+		if (LedStateMachine::eStateIdle != m_Machine->getState() || m_Machine->getSuspendedLanes())
+			return false;
+		for (int i = 0; i < LANECHECK_LANES; i++)
+		{
+			if (m_Queues[i]->getNumberOfItems())
+				return false;
+		}
+		return true;
+	}
+
+	SPI m_Spi;
+	Packet m_Slots[LANECHECK_LANES][LANECHECK_SLOTS];
+	PacketQueue* m_Queues[LANECHECK_LANES];
+	PacketLanes* m_Lanes;
+	TLC59711Async* m_Tlc;
+	LedStateMachine* m_Machine;
+};
+
+/**
+* The group a tick's frame belongs to: the one playing after it, or the
+* one that finished on it
+*
+* @param [in] a_Before - the group playing before the tick
+* @param [in] a_Shown - the groups that have shown a step
+* @return - index in s_Groups, or -1 for none
+*/
+static int playing(uint8_t a_Before, LedStateMachine& a_Machine, const bool (&a_Shown)[eGroups])
+{
+	uint8_t l_Id = a_Machine.getCurrentGroupId();
+	bool l_Ended = (0xff == l_Id);
+
+	if (l_Ended)
+		l_Id = a_Before;
+	for (int g = 0; g < eGroups; g++)
+	{
+		if (s_Groups[g].m_Id != l_Id)
+			continue;
+
+		// started, but the first step is not out yet
+		switch (a_Machine.getState())
+		{
+			case LedStateMachine::eStateEasing:
+			case LedStateMachine::eStateSteady:
+				return g;
+			case LedStateMachine::eStateMessageBegin:
+				return a_Shown[g] ? g : -1;
+			default:
+				return l_Ended ? g : -1;
+		}
+	}
+	return -1;
+}
+
+/**
+* Play the events through a fresh board until it is idle again
+*
+* @param [in] a_Case - name for the failures
+* @param [out] a_Played - what each group showed
+* @param [out] a_States - the state of the machine before each event, for
+*  the counts
+* @return - false if it never went idle
+*/
+static bool run(const char* a_Case, const Event* a_Events, int a_NumEvents, Played (&a_Played)[eGroups], std::vector<int>* a_States = NULL)
+{
+	Board* l_Board = new Board();
+	LedStateMachine& l_Machine = *l_Board->m_Machine;
+	bool l_Shown[eGroups];
+	uint8_t l_Aside[LANECHECK_LANES];
+	int l_Next = 0;
+	int l_Tick;
+
+	for (int g = 0; g < eGroups; g++)
+	{
+		l_Shown[g] = false;
+		a_Played[g].m_Frames.clear();
+		a_Played[g].m_First = -1;
+		a_Played[g].m_Last = -1;
+	}
+
+	for (l_Tick = 0; l_Tick < LANECHECK_MAX_TICKS; l_Tick++)
+	{
+		uint8_t l_Before = l_Machine.getCurrentGroupId();
+		uint8_t l_Suspended = l_Machine.getSuspendedLanes();
+		uint8_t l_Resumed;
+		int l_Preempting = -1;
+		int l_Group;
+
+		if (l_Next == a_NumEvents && l_Board->idle())
+			break;
+
+		for (; l_Next < a_NumEvents && a_Events[l_Next].m_Tick == l_Tick; l_Next++)
+		{
+			l_Group = a_Events[l_Next].m_Group;
+			if (a_States)
+				a_States->push_back(l_Machine.getState());
+			if (eDismiss == l_Group)
+			{
+				l_Machine.dismissGroup();
+				continue;
+			}
+			// it takes over this tick if it is above a preemptable group
+			if (LedStateMachine::eStateIdle != l_Machine.getState() && l_Machine.isActiveGroupPreemptable() &&
+				s_Groups[l_Group].m_Lane > l_Board->m_Lanes->getLane())
+			{
+				l_Preempting = l_Group;
+			}
+			l_Board->queue(s_Groups[l_Group]);
+		}
+
+		l_Machine.updateState();
+		// note who is put aside in which lane: a group picked up on its
+		// last tick of a steady hold finishes on the tick it comes back
+		l_Resumed = l_Suspended & ~l_Machine.getSuspendedLanes();
+		for (int i = 0; i < LANECHECK_LANES; i++)
+		{
+			if (l_Machine.getSuspendedLanes() & ~l_Suspended & (1 << i))
+				l_Aside[i] = l_Before;
+			if (0xff == l_Before && (l_Resumed & (1 << i)))
+				l_Before = l_Aside[i];
+		}
+		l_Group = playing(l_Before, l_Machine, l_Shown);
+
+		if (l_Group >= 0)
+		{
+			Played& l_Played = a_Played[l_Group];
+
+			if (l_Played.m_First < 0)
+				l_Played.m_First = l_Tick;
+			l_Shown[l_Group] = true;
+			l_Played.m_Last = l_Tick;
+			l_Played.m_Frames.push_back(l_Board->shown());
+		}
+		check(l_Preempting < 0 || l_Preempting == l_Group, a_Case, "preempting group not shown on the tick it came", l_Tick);
+		check(LedStateMachine::eStateIdle == l_Machine.getState() ||
+			0 == (l_Machine.getSuspendedLanes() >> (l_Board->m_Lanes->getLane() + 1)), a_Case,
+			"group playing below one put aside", l_Tick);
+	}
+
+	check(l_Board->idle(), a_Case, "lanes not empty, or a group left put aside", l_Tick);
+	check(0 == l_Board->m_Spi.m_Overlaps && 0 == l_Board->m_Spi.m_Torn, a_Case, "bad transfer on the wire", l_Tick);
+	delete l_Board;
+	return l_Tick < LANECHECK_MAX_TICKS;
+}
+
+/**
+* Check a group showed what it shows when played on its own
+*
+* @param [in] a_Dismissed - it was dismissed, so only the start of it
+*/
+static void compare(const char* a_Case, int a_Group, const Played& a_Played, const Played& a_Alone, bool a_Dismissed = false)
+{
+	const std::vector<Frame>& l_Got = a_Played.m_Frames;
+	const std::vector<Frame>& l_Want = a_Alone.m_Frames;
+	char l_What[80];
+
+	snprintf(l_What, sizeof(l_What), "%s frames differ from played alone", s_Groups[a_Group].m_Name);
+	if (a_Dismissed)
+	{
+		check(l_Got.size() <= l_Want.size() && std::equal(l_Got.begin(), l_Got.end(), l_Want.begin()), a_Case, l_What, a_Played.m_First);
+	}
+	else
+	{
+		check(l_Got == l_Want, a_Case, l_What, a_Played.m_First);
+	}
+}
+
+int main(void)
+{
+	Played l_Alone[eGroups];
+	Played l_Played[eGroups];
+	Played l_Scratch[eGroups];
+	int l_AmbientTicks;
+	unsigned long l_Runs = 0;
+	unsigned long l_InEasing = 0;
+	unsigned long l_InSteady = 0;
+
+	// each group on its own
+	for (int g = 0; g < eGroups; g++)
+	{
+		Event l_Event = { 0, g };
+
+		run("alone", &l_Event, 1, l_Scratch);
+		l_Alone[g] = l_Scratch[g];
+		check(l_Alone[g].m_Frames.size() > 0, "alone", "group never showed", 0);
+	}
+	l_AmbientTicks = l_Alone[eAmbient].m_Last + 1;
+
+	// the alert over the ambient on every tick of it
+	for (int t = 0; t < l_AmbientTicks; t++)
+	{
+		Event l_Events[] = { { 0, eAmbient }, { t, eAlert } };
+		std::vector<int> l_States;
+
+		run("preempt", l_Events, 2, l_Played, &l_States);
+		compare("preempt", eAmbient, l_Played[eAmbient], l_Alone[eAmbient]);
+		compare("preempt", eAlert, l_Played[eAlert], l_Alone[eAlert]);
+		l_InEasing += LedStateMachine::eStateEasing == l_States[1];
+		l_InSteady += LedStateMachine::eStateSteady == l_States[1];
+		++l_Runs;
+	}
+	check(l_InEasing && l_InSteady, "preempt", "never preempted in both an easing and a steady hold", 0);
+
+	// lane 1 over lane 0, then lane 2 over lane 1, a few ticks into it
+	for (int t = 2; t < l_AmbientTicks; t += 3)
+	{
+		for (int d = 0; d < 40; d += 7)
+		{
+			Event l_Events[] = { { 0, eAmbient }, { t, eNotice }, { t + d, eAlert } };
+
+			run("nested", l_Events, 3, l_Played);
+			compare("nested", eAmbient, l_Played[eAmbient], l_Alone[eAmbient]);
+			compare("nested", eNotice, l_Played[eNotice], l_Alone[eNotice]);
+			compare("nested", eAlert, l_Played[eAlert], l_Alone[eAlert]);
+			++l_Runs;
+		}
+	}
+
+	// a lane 0 group comes while the lane 1 one is put aside, and has to
+	// wait for it
+	for (int t = 2; t < l_Alone[eNotice].m_Last; t += 2)
+	{
+		Event l_Events[] = { { 0, eNotice }, { t, eAlert }, { t + 1, eLater } };
+
+		run("lower", l_Events, 3, l_Played);
+		compare("lower", eNotice, l_Played[eNotice], l_Alone[eNotice]);
+		compare("lower", eAlert, l_Played[eAlert], l_Alone[eAlert]);
+		compare("lower", eLater, l_Played[eLater], l_Alone[eLater]);
+		check(l_Played[eLater].m_First > l_Played[eNotice].m_Last, "lower", "lane 0 group started before the lane 1 one put aside", t);
+		++l_Runs;
+	}
+
+	// the side button with groups put aside: the one playing goes, the
+	// ones put aside pick up where they stopped
+	for (int t = 2; t < l_AmbientTicks; t += 5)
+	{
+		for (int d = 1; d < 20; d += 3)
+		{
+			Event l_Alert[] = { { 0, eAmbient }, { t, eAlert }, { t + d, eDismiss } };
+			Event l_Nested[] = { { 0, eAmbient }, { t, eNotice }, { t + 2, eAlert }, { t + 2 + d, eDismiss } };
+
+			run("dismiss", l_Alert, 3, l_Played);
+			compare("dismiss", eAmbient, l_Played[eAmbient], l_Alone[eAmbient]);
+			compare("dismiss", eAlert, l_Played[eAlert], l_Alone[eAlert], true);
+
+			run("dismiss nested", l_Nested, 4, l_Played);
+			compare("dismiss nested", eAmbient, l_Played[eAmbient], l_Alone[eAmbient]);
+			compare("dismiss nested", eNotice, l_Played[eNotice], l_Alone[eNotice]);
+			compare("dismiss nested", eAlert, l_Played[eAlert], l_Alone[eAlert], true);
+			l_Runs += 2;
+		}
+	}
+
+	printf("%lu runs, preempted %lu times easing and %lu steady, %d failures\n", l_Runs, l_InEasing, l_InSteady, s_Failures);
+	return s_Failures ? 1 : 0;
+}
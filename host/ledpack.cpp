@@ -0,0 +1,271 @@
+/**
+* @file ledpack.cpp
+* @brief packs the LEDStep tables of a sketch into the LEDPack.h format
+*
+* Every "LEDStep name[] ... { LEDStep( ... ), ... };" table in the file is
+* read and written out again as a packed uint8_t table, ready to paste
+* over the original and play with LED_PACKED(). Runs are picked greedily:
+* at each step every template length is tried, and the one that covers
+* the most steps per byte wins. Steps that do not repeat are gathered into
+* runs played once.
+*
+* usage: ledpack sketch.ino
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "LEDStateMachine.h"
+
+/**
+* One step as written in the table
+*/
+struct PackStep
+{
+	unsigned m_Flags;
+	unsigned m_Reps;
+	unsigned m_Mag;
+	unsigned m_Easing;
+	unsigned m_Duration;
+};
+
+/**
+* One run of the packed table
+*/
+struct PackRun
+{
+	size_t m_Start;
+	size_t m_Steps;
+	size_t m_Times;
+	uint8_t m_Delta;
+};
+
+static size_t varintSize(unsigned a_Value)
+{
+	return a_Value < 0x80 ? 1 : (a_Value < 0x4000 ? 2 : 3);
+}
+
+static size_t stepSize(const PackStep& a_Step)
+{
+	return 3 + varintSize(a_Step.m_Easing) + varintSize(a_Step.m_Duration);
+}
+
+static size_t runSize(const std::vector<PackStep>& a_Steps, const PackRun& a_Run)
+{
+	size_t l_Size = 3;
+
+	for (size_t i = 0; i < a_Run.m_Steps; i++)
+		l_Size += stepSize(a_Steps[a_Run.m_Start + i]);
+	return l_Size;
+}
+
+/**
+* @return - true if a_Step is a_Template with a_Offset added to its magnitude
+*/
+static bool matches(const PackStep& a_Template, const PackStep& a_Step, uint8_t a_Offset)
+{
+	return a_Template.m_Flags == a_Step.m_Flags && a_Template.m_Reps == a_Step.m_Reps
+		&& a_Template.m_Easing == a_Step.m_Easing && a_Template.m_Duration == a_Step.m_Duration
+		&& (uint8_t)(a_Template.m_Mag + a_Offset) == a_Step.m_Mag;
+}
+
+/**
+* Find how many times the a_Length steps at a_Start repeat
+*/
+static PackRun tryRun(const std::vector<PackStep>& a_Steps, size_t a_Start, size_t a_Length)
+{
+	PackRun l_Run = { a_Start, a_Length, 1, 0 };
+
+	if (a_Start + 2 * a_Length > a_Steps.size())
+		return l_Run;
+
+	l_Run.m_Delta = a_Steps[a_Start + a_Length].m_Mag - a_Steps[a_Start].m_Mag;
+	while (l_Run.m_Times < 255 && a_Start + (l_Run.m_Times + 1) * a_Length <= a_Steps.size())
+	{
+		uint8_t l_Offset = l_Run.m_Delta * l_Run.m_Times;
+		size_t l_Base = a_Start + l_Run.m_Times * a_Length;
+		size_t i;
+
+		for (i = 0; i < a_Length && matches(a_Steps[a_Start + i], a_Steps[l_Base + i], l_Offset); i++)
+			;
+		if (i < a_Length)
+			break;
+		++l_Run.m_Times;
+	}
+	if (1 == l_Run.m_Times)
+		l_Run.m_Delta = 0;
+	return l_Run;
+}
+
+static std::vector<PackRun> pack(const std::vector<PackStep>& a_Steps)
+{
+	std::vector<PackRun> l_Runs;
+	size_t l_Pos = 0;
+
+	while (l_Pos < a_Steps.size())
+	{
+		PackRun l_Best = { l_Pos, 1, 1, 0 };
+		double l_BestScore = 0;
+
+		for (size_t l_Length = 1; l_Length <= 255 && l_Pos + l_Length <= a_Steps.size(); l_Length++)
+		{
+			PackRun l_Run = tryRun(a_Steps, l_Pos, l_Length);
+			double l_Score = (double)(l_Run.m_Steps * l_Run.m_Times) / runSize(a_Steps, l_Run);
+
+			if (l_Run.m_Times > 1 && l_Score > l_BestScore)
+			{
+				l_Best = l_Run;
+				l_BestScore = l_Score;
+			}
+		}
+
+		// nothing repeats here, add the step to the run of singles before it
+		if (1 == l_Best.m_Times && !l_Runs.empty() && 1 == l_Runs.back().m_Times && l_Runs.back().m_Steps < 255)
+			++l_Runs.back().m_Steps;
+		else
+			l_Runs.push_back(l_Best);
+		l_Pos += l_Best.m_Steps * l_Best.m_Times;
+	}
+	return l_Runs;
+}
+
+static std::string varint(unsigned a_Value)
+{
+	char l_Text[32];
+
+	snprintf(l_Text, sizeof(l_Text), "LED_PACK_V%u(%u)", (unsigned)varintSize(a_Value), a_Value);
+	return l_Text;
+}
+
+static std::string flags(unsigned a_Flags)
+{
+	std::string l_Text;
+	char l_Number[8];
+
+	if (a_Flags & eLastInGroup)
+		l_Text = "eLastInGroup";
+	if (a_Flags & eSweep)
+		l_Text += l_Text.empty() ? "eSweep" : " | eSweep";
+	if ((a_Flags & eSweepStepMask) || l_Text.empty())
+	{
+		snprintf(l_Number, sizeof(l_Number), "%u", a_Flags & eSweepStepMask);
+		l_Text += l_Text.empty() ? "" : " | ";
+		l_Text += l_Number;
+	}
+	return l_Text;
+}
+
+static void print(const std::string& a_Name, const std::vector<PackStep>& a_Steps)
+{
+	std::vector<PackRun> l_Runs = pack(a_Steps);
+	size_t l_Bytes = 1;
+
+	for (size_t i = 0; i < l_Runs.size(); i++)
+		l_Bytes += runSize(a_Steps, l_Runs[i]);
+
+	printf("// %u steps, %u bytes packed from %u\n", (unsigned)a_Steps.size(), (unsigned)l_Bytes, (unsigned)(a_Steps.size() * sizeof(LEDStep)));
+	printf("constexpr uint8_t %s[] PROGMEM =\n{\n", a_Name.c_str());
+	for (size_t i = 0; i < l_Runs.size(); i++)
+	{
+		const PackRun& l_Run = l_Runs[i];
+
+		printf("\tLED_PACK_RUN(%u, %u, %d),\n", (unsigned)l_Run.m_Steps, (unsigned)l_Run.m_Times, (int8_t)l_Run.m_Delta);
+		for (size_t j = 0; j < l_Run.m_Steps; j++)
+		{
+			const PackStep& l_Step = a_Steps[l_Run.m_Start + j];
+
+			printf("\t\tLED_PACK_STEP(%s, %u, %u),\t%s,\t%s,\n", flags(l_Step.m_Flags).c_str(), l_Step.m_Reps, l_Step.m_Mag,
+				varint(l_Step.m_Easing).c_str(), varint(l_Step.m_Duration).c_str());
+		}
+	}
+	printf("\tLED_PACK_END\n};\n\n");
+}
+
+/**
+* Read a flags expression: numbers, eLastInGroup and eSweep joined by |
+*/
+static unsigned parseFlags(const std::string& a_Text)
+{
+	unsigned l_Flags = 0;
+	size_t l_Pos = 0;
+
+	while (l_Pos < a_Text.size())
+	{
+		size_t l_End = a_Text.find('|', l_Pos);
+		std::string l_Term = a_Text.substr(l_Pos, l_End == std::string::npos ? std::string::npos : l_End - l_Pos);
+
+		if (l_Term.find("eLastInGroup") != std::string::npos)
+			l_Flags |= eLastInGroup;
+		else if (l_Term.find("eSweep") != std::string::npos)
+			l_Flags |= eSweep;
+		else
+			l_Flags |= strtoul(l_Term.c_str(), NULL, 0);
+		if (l_End == std::string::npos)
+			break;
+		l_Pos = l_End + 1;
+	}
+	return l_Flags;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: ledpack sketch.ino\n");
+		return 2;
+	}
+
+	FILE* l_File = fopen(argv[1], "r");
+	std::string l_Text;
+	char l_Buffer[4096];
+	size_t l_Read;
+
+	if (!l_File)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	while ((l_Read = fread(l_Buffer, 1, sizeof(l_Buffer), l_File)) > 0)
+		l_Text.append(l_Buffer, l_Read);
+	fclose(l_File);
+
+	size_t l_Pos = 0;
+
+	while ((l_Pos = l_Text.find("LEDStep ", l_Pos)) != std::string::npos)
+	{
+		size_t l_NameEnd = l_Text.find('[', l_Pos);
+		size_t l_TableEnd = l_Text.find("};", l_Pos);
+
+		if (l_NameEnd == std::string::npos || l_TableEnd == std::string::npos || l_NameEnd > l_TableEnd)
+		{
+			l_Pos += 8;
+			continue;
+		}
+
+		std::string l_Name = l_Text.substr(l_Pos + 8, l_NameEnd - l_Pos - 8);
+		std::vector<PackStep> l_Steps;
+		size_t l_Entry = l_NameEnd;
+
+		while ((l_Entry = l_Text.find("LEDStep(", l_Entry)) != std::string::npos && l_Entry < l_TableEnd)
+		{
+			size_t l_Close = l_Text.find(')', l_Entry);
+			std::string l_Args = l_Text.substr(l_Entry + 8, l_Close - l_Entry - 8);
+			size_t l_Comma = l_Args.find(',');
+			PackStep l_Step;
+
+			l_Step.m_Flags = parseFlags(l_Args.substr(0, l_Comma));
+			if (4 != sscanf(l_Args.c_str() + l_Comma + 1, " %u , %u , %u , %u", &l_Step.m_Reps, &l_Step.m_Mag, &l_Step.m_Easing, &l_Step.m_Duration))
+			{
+				fprintf(stderr, "%s: can not read LEDStep(%s)\n", argv[1], l_Args.c_str());
+				return 1;
+			}
+			l_Steps.push_back(l_Step);
+			l_Entry = l_Close;
+		}
+		print(l_Name, l_Steps);
+		l_Pos = l_TableEnd;
+	}
+	return 0;
+}
@@ -0,0 +1,434 @@
+/**
+* @file ledsim.cpp
+* @brief plays every Box sketch's tables for hours of show time and records the PWM levels
+*
+* Each state machine of each sketch is run on its own, the real
+* LedStateMachine code from reset(). Ticks where ticksUntilTransition()
+* says nothing changes are skipped with skipTicks(), the way LedRunner
+* does, so a long steady level costs no more than a short one.
+*
+* A trace holds, for every channel, the level on the pin after every
+* tick. Only the changes are stored: the ticks since the previous change
+* as a varint (7 bits a byte, low bits first) and the new level. The
+* level before the first change is 0. A trace file is
+*
+*	"LEDT" version channels period_us[2] ticks[8]
+*	then per channel: changes[4] bytes[4] change data[bytes]
+*
+* all little endian, one file per sketch.
+*
+* usage: ledsim [hours]						run every sketch, print the rate
+*        ledsim record dir [hours]			write dir/<sketch>.ledtrace
+*        ledsim check dir					run again and compare with dir
+*        ledsim show file channel [from s] [s]	print the changes of a channel
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "sketches.h"
+
+typedef std::chrono::steady_clock SimClock;
+
+static const char s_Magic[4] = { 'L', 'E', 'D', 'T' };
+static const uint8_t s_Version = 1;
+
+/**
+* The changes of one channel
+*/
+struct SimChannel
+{
+	std::vector<uint8_t> m_Data;
+	uint32_t m_Changes;
+};
+
+/**
+* A whole trace, as recorded or read back
+*/
+struct SimTrace
+{
+	uint16_t m_Period;
+	uint64_t m_Ticks;
+	std::vector<SimChannel> m_Channels;
+};
+
+/**
+* Reads the changes of a channel back one at a time
+*/
+struct SimReader
+{
+	SimReader(const SimChannel& a_Channel) : m_Data(a_Channel.m_Data), m_Pos(0), m_Tick(0), m_Level(0) {}
+
+	/**
+	* Move on to the next change
+	*
+	* @return - false at the end of the channel
+	*/
+	bool next(void)
+	{
+		uint64_t l_Delta = 0;
+
+		for (int l_Shift = 0; m_Pos < m_Data.size(); l_Shift += 7)
+		{
+			uint8_t l_Byte = m_Data[m_Pos++];
+
+			l_Delta |= (uint64_t)(l_Byte & 0x7f) << l_Shift;
+			if (!(l_Byte & 0x80))
+			{
+				if (m_Pos >= m_Data.size())
+					return false;
+				m_Tick += l_Delta;
+				m_Level = m_Data[m_Pos++];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const std::vector<uint8_t>& m_Data;
+	size_t m_Pos;
+	uint64_t m_Tick;				// tick the level changed on
+	uint8_t m_Level;
+};
+
+static void putVarint(std::vector<uint8_t>& a_Out, uint64_t a_Value)
+{
+	while (a_Value >= 0x80)
+	{
+		a_Out.push_back((uint8_t)(a_Value | 0x80));
+		a_Value >>= 7;
+	}
+	a_Out.push_back((uint8_t)a_Value);
+}
+
+/**
+* Play one state machine from reset() for a_Ticks ticks
+*/
+static void simulate(LedStateMachine& a_Machine, uint64_t a_Ticks, SimChannel& a_Channel)
+{
+	LED& l_LED = a_Machine.getLED();
+	uint64_t l_Tick = 0;
+	uint64_t l_Last = 0;
+	uint8_t l_Level = 0;
+
+	a_Channel.m_Data.clear();
+	a_Channel.m_Changes = 0;
+	a_Machine.reset();
+
+	while (l_Tick < a_Ticks)
+	{
+		uint16_t l_Quiet = a_Machine.ticksUntilTransition();
+
+		if (l_Quiet)
+		{
+			if (l_Quiet > a_Ticks - l_Tick)
+				l_Quiet = a_Ticks - l_Tick;
+			a_Machine.skipTicks(l_Quiet);
+			l_Tick += l_Quiet;
+			continue;
+		}
+
+		a_Machine.updateState();
+		++l_Tick;
+		if (l_LED.getMagnitude() != l_Level)
+		{
+			l_Level = l_LED.getMagnitude();
+			putVarint(a_Channel.m_Data, l_Tick - l_Last);
+			a_Channel.m_Data.push_back(l_Level);
+			l_Last = l_Tick;
+			++a_Channel.m_Changes;
+		}
+	}
+}
+
+/**
+* Play every channel of a sketch
+*
+* @return - ticks a second, all channels counted
+*/
+static double simulate(const HostSketch& a_Host, uint64_t a_Ticks, SimTrace& a_Trace)
+{
+	SimClock::time_point l_Start = SimClock::now();
+
+	a_Trace.m_Period = a_Host.m_Ticker->getPeriod();
+	a_Trace.m_Ticks = a_Ticks;
+	a_Trace.m_Channels.resize(a_Host.m_NumMachines);
+	for (int i = 0; i < a_Host.m_NumMachines; i++)
+	{
+		simulate(*a_Host.m_Machines[i], a_Ticks, a_Trace.m_Channels[i]);
+	}
+
+	double l_Seconds = std::chrono::duration<double>(SimClock::now() - l_Start).count();
+
+	// leave the sketch as it was for anything run after
+	for (int i = 0; i < a_Host.m_NumMachines; i++)
+	{
+		a_Host.m_Machines[i]->reset();
+	}
+	return a_Ticks * a_Host.m_NumMachines / l_Seconds;
+}
+
+static void putLE(FILE* a_File, uint64_t a_Value, int a_Bytes)
+{
+	for (int i = 0; i < a_Bytes; i++)
+	{
+		fputc((uint8_t)(a_Value >> (8 * i)), a_File);
+	}
+}
+
+static bool getLE(FILE* a_File, uint64_t& a_Value, int a_Bytes)
+{
+	a_Value = 0;
+	for (int i = 0; i < a_Bytes; i++)
+	{
+		int l_Byte = fgetc(a_File);
+
+		if (EOF == l_Byte)
+			return false;
+		a_Value |= (uint64_t)l_Byte << (8 * i);
+	}
+	return true;
+}
+
+static bool writeTrace(const std::string& a_Path, const SimTrace& a_Trace)
+{
+	FILE* l_File = fopen(a_Path.c_str(), "wb");
+
+	if (!l_File)
+	{
+		perror(a_Path.c_str());
+		return false;
+	}
+	fwrite(s_Magic, 1, sizeof(s_Magic), l_File);
+	putLE(l_File, s_Version, 1);
+	putLE(l_File, a_Trace.m_Channels.size(), 1);
+	putLE(l_File, a_Trace.m_Period, 2);
+	putLE(l_File, a_Trace.m_Ticks, 8);
+	for (size_t i = 0; i < a_Trace.m_Channels.size(); i++)
+	{
+		const SimChannel& l_Channel = a_Trace.m_Channels[i];
+
+		putLE(l_File, l_Channel.m_Changes, 4);
+		putLE(l_File, l_Channel.m_Data.size(), 4);
+		fwrite(l_Channel.m_Data.data(), 1, l_Channel.m_Data.size(), l_File);
+	}
+	return 0 == fclose(l_File);
+}
+
+static bool readTrace(const std::string& a_Path, SimTrace& a_Trace)
+{
+	FILE* l_File = fopen(a_Path.c_str(), "rb");
+	char l_Magic[sizeof(s_Magic)];
+	uint64_t l_Version = 0, l_Channels = 0, l_Period = 0;
+	bool l_Ok;
+
+	if (!l_File)
+	{
+		perror(a_Path.c_str());
+		return false;
+	}
+	l_Ok = sizeof(l_Magic) == fread(l_Magic, 1, sizeof(l_Magic), l_File) && 0 == memcmp(l_Magic, s_Magic, sizeof(s_Magic))
+		&& getLE(l_File, l_Version, 1) && s_Version == l_Version
+		&& getLE(l_File, l_Channels, 1) && getLE(l_File, l_Period, 2) && getLE(l_File, a_Trace.m_Ticks, 8);
+	a_Trace.m_Period = l_Period;
+	a_Trace.m_Channels.resize(l_Ok ? l_Channels : 0);
+	for (size_t i = 0; l_Ok && i < a_Trace.m_Channels.size(); i++)
+	{
+		SimChannel& l_Channel = a_Trace.m_Channels[i];
+		uint64_t l_Changes, l_Bytes;
+
+		l_Ok = getLE(l_File, l_Changes, 4) && getLE(l_File, l_Bytes, 4);
+		l_Channel.m_Changes = l_Changes;
+		l_Channel.m_Data.resize(l_Ok ? l_Bytes : 0);
+		l_Ok = l_Ok && l_Bytes == fread(l_Channel.m_Data.data(), 1, l_Bytes, l_File);
+	}
+	fclose(l_File);
+	if (!l_Ok)
+	{
+		fprintf(stderr, "%s: not a version %u trace\n", a_Path.c_str(), s_Version);
+	}
+	return l_Ok;
+}
+
+static size_t traceBytes(const SimTrace& a_Trace)
+{
+	size_t l_Bytes = sizeof(s_Magic) + 12;
+
+	for (size_t i = 0; i < a_Trace.m_Channels.size(); i++)
+	{
+		l_Bytes += 8 + a_Trace.m_Channels[i].m_Data.size();
+	}
+	return l_Bytes;
+}
+
+/**
+* Find where two recordings of a channel part
+*
+* @return - false if they differ, with the first tick they differ on printed
+*/
+static bool compare(const char* a_Name, size_t a_Channel, const SimChannel& a_Golden, const SimChannel& a_New, uint16_t a_Period)
+{
+	SimReader l_Golden(a_Golden);
+	SimReader l_New(a_New);
+
+	if (a_Golden.m_Data == a_New.m_Data)
+		return true;
+
+	// walk both until a change is missing or different
+	for (;;)
+	{
+		bool l_MoreGolden = l_Golden.next();
+		bool l_MoreNew = l_New.next();
+
+		if (!l_MoreGolden && !l_MoreNew)
+			return true;
+		if (l_MoreGolden && l_MoreNew && l_Golden.m_Tick == l_New.m_Tick && l_Golden.m_Level == l_New.m_Level)
+			continue;
+
+		// the first tick either side changes level differently
+		uint64_t l_Tick = !l_MoreGolden ? l_New.m_Tick : !l_MoreNew ? l_Golden.m_Tick
+			: (l_Golden.m_Tick < l_New.m_Tick ? l_Golden.m_Tick : l_New.m_Tick);
+
+		printf("%s channel %u: differs from tick %llu (%.2f s)", a_Name, (unsigned)a_Channel, (unsigned long long)l_Tick,
+			(double)l_Tick * a_Period / 1e6);
+		if (l_MoreGolden && l_Golden.m_Tick == l_Tick)
+			printf(", golden goes to %u", l_Golden.m_Level);
+		if (l_MoreNew && l_New.m_Tick == l_Tick)
+			printf(", now goes to %u", l_New.m_Level);
+		printf("\n");
+		return false;
+	}
+}
+
+static void printRate(const char* a_Name, const SimTrace& a_Trace, double a_Rate)
+{
+	unsigned long l_Changes = 0;
+
+	for (size_t i = 0; i < a_Trace.m_Channels.size(); i++)
+	{
+		l_Changes += a_Trace.m_Channels[i].m_Changes;
+	}
+	printf("%-10s %3u %14llu %12lu %12lu %14.1f\n", a_Name, (unsigned)a_Trace.m_Channels.size(), (unsigned long long)a_Trace.m_Ticks,
+		l_Changes, (unsigned long)traceBytes(a_Trace), a_Rate / 1e6);
+}
+
+static uint64_t ticksFor(const HostSketch& a_Host, double a_Hours)
+{
+	return (uint64_t)(a_Hours * 3600e6 / a_Host.m_Ticker->getPeriod());
+}
+
+/**
+* Print the changes of one channel between two times
+*/
+static int show(const char* a_Path, unsigned a_Channel, double a_From, double a_Seconds)
+{
+	SimTrace l_Trace;
+
+	if (!readTrace(a_Path, l_Trace))
+		return 1;
+	if (a_Channel >= l_Trace.m_Channels.size())
+	{
+		fprintf(stderr, "%s has %u channels\n", a_Path, (unsigned)l_Trace.m_Channels.size());
+		return 1;
+	}
+
+	SimReader l_Reader(l_Trace.m_Channels[a_Channel]);
+	uint64_t l_From = (uint64_t)(a_From * 1e6 / l_Trace.m_Period);
+	uint64_t l_To = (uint64_t)((a_From + a_Seconds) * 1e6 / l_Trace.m_Period);
+
+	while (l_Reader.next() && l_Reader.m_Tick < l_To)
+	{
+		if (l_Reader.m_Tick < l_From)
+			continue;
+		printf("%12.2f s %12llu %4u |%.*s\n", (double)l_Reader.m_Tick * l_Trace.m_Period / 1e6,
+			(unsigned long long)l_Reader.m_Tick, l_Reader.m_Level, l_Reader.m_Level / 4,
+			"################################################################");
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* l_Command = argc > 1 ? argv[1] : "";
+	std::string l_Dir;
+	double l_Hours = 1;
+	bool l_Record = false;
+	bool l_Check = false;
+	bool l_Ok = true;
+
+	if (0 == strcmp(l_Command, "show"))
+	{
+		if (argc < 4)
+		{
+			fprintf(stderr, "usage: ledsim show file channel [from s] [s]\n");
+			return 2;
+		}
+		return show(argv[2], strtoul(argv[3], NULL, 0), argc > 4 ? atof(argv[4]) : 0, argc > 5 ? atof(argv[5]) : 60);
+	}
+	if (0 == strcmp(l_Command, "record") || 0 == strcmp(l_Command, "check"))
+	{
+		if (argc < 3)
+		{
+			fprintf(stderr, "usage: ledsim %s dir%s\n", l_Command, 'r' == l_Command[0] ? " [hours]" : "");
+			return 2;
+		}
+		l_Record = 'r' == l_Command[0];
+		l_Check = !l_Record;
+		l_Dir = argv[2];
+		l_Hours = argc > 3 ? atof(argv[3]) : 1;
+	}
+	else if (argc > 1)
+	{
+		l_Hours = atof(argv[1]);
+	}
+
+	printf("%-10s %3s %14s %12s %12s %14s\n", "ledsim", "ch", "ticks", "changes", "bytes", "M ticks/s");
+	for (int l_Sketch = 0; l_Sketch < g_NumHostSketches; l_Sketch++)
+	{
+		const HostSketch& l_Host = g_HostSketches[l_Sketch];
+		std::string l_Path = l_Dir + "/" + l_Host.m_Name + ".ledtrace";
+		SimTrace l_Golden;
+		SimTrace l_Trace;
+		uint64_t l_Ticks = ticksFor(l_Host, l_Hours);
+
+		// a check runs as long as the golden trace did
+		if (l_Check)
+		{
+			if (!readTrace(l_Path, l_Golden))
+			{
+				l_Ok = false;
+				continue;
+			}
+			l_Ticks = l_Golden.m_Ticks;
+		}
+
+		double l_Rate = simulate(l_Host, l_Ticks, l_Trace);
+
+		printRate(l_Host.m_Name, l_Trace, l_Rate);
+		if (l_Record)
+		{
+			l_Ok &= writeTrace(l_Path, l_Trace);
+		}
+		if (l_Check)
+		{
+			if (l_Golden.m_Channels.size() != l_Trace.m_Channels.size())
+			{
+				printf("%s: golden trace has %u channels, the sketch %u\n", l_Host.m_Name,
+					(unsigned)l_Golden.m_Channels.size(), (unsigned)l_Trace.m_Channels.size());
+				l_Ok = false;
+				continue;
+			}
+			for (size_t i = 0; i < l_Trace.m_Channels.size(); i++)
+			{
+				l_Ok &= compare(l_Host.m_Name, i, l_Golden.m_Channels[i], l_Trace.m_Channels[i], l_Trace.m_Period);
+			}
+		}
+	}
+	if (l_Check)
+	{
+		printf("%s\n", l_Ok ? "matches the golden traces" : "FAIL does not match the golden traces");
+	}
+	return l_Ok ? 0 : 1;
+}
@@ -0,0 +1,374 @@
+/**
+* @file ledtrace.cpp
+* @brief decodes the LEDSM_TRACE event stream, and checks it against the pins
+*
+* With a capture of a box's serial port, prints every event in it, one
+* line each: the tick, the LED's pin, the event and its argument. Other
+* output on the port (the sketch's "begin", LedProfile reports) is
+* passed over.
+*
+* Without one, runs every sketch built with LEDSM_TRACE for a_Seconds of
+* simulated time, sending its port out at 115200 baud as loop() comes
+* round, decodes what arrives and checks it: each pin's decoded writes
+* have to be the values the pin went through, at ticks that were run by
+* the loop() pass that changed the pin.
+*
+* usage: ledtrace [seconds]
+*        ledtrace decode capture.bin
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+#include "sketches.h"
+
+#define LEDTRACE_BAUD		115200UL
+
+static const char* const s_EventNames[] =
+{
+	"epoch",
+	"state",
+	"group",
+	"repeat",
+	"write",
+	"lost"
+};
+
+static const char* const s_StateNames[] =
+{
+	"idle",
+	"delay",
+	"begin",
+	"easing",
+	"steady"
+};
+
+/**
+* One event, with its tick count rebuilt
+*/
+struct TraceEvent
+{
+	uint32_t m_Tick;
+	bool m_Known;				// false until the first epoch, m_Tick is only the low 16 bits
+	uint8_t m_Type;
+	uint8_t m_Channel;
+	uint8_t m_Arg;
+};
+
+/**
+* Pulls events out of the bytes coming off the port
+*/
+class TraceDecoder
+{
+public:
+	TraceDecoder(void) : m_Pos(0), m_Len(0), m_Sum(0), m_Epoch(0), m_Known(false), m_Last(0),
+		m_Frames(0), m_BadFrames(0), m_Lost(0) {}
+
+	/**
+	* Take one byte
+	*
+	* @param [in] a_Byte - the byte
+	* @param [out] a_Events - decoded events are added here
+	*/
+	void feed(uint8_t a_Byte, std::vector<TraceEvent>& a_Events)
+	{
+		m_Sum += a_Byte;
+		switch (m_Pos)
+		{
+			case 0:
+				if (LedTrace::eStreamSync == a_Byte)
+				{
+					m_Pos = 1;
+					m_Sum = 0;
+				}
+				return;
+			case 1:
+				m_Len = a_Byte;
+				if (0 == m_Len || m_Len % LedTrace::eEventBytes || m_Len > sizeof(m_Payload))
+				{
+					m_Pos = 0;
+					return;
+				}
+				break;
+			case 2:
+				if (LedTrace::eFrameTrace != a_Byte)
+				{
+					m_Pos = 0;
+					return;
+				}
+				break;
+			default:
+				if (m_Pos - 3 < m_Len)
+				{
+					m_Payload[m_Pos - 3] = a_Byte;
+					break;
+				}
+				m_Pos = 0;
+				if (m_Sum)
+				{
+					++m_BadFrames;
+					return;
+				}
+				++m_Frames;
+				for (unsigned i = 0; i < m_Len; i += LedTrace::eEventBytes)
+				{
+					event(&m_Payload[i], a_Events);
+				}
+				return;
+		}
+		++m_Pos;
+	}
+
+	unsigned long getFrames(void) const { return m_Frames; }
+	unsigned long getBadFrames(void) const { return m_BadFrames; }
+	unsigned long getLost(void) const { return m_Lost; }
+
+protected:
+	void event(const uint8_t* a_Bytes, std::vector<TraceEvent>& a_Events)
+	{
+		TraceEvent l_Event;
+		uint16_t l_Low = a_Bytes[2] | a_Bytes[3] << 8;
+
+		l_Event.m_Type = a_Bytes[0] >> 4;
+		l_Event.m_Channel = a_Bytes[0] & 0x0f;
+		l_Event.m_Arg = a_Bytes[1];
+		if (LedTrace::eTraceEpoch == l_Event.m_Type)
+		{
+			m_Epoch = l_Low;
+			m_Known = true;
+			m_Last = 0;
+			l_Event.m_Tick = (uint32_t)m_Epoch << 16;
+		}
+		else
+		{
+			// an epoch lost with the ring full, the count went past 64k
+			if (l_Low < m_Last)
+				++m_Epoch;
+			m_Last = l_Low;
+			l_Event.m_Tick = (uint32_t)m_Epoch << 16 | l_Low;
+		}
+		if (LedTrace::eTraceLost == l_Event.m_Type)
+			m_Lost += l_Event.m_Arg;
+		l_Event.m_Known = m_Known;
+		a_Events.push_back(l_Event);
+	}
+
+	uint8_t m_Payload[LedTrace::eMaxFrameEvents * LedTrace::eEventBytes];
+	unsigned m_Pos;
+	unsigned m_Len;
+	uint8_t m_Sum;
+	uint16_t m_Epoch;
+	bool m_Known;
+	uint16_t m_Last;
+	unsigned long m_Frames;
+	unsigned long m_BadFrames;
+	unsigned long m_Lost;
+};
+
+static void printEvent(const TraceEvent& a_Event)
+{
+	if (a_Event.m_Known)
+		printf("%10lu ", (unsigned long)a_Event.m_Tick);
+	else
+		printf("%10s ", "?");
+	printf("%3u %-6s ", a_Event.m_Channel, a_Event.m_Type < sizeof(s_EventNames) / sizeof(s_EventNames[0]) ? s_EventNames[a_Event.m_Type] : "?");
+	if (LedTrace::eTraceState == a_Event.m_Type && a_Event.m_Arg < sizeof(s_StateNames) / sizeof(s_StateNames[0]))
+		printf("%s\n", s_StateNames[a_Event.m_Arg]);
+	else if (LedTrace::eTraceEpoch == a_Event.m_Type)
+		printf("\n");
+	else
+		printf("%u\n", a_Event.m_Arg);
+}
+
+/**
+* Print every event in a capture of the port
+*/
+static int decode(const char* a_Path)
+{
+	FILE* l_File = fopen(a_Path, "rb");
+	TraceDecoder l_Decoder;
+	std::vector<TraceEvent> l_Events;
+	int l_Byte;
+
+	if (!l_File)
+	{
+		perror(a_Path);
+		return 1;
+	}
+	while (EOF != (l_Byte = getc(l_File)))
+	{
+		l_Decoder.feed(l_Byte, l_Events);
+		for (size_t i = 0; i < l_Events.size(); i++)
+		{
+			printEvent(l_Events[i]);
+		}
+		l_Events.clear();
+	}
+	fclose(l_File);
+	fprintf(stderr, "%lu frames, %lu bad, %lu events lost\n", l_Decoder.getFrames(), l_Decoder.getBadFrames(), l_Decoder.getLost());
+	return 0;
+}
+
+/**
+* A value a pin went to, and the tick the scheduler was at when it was seen
+*/
+struct PinChange
+{
+	uint32_t m_Tick;
+	uint8_t m_Value;
+};
+
+/**
+* Run one sketch with the wire attached and check the decoded writes
+*
+* @return - true if every pin's writes came through
+*/
+static bool run(const HostSketch& a_Sketch, unsigned long a_Seconds)
+{
+	std::vector<PinChange> l_Pins[HOST_NUM_PINS];
+	int l_Shown[HOST_NUM_PINS];
+	std::vector<TraceEvent> l_Events;
+	TraceDecoder l_Decoder;
+	double l_ByteUs = 10e6 / LEDTRACE_BAUD;
+	double l_Wire = micros();
+	double l_Written = micros();
+	unsigned long l_End = micros() + a_Seconds * 1000000UL;
+	unsigned long l_Bytes = 0;
+	uint8_t l_Byte;
+	bool l_Ok = true;
+
+	for (int i = 0; i < HOST_NUM_PINS; i++)
+	{
+		l_Shown[i] = -1;
+	}
+	for (uint8_t i = 0; i < a_Sketch.m_NumMachines; i++)
+	{
+		a_Sketch.m_Machines[i]->reset();
+	}
+	// idle sleep moves the clock on, and still drains every millisecond
+	a_Sketch.m_Runner->setSleep(LedRunner::eSleepIdle);
+	while (Serial.hostDrain(&l_Byte, 1))
+	{
+	}
+	LedTrace::clear();
+
+	while (micros() < l_End)
+	{
+		a_Sketch.m_Loop();
+
+		// what drain() wrote at the end of the last pass went out while this one ran
+		if (l_Wire < l_Written)
+			l_Wire = l_Written;
+		while (l_Wire + l_ByteUs <= micros() && Serial.hostDrain(&l_Byte, 1))
+		{
+			l_Wire += l_ByteUs;
+			l_Decoder.feed(l_Byte, l_Events);
+			++l_Bytes;
+		}
+		l_Written = micros();
+
+		for (uint8_t i = 0; i < a_Sketch.m_NumMachines; i++)
+		{
+			uint8_t l_Pin = a_Sketch.m_Machines[i]->getLED().getPin();
+
+			if (g_HostPinValues[l_Pin] != l_Shown[l_Pin])
+			{
+				PinChange l_Change = { a_Sketch.m_Ticker->getTicks(), g_HostPinValues[l_Pin] };
+
+				l_Shown[l_Pin] = l_Change.m_Value;
+				l_Pins[l_Pin].push_back(l_Change);
+			}
+		}
+	}
+
+	// let the rest of the ring out
+	for (int l_Idle = 0; l_Idle < 2; )
+	{
+		LedTrace::drain(Serial);
+		l_Idle = Serial.hostDrain(&l_Byte, 1) ? 0 : l_Idle + 1;
+		if (!l_Idle)
+		{
+			l_Decoder.feed(l_Byte, l_Events);
+			++l_Bytes;
+		}
+	}
+
+	// follow each pin through its writes
+	size_t l_Next[HOST_NUM_PINS] = {};
+	uint32_t l_From[HOST_NUM_PINS] = {};
+	int l_Decoded[HOST_NUM_PINS];
+	unsigned long l_Writes = 0;
+
+	for (int i = 0; i < HOST_NUM_PINS; i++)
+	{
+		l_Decoded[i] = -1;
+	}
+	for (size_t i = 0; i < l_Events.size() && l_Ok; i++)
+	{
+		const TraceEvent& l_Event = l_Events[i];
+		uint8_t l_Pin = l_Event.m_Channel;
+
+		if (LedTrace::eTraceWrite != l_Event.m_Type)
+			continue;
+		++l_Writes;
+		if (l_Event.m_Arg == l_Decoded[l_Pin])
+			continue;
+		l_Decoded[l_Pin] = l_Event.m_Arg;
+		if (l_Next[l_Pin] >= l_Pins[l_Pin].size())
+		{
+			printf("FAIL %s pin %u write of %u at tick %lu, the pin never went there\n", a_Sketch.m_Name, l_Pin,
+				l_Event.m_Arg, (unsigned long)l_Event.m_Tick);
+			l_Ok = false;
+			break;
+		}
+
+		const PinChange& l_Change = l_Pins[l_Pin][l_Next[l_Pin]++];
+
+		if (l_Change.m_Value != l_Event.m_Arg || l_Event.m_Tick < l_From[l_Pin] || l_Event.m_Tick >= l_Change.m_Tick)
+		{
+			printf("FAIL %s pin %u write of %u at tick %lu, the pin went to %u before tick %lu\n", a_Sketch.m_Name, l_Pin,
+				l_Event.m_Arg, (unsigned long)l_Event.m_Tick, l_Change.m_Value, (unsigned long)l_Change.m_Tick);
+			l_Ok = false;
+		}
+		l_From[l_Pin] = l_Change.m_Tick;
+	}
+	for (int i = 0; i < HOST_NUM_PINS && l_Ok; i++)
+	{
+		if (l_Next[i] != l_Pins[i].size())
+		{
+			printf("FAIL %s pin %d has %lu changes not in the trace\n", a_Sketch.m_Name, i, (unsigned long)(l_Pins[i].size() - l_Next[i]));
+			l_Ok = false;
+		}
+	}
+	if (l_Decoder.getLost() || l_Decoder.getBadFrames())
+	{
+		printf("FAIL %s lost %lu events, %lu bad frames\n", a_Sketch.m_Name, l_Decoder.getLost(), l_Decoder.getBadFrames());
+		l_Ok = false;
+	}
+
+	printf("%-10s %10lu %10lu %10lu %10lu %8.1f%%\n", a_Sketch.m_Name, (unsigned long)a_Sketch.m_Ticker->getTicks(),
+		(unsigned long)l_Events.size(), l_Writes, l_Bytes, 100.0 * l_Bytes * l_ByteUs / (a_Seconds * 1e6));
+	return l_Ok;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Seconds;
+	bool l_Ok = true;
+
+	if (argc > 2 && 0 == strcmp(argv[1], "decode"))
+	{
+		return decode(argv[2]);
+	}
+
+	l_Seconds = argc > 1 ? strtoul(argv[1], NULL, 0) : 60;
+	Serial.begin(LEDTRACE_BAUD);
+	printf("%lu s at %lu baud, %d event ring\n", l_Seconds, LEDTRACE_BAUD, LEDSM_TRACE_EVENTS);
+	printf("%-10s %10s %10s %10s %10s %9s\n", "sketch", "ticks", "events", "writes", "bytes", "link");
+	for (int i = 0; i < g_NumHostSketches; i++)
+	{
+		l_Ok &= run(g_HostSketches[i], l_Seconds);
+	}
+	return l_Ok ? 0 : 1;
+}
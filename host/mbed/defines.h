@@ -0,0 +1,10 @@
+/**
+* @file defines.h
+* @brief host stand-in for the build options of the mbed firmware, none
+*
+* spsccheck is built with -DPACKET_QUEUE_SPSC instead, every object of it.
+*/
+#ifndef __HOST_DEFINES_H__
+#define __HOST_DEFINES_H__
+
+#endif
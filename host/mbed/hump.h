@@ -0,0 +1,57 @@
+/**
+* @file hump.h
+* @brief host stand-in for the packets of the Heads Up Message Protocol,
+*  as much of them as the LedStateMachine reads
+*/
+#ifndef __HOST_HUMP_H__
+#define __HOST_HUMP_H__
+
+#include <stdint.h>
+#include "rgb_led.h"
+
+namespace HeadsUpMessageProtocol
+{
+	enum
+	{
+		ePreemptable = 0x01,
+		eLastInGroupMask = 0x80
+	};
+}
+
+/**
+* One step of a group: its levels, and how long to ease to them and hold
+*/
+class Packet
+{
+public:
+	Packet(void) : m_Flags(0), m_GroupId(0), m_Repetitions(0), m_Easing(0), m_Duration(0) {}
+
+	uint8_t getFlags(void)				{ return m_Flags;		}
+	uint8_t getGroupId(void)			{ return m_GroupId;		}
+	uint16_t getRepetitions(void)		{ return m_Repetitions;	}
+	uint16_t getEasing(void)			{ return m_Easing;		}
+	uint16_t getDuration(void)			{ return m_Duration;	}
+	RgbLed* getLeds(void)				{ return m_Leds;		}
+
+	/**
+	* Host only - fill the packet in
+	*/
+	void hostSet(uint8_t a_Flags, uint8_t a_GroupId, uint16_t a_Repetitions, uint16_t a_Easing, uint16_t a_Duration)
+	{
+		m_Flags = a_Flags;
+		m_GroupId = a_GroupId;
+		m_Repetitions = a_Repetitions;
+		m_Easing = a_Easing;
+		m_Duration = a_Duration;
+	}
+
+protected:
+	uint8_t m_Flags;
+	uint8_t m_GroupId;
+	uint16_t m_Repetitions;
+	uint16_t m_Easing;
+	uint16_t m_Duration;
+	RgbLed m_Leds[RgbLed::m_NumberOfLeds];
+};
+
+#endif
@@ -0,0 +1,133 @@
+/**
+* @file mbed.h
+* @brief host stand-in for the parts of mbed the TLC59711Async, the
+*  PacketQueue and the LedStateMachine use
+*
+* The SPI is a mock TLC59711 chain. A transfer() is on the wire until
+* host code calls hostComplete(), which runs the callback the way the
+* SPI IRQ would. Inside a critical section the completion stays pending
+* until core_util_critical_section_exit(), as the IRQ would on the part.
+* Every frame is copied when it is started and checked against its
+* buffer when it completes, so a frame changed on the wire is caught.
+*/
+#ifndef __HOST_MBED_H__
+#define __HOST_MBED_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DEVICE_SPI_ASYNCH		1
+#define SPI_EVENT_COMPLETE		(1 << 3)
+
+void core_util_critical_section_enter(void);
+void core_util_critical_section_exit(void);
+
+/**
+* The memory barrier, host code runs on one thread
+*/
+static inline void __DMB(void) { __sync_synchronize(); }
+
+/**
+* A pin, host code reads back the last value written
+*/
+class DigitalOut
+{
+public:
+	DigitalOut(void) : m_Value(0) {}
+
+	DigitalOut& operator=(int a_Value)	{ m_Value = a_Value; return *this; }
+	operator int(void) const			{ return m_Value; }
+
+protected:
+	int m_Value;
+};
+
+/**
+* Just enough of mbed::Callback for an object's member function
+*/
+template <typename F>
+class Callback;
+
+template <typename R, typename A>
+class Callback<R(A)>
+{
+public:
+	Callback(void) : m_Obj(NULL), m_Thunk(NULL) {}
+
+	template <class T>
+	Callback(T* a_Obj, R (T::*a_Method)(A)) : m_Obj(a_Obj), m_Thunk(&thunk<T>)
+	{
+		static_assert(sizeof(a_Method) <= sizeof(m_Method), "member function pointer too big");
+		memcpy(m_Method, &a_Method, sizeof(a_Method));
+	}
+
+	R operator()(A a_Arg) const { return m_Thunk(m_Obj, m_Method, a_Arg); }
+
+protected:
+	template <class T>
+	static R thunk(void* a_Obj, const char* a_Method, A a_Arg)
+	{
+		R (T::*l_Method)(A);
+
+		memcpy(&l_Method, a_Method, sizeof(l_Method));
+		return (static_cast<T*>(a_Obj)->*l_Method)(a_Arg);
+	}
+
+	void* m_Obj;
+	char m_Method[2 * sizeof(void*)];
+	R (*m_Thunk)(void*, const char*, A);
+};
+
+typedef Callback<void(int)> event_callback_t;
+
+/**
+* Mock SPI with a chain of TLC59711s on it
+*/
+class SPI
+{
+public:
+	enum { eMaxFrame = 256 };
+
+	SPI(void);
+
+	template <typename Type>
+	int transfer(const Type* a_Tx, int a_TxLength, Type* a_Rx, int a_RxLength, const event_callback_t& a_Callback, int a_Event = SPI_EVENT_COMPLETE)
+	{
+		(void)a_Rx;
+		(void)a_RxLength;
+		return hostStart((const uint8_t*)a_Tx, a_TxLength * sizeof(Type), a_Callback, a_Event);
+	}
+
+	/**
+	* Host only - the frame on the wire is out, run the callback
+	*/
+	void hostComplete(void);
+
+	/**
+	* Host only - a transfer has been started and not completed
+	*/
+	bool hostBusy(void) const	{ return m_Busy; }
+
+	bool m_CompleteInCritical;			// a transfer on the wire completes as the next critical section is entered
+	uint32_t m_Transfers;				// frames started
+	uint32_t m_Overlaps;				// transfers started while one was on the wire
+	uint32_t m_Torn;					// frames changed while on the wire
+	uint8_t m_Last[eMaxFrame];			// the last frame completed, what the chips show
+	int m_LastLength;
+
+protected:
+	int hostStart(const uint8_t* a_Tx, int a_Length, const event_callback_t& a_Callback, int a_Event);
+
+	bool m_Busy;
+	const uint8_t* m_Tx;
+	int m_Length;
+	int m_Event;
+	uint8_t m_Sent[eMaxFrame];
+	event_callback_t m_Callback;
+};
+
+// the SPI whose completion is held by a critical section
+extern SPI* g_HostSpi;
+
+#endif
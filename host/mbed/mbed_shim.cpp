@@ -0,0 +1,83 @@
+/**
+* @file mbed_shim.cpp
+* @brief implements the host stand-ins in mbed.h
+*/
+#include "mbed.h"
+
+SPI* g_HostSpi = NULL;
+
+static int s_CriticalDepth = 0;
+static bool s_CompletePending = false;
+
+/**
+* Enter a critical section, where the SPI completion is held off
+*/
+void core_util_critical_section_enter(void)
+{
+	++s_CriticalDepth;
+	if (g_HostSpi && g_HostSpi->m_CompleteInCritical)
+		g_HostSpi->hostComplete();
+}
+
+/**
+* Leave a critical section, and run a completion that came in it
+*/
+void core_util_critical_section_exit(void)
+{
+	if (0 == --s_CriticalDepth && s_CompletePending)
+	{
+		s_CompletePending = false;
+		if (g_HostSpi)
+			g_HostSpi->hostComplete();
+	}
+}
+
+SPI::SPI(void) : m_CompleteInCritical(false), m_Transfers(0), m_Overlaps(0), m_Torn(0), m_LastLength(0), m_Busy(false), m_Tx(NULL), m_Length(0), m_Event(0)
+{
+	g_HostSpi = this;
+}
+
+/**
+* Put a frame on the wire, keeping a copy of it
+*
+* @return - 0, or -1 if a frame is already on the wire
+*/
+int SPI::hostStart(const uint8_t* a_Tx, int a_Length, const event_callback_t& a_Callback, int a_Event)
+{
+	++m_Transfers;
+	if (m_Busy || a_Length > eMaxFrame)
+	{
+		++m_Overlaps;
+		return -1;
+	}
+	m_Busy = true;
+	m_Tx = a_Tx;
+	m_Length = a_Length;
+	m_Event = a_Event;
+	m_Callback = a_Callback;
+	memcpy(m_Sent, a_Tx, a_Length);
+	return 0;
+}
+
+/**
+* Finish the frame on the wire and run its callback, unless a critical
+* section holds it off
+*/
+void SPI::hostComplete(void)
+{
+	if (!m_Busy)
+		return;
+	if (s_CriticalDepth)
+	{
+		s_CompletePending = true;
+		return;
+	}
+
+	// what the chips latched is what was in the buffer as it went out
+	if (memcmp(m_Sent, m_Tx, m_Length))
+		++m_Torn;
+	memcpy(m_Last, m_Sent, m_Length);
+	m_LastLength = m_Length;
+	m_Busy = false;
+	m_Callback(m_Event);
+}
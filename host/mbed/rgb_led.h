@@ -0,0 +1,33 @@
+/**
+* @file rgb_led.h
+* @brief host stand-in for the RgbLed of the mbed firmware
+*
+* Six LEDs, so a frame spans two TLC59711s and leaves the last two
+* outputs of the second one unused.
+*/
+#ifndef __HOST_RGB_LED_H__
+#define __HOST_RGB_LED_H__
+
+#include <stdint.h>
+
+class RgbLed
+{
+public:
+	RgbLed(void) : m_Red(0), m_Green(0), m_Blue(0) {}
+
+	uint8_t getRed(void)			{ return m_Red;		}
+	uint8_t getGreen(void)			{ return m_Green;	}
+	uint8_t getBlue(void)			{ return m_Blue;	}
+	void setRed(uint8_t a_Red)		{ m_Red = a_Red;	}
+	void setGreen(uint8_t a_Green)	{ m_Green = a_Green;	}
+	void setBlue(uint8_t a_Blue)	{ m_Blue = a_Blue;	}
+
+	static const int m_NumberOfLeds = 6;
+
+protected:
+	uint8_t m_Red;
+	uint8_t m_Green;
+	uint8_t m_Blue;
+};
+
+#endif
@@ -0,0 +1,16 @@
+/**
+* @file rtos.h
+* @brief host stand-in for the Mutex of mbed's RTOS, host code runs on
+*  one thread
+*/
+#ifndef __HOST_RTOS_H__
+#define __HOST_RTOS_H__
+
+class Mutex
+{
+public:
+	void lock(void)		{}
+	void unlock(void)	{}
+};
+
+#endif
@@ -0,0 +1,225 @@
+/**
+* @file multibox.cpp
+* @brief runs a master box and followers with skewed clocks on one serial link
+*
+* Every box has its own micros() clock, running fast or slow by a few
+* hundred ppm like a crystal, or a few thousand like the ceramic
+* resonator of an Uno, and powered up at its own time. Each box plays
+* Box1's first channel off its own TickScheduler and LedRunner, and loop()
+* comes round every 100 us of its own time, running LedRunner::service()
+* and TickSync::service() as a sketch would, quiet ticks skipped ahead.
+*
+* The master's TickSync frames go out one byte time at a time and land
+* in every follower's receive buffer. Every 10 ms the schedules are
+* compared: how far each follower's next deadline is from the master's
+* for the same tick, in real time. The same boxes are run again with no
+* sync to show how far they drift.
+*
+* usage: multibox [seconds]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Arduino.h"
+#include "TickSync.h"
+#include "sketches.h"
+
+#define MULTIBOX_BAUD		115200UL
+#define MULTIBOX_BOXES		5
+#define MULTIBOX_LOOP_US	100
+#define MULTIBOX_SAMPLE_US	10000
+#define MULTIBOX_SETTLE_S	30
+
+// clock error and power up time of each box, the first is the master
+static const double s_Ppm[MULTIBOX_BOXES] = { 0, 180, -240, 3100, -4700 };
+static const double s_PowerUpUs[MULTIBOX_BOXES] = { 0, 1234567, 350001, 7000000, 2500000 };
+
+/**
+* One board
+*/
+struct SimBox
+{
+	SimBox(const LEDQueue& a_Queue, TickSync::Role a_Role)
+		: m_Queue(a_Queue), m_LED(5), m_Machine(m_LED, m_Queue), m_Ticker(10000),
+		m_Runner(m_Machines, 1, m_Ticker), m_Sync(m_Serial, m_Ticker, a_Role, MULTIBOX_BAUD, &m_Runner)
+	{
+		m_Machines[0] = &m_Machine;
+	}
+
+	LEDQueue m_Queue;
+	LED m_LED;
+	LedStateMachine m_Machine;
+	LedStateMachine* m_Machines[1];
+	TickScheduler m_Ticker;
+	LedRunner m_Runner;
+	HardwareSerial m_Serial;
+	TickSync m_Sync;
+};
+
+/**
+* Phase error of one follower
+*/
+struct PhaseStats
+{
+	double m_Sum2;
+	double m_Max;
+	unsigned long m_Samples;
+	unsigned long m_Mismatch;		// samples with a different LED level from the master
+};
+
+static uint32_t localMicros(int a_Box, double a_Now)
+{
+	return (uint32_t)(uint64_t)((a_Now - s_PowerUpUs[a_Box]) * (1 + s_Ppm[a_Box] * 1e-6));
+}
+
+/**
+* Real time a box's next tick is due at, the one its scheduler fires next
+* even if LedRunner has skipped it far ahead
+*
+* @param [out] a_Tick - the tick's number
+*/
+static double nextDeadline(SimBox& a_Box, int a_Index, double a_Now, uint32_t& a_Tick)
+{
+	int32_t l_Lead = a_Box.m_Ticker.getDeadline() - localMicros(a_Index, a_Now);
+
+	a_Tick = a_Box.m_Ticker.getTicks() + 1;
+	return a_Now + l_Lead / (1 + s_Ppm[a_Index] * 1e-6);
+}
+
+/**
+* Run the boxes for a_Seconds of real time
+*
+* @return - false if a follower never settled
+*/
+static bool run(const LEDQueue& a_Queue, unsigned long a_Seconds, bool a_Sync)
+{
+	SimBox* l_Boxes[MULTIBOX_BOXES];
+	PhaseStats l_Stats[MULTIBOX_BOXES] = {};
+	double l_WireFree = 0;
+	double l_Arrivals[HardwareSerial::m_BufferSize];
+	uint8_t l_Bytes[HardwareSerial::m_BufferSize];
+	int l_InFlight = 0;
+	double l_ByteUs = 10e6 / MULTIBOX_BAUD;
+	double l_NextLoop[MULTIBOX_BOXES];
+	bool l_Ok = true;
+
+	for (int i = 0; i < MULTIBOX_BOXES; i++)
+	{
+		l_Boxes[i] = new SimBox(a_Queue, 0 == i ? TickSync::eMaster : TickSync::eFollower);
+		l_Boxes[i]->m_Serial.begin(MULTIBOX_BAUD);
+		l_Boxes[i]->m_Runner.setSleep(LedRunner::eSleepOff);
+		l_Boxes[i]->m_Machine.reset();
+		l_Boxes[i]->m_Sync.begin();
+		l_NextLoop[i] = s_PowerUpUs[i];
+	}
+
+	for (double l_Now = 0; l_Now < a_Seconds * 1e6; l_Now += MULTIBOX_LOOP_US / 4.0)
+	{
+		// the wire: bytes leave the master's buffer one after the other
+		uint8_t l_Byte;
+
+		while (l_InFlight < HardwareSerial::m_BufferSize && l_Boxes[0]->m_Serial.hostDrain(&l_Byte, 1))
+		{
+			l_WireFree = (l_WireFree > l_Now ? l_WireFree : l_Now) + l_ByteUs;
+			l_Arrivals[l_InFlight] = l_WireFree;
+			l_Bytes[l_InFlight++] = l_Byte;
+		}
+		while (l_InFlight && l_Arrivals[0] <= l_Now)
+		{
+			// boxes that are not up yet miss the byte
+			for (int i = 1; i < MULTIBOX_BOXES && a_Sync; i++)
+			{
+				if (l_Now >= s_PowerUpUs[i])
+					l_Boxes[i]->m_Serial.hostInject(&l_Bytes[0], 1);
+			}
+			for (int j = 1; j < l_InFlight; j++)
+			{
+				l_Arrivals[j - 1] = l_Arrivals[j];
+				l_Bytes[j - 1] = l_Bytes[j];
+			}
+			--l_InFlight;
+		}
+
+		// each box's loop()
+		for (int i = 0; i < MULTIBOX_BOXES; i++)
+		{
+			SimBox& l_Box = *l_Boxes[i];
+
+			if (l_Now < l_NextLoop[i])
+				continue;
+			l_NextLoop[i] += MULTIBOX_LOOP_US / (1 + s_Ppm[i] * 1e-6);
+
+			uint32_t l_Local = localMicros(i, l_Now);
+
+			l_Box.m_Runner.service(l_Local);
+			l_Box.m_Sync.service(l_Local);
+		}
+
+		// compare the schedules once everyone is up and settled
+		if (l_Now >= MULTIBOX_SETTLE_S * 1e6 && MULTIBOX_SAMPLE_US / 2 == fmod(l_Now, MULTIBOX_SAMPLE_US))
+		{
+			uint32_t l_MasterTick;
+			double l_Master = nextDeadline(*l_Boxes[0], 0, l_Now, l_MasterTick);
+
+			for (int i = 1; i < MULTIBOX_BOXES; i++)
+			{
+				uint32_t l_Tick;
+				double l_Error = nextDeadline(*l_Boxes[i], i, l_Now, l_Tick) - l_Master;
+
+				l_Error += ((double)(int32_t)(l_MasterTick - l_Tick)) * l_Boxes[0]->m_Ticker.getPeriod();
+				l_Stats[i].m_Sum2 += l_Error * l_Error;
+				l_Stats[i].m_Max = fabs(l_Error) > l_Stats[i].m_Max ? fabs(l_Error) : l_Stats[i].m_Max;
+				++l_Stats[i].m_Samples;
+				l_Stats[i].m_Mismatch += l_Boxes[i]->m_LED.getMagnitude() != l_Boxes[0]->m_LED.getMagnitude();
+			}
+		}
+	}
+
+	// the master runs the same LedRunner::service() as a sketch, its frames
+	// have to keep coming through the skipped stretches
+	unsigned long l_Expected = a_Seconds * 1000000UL / (TickSync::eDefaultInterval * l_Boxes[0]->m_Ticker.getPeriod());
+
+	printf("%s, %lu s, %lu baud, master sent %lu frames\n", a_Sync ? "TickSync" : "free running", a_Seconds, MULTIBOX_BAUD,
+		(unsigned long)l_Boxes[0]->m_Sync.getSyncs());
+	if (l_Boxes[0]->m_Sync.getSyncs() + 1 < l_Expected)
+	{
+		printf("FAIL the master sent fewer than the %lu frames due\n", l_Expected);
+		l_Ok = false;
+	}
+	printf("    %-4s %8s %10s %12s %12s %8s %8s %10s\n", "box", "ppm", "trim us", "rms us", "max us", "frames", "jumps", "LED diff");
+	for (int i = 1; i < MULTIBOX_BOXES; i++)
+	{
+		double l_Rms = l_Stats[i].m_Samples ? sqrt(l_Stats[i].m_Sum2 / l_Stats[i].m_Samples) : 0;
+
+		printf("    %-4d %8.0f %10.2f %12.1f %12.1f %8lu %8u %9.2f%%\n", i, s_Ppm[i], l_Boxes[i]->m_Ticker.getTrim() / 256.0,
+			l_Rms, l_Stats[i].m_Max, (unsigned long)l_Boxes[i]->m_Sync.getSyncs(), l_Boxes[i]->m_Sync.getJumps(),
+			l_Stats[i].m_Samples ? 100.0 * l_Stats[i].m_Mismatch / l_Stats[i].m_Samples : 0);
+		if (a_Sync && l_Stats[i].m_Max > 1000)
+		{
+			printf("FAIL box %d is more than 1 ms out\n", i);
+			l_Ok = false;
+		}
+	}
+	printf("\n");
+
+	for (int i = 0; i < MULTIBOX_BOXES; i++)
+	{
+		delete l_Boxes[i];
+	}
+	return l_Ok;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Seconds = argc > 1 ? strtoul(argv[1], NULL, 0) : 600;
+	const LEDQueue& l_Queue = g_HostSketches[0].m_Machines[0]->getQueue();
+	bool l_Ok = true;
+
+	if (l_Seconds <= MULTIBOX_SETTLE_S)
+	{
+		l_Seconds = MULTIBOX_SETTLE_S + 1;
+	}
+	run(l_Queue, l_Seconds, false);
+	l_Ok &= run(l_Queue, l_Seconds, true);
+	return l_Ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+* @file pwmcheck.cpp
+* @brief checks PwmPin and LED's LEDSM_DIRECT_PWM output against the mock registers
+*
+* Every Arduino pin gets a PwmPin. The PWM pins must find their compare
+* register and leave everything else alone; writes must land in OCRnx and
+* connect the compare output only while the duty is not 0. Pins without a
+* timer must still go through analogWrite().
+*
+* usage: pwmcheck
+*/
+#define LEDSM_DIRECT_PWM
+#include <stdio.h>
+#include "Arduino.h"
+#include "LEDStateMachine.h"
+
+/**
+* The register a PWM pin should end up on
+*/
+struct PwmExpect
+{
+	uint8_t m_Pin;
+	volatile uint8_t* m_Ocr;
+	volatile uint8_t* m_Tccr;
+	uint8_t m_Com;
+};
+
+static const PwmExpect s_Expect[] =
+{
+	{ 3,	&OCR2B,		&TCCR2A,	_BV(COM2B1) },
+	{ 5,	&OCR0B,		&TCCR0A,	_BV(COM0B1) },
+	{ 6,	&OCR0A,		&TCCR0A,	_BV(COM0A1) },
+	{ 9,	&OCR1AL,	&TCCR1A,	_BV(COM1A1) },
+	{ 10,	&OCR1BL,	&TCCR1A,	_BV(COM1B1) },
+	{ 11,	&OCR2A,		&TCCR2A,	_BV(COM2A1) },
+};
+
+static const uint8_t s_Values[] = { 0, 1, 128, 255, 254, 0, 77 };
+
+static int s_Failures = 0;
+
+static void check(bool a_Ok, const char* a_What, uint8_t a_Pin, uint8_t a_Value)
+{
+	if (!a_Ok)
+	{
+		printf("FAIL pin %u value %u: %s\n", a_Pin, a_Value, a_What);
+		++s_Failures;
+	}
+}
+
+static const PwmExpect* expected(uint8_t a_Pin)
+{
+	for (size_t i = 0; i < sizeof(s_Expect)/sizeof(s_Expect[0]); i++)
+	{
+		if (s_Expect[i].m_Pin == a_Pin)
+			return &s_Expect[i];
+	}
+	return NULL;
+}
+
+/**
+* Write a value through a PwmPin and check where it went
+*/
+static void checkWrite(PwmPin& a_Out, uint8_t a_Value)
+{
+	const PwmExpect* l_Expect = expected(a_Out.getPin());
+	uint8_t l_Io[HOST_IO_SIZE];
+	unsigned long l_Writes = g_HostAnalogWrites;
+
+	for (int i = 0; i < HOST_IO_SIZE; i++)
+		l_Io[i] = g_HostIo[i];
+
+	a_Out.write(a_Value);
+
+	if (NULL == l_Expect)
+	{
+		check(g_HostAnalogWrites == l_Writes + 1, "no analogWrite() fallback", a_Out.getPin(), a_Value);
+		check(g_HostPinValues[a_Out.getPin()] == a_Value, "fallback wrote the wrong value", a_Out.getPin(), a_Value);
+		return;
+	}
+
+	check(g_HostAnalogWrites == l_Writes, "went through analogWrite()", a_Out.getPin(), a_Value);
+	check(*l_Expect->m_Ocr == a_Value, "OCR does not hold the value", a_Out.getPin(), a_Value);
+	check((0 != (*l_Expect->m_Tccr & l_Expect->m_Com)) == (0 != a_Value), "compare output connected wrong", a_Out.getPin(), a_Value);
+
+	// nothing else may change, the other channel of the timer included
+	for (int i = 0; i < HOST_IO_SIZE; i++)
+	{
+		volatile uint8_t* l_Reg = &g_HostIo[i];
+
+		if (l_Reg == l_Expect->m_Ocr)
+			continue;
+		if (l_Reg == l_Expect->m_Tccr)
+			check((l_Io[i] & ~l_Expect->m_Com) == (*l_Reg & ~l_Expect->m_Com), "touched other TCCR bits", a_Out.getPin(), a_Value);
+		else
+			check(l_Io[i] == *l_Reg, "touched another register", a_Out.getPin(), a_Value);
+	}
+}
+
+int main(void)
+{
+	int l_Direct = 0;
+
+	// the Arduino core leaves the timers in PWM mode with the outputs off
+	TCCR0A = 0x03;
+	TCCR1A = 0x01;
+	TCCR2A = 0x01;
+
+	for (uint8_t l_Pin = 0; l_Pin < 14; l_Pin++)
+	{
+		PwmPin l_Out(l_Pin);
+
+		check(l_Out.isDirect() == (NULL != expected(l_Pin)), "wrong register lookup", l_Pin, 0);
+		l_Direct += l_Out.isDirect();
+		for (size_t i = 0; i < sizeof(s_Values); i++)
+		{
+			checkWrite(l_Out, s_Values[i]);
+		}
+	}
+
+	// a LED built with LEDSM_DIRECT_PWM writes the register, and only when its value changed
+	LED l_LED(5);
+
+	l_LED.write();
+	check(0 == OCR0B && !(TCCR0A & _BV(COM0B1)), "LED did not start off", 5, 0);
+	l_LED.setMagnitude(200);
+	check(0 == OCR0B, "LED wrote before write()", 5, 200);
+	check(l_LED.write() && 200 == OCR0B && (TCCR0A & _BV(COM0B1)), "LED write did not reach OCR0B", 5, 200);
+	l_LED.setMagnitude(200);
+	check(!l_LED.write(), "LED wrote an unchanged value", 5, 200);
+
+	printf("%d PWM pins, %d failures\n", l_Direct, s_Failures);
+	return s_Failures ? 1 : 0;
+}
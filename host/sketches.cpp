@@ -0,0 +1,82 @@
+/**
+* @file sketches.cpp
+* @brief builds every Box sketch for the host
+*
+* Each .ino is compiled in its own namespace so the sketches can share one
+* executable. The pin macros differ between sketches, so they are dropped
+* after each one. Every library header a sketch uses has to be included
+* here first, so the sketch's own #include finds it already done instead
+* of declaring the library inside the sketch's namespace.
+*/
+#include "sketches.h"
+#include "LEDCompiler.h"
+#include "LEDPack.h"
+#include "LedProfile.h"
+
+namespace Box1 {
+#include "../Box1/Box1.ino"
+}
+#undef LED0
+#undef LED1
+
+namespace Box2 {
+#include "../Box2/Box2.ino"
+}
+#undef LED0
+#undef LED1
+
+namespace Box3 {
+#include "../Box3/Box3.ino"
+}
+#undef LED0
+#undef LED1
+
+namespace Box4 {
+#include "../Box4/Box4.ino"
+}
+#undef LED0
+#undef LED1
+
+namespace Box5 {
+#include "../Box5/Box5.ino"
+}
+#undef LED0
+#undef LED1
+#undef LED2
+#undef LED3
+#undef LED4
+
+namespace Box6 {
+#include "../Box6/Box6.ino"
+}
+#undef LED0
+#undef LED1
+#undef LED2
+#undef LED3
+#undef LED4
+
+namespace LED2Banks {
+#include "../LED2Banks/LED2Bank.ino"
+}
+#undef LED0
+#undef LED1
+#undef LED2
+#undef LED3
+#undef LED4
+#undef LED5
+
+#define HOST_SKETCH(name, ns)	\
+	{ name, ns::g_Machines, sizeof(ns::g_Machines)/sizeof(ns::g_Machines[0]), &ns::g_Ticker, &ns::g_Runner, ns::loop }
+
+const HostSketch g_HostSketches[] =
+{
+	HOST_SKETCH("Box1", Box1),
+	HOST_SKETCH("Box2", Box2),
+	HOST_SKETCH("Box3", Box3),
+	HOST_SKETCH("Box4", Box4),
+	HOST_SKETCH("Box5", Box5),
+	HOST_SKETCH("Box6", Box6),
+	HOST_SKETCH("LED2Banks", LED2Banks),
+};
+
+const int g_NumHostSketches = sizeof(g_HostSketches)/sizeof(g_HostSketches[0]);
@@ -0,0 +1,27 @@
+/**
+* @file sketches.h
+* @brief gives host tools access to the state machines of every Box sketch
+*/
+#ifndef __HOST_SKETCHES_H__
+#define __HOST_SKETCHES_H__
+
+#include "Arduino.h"
+#include "LedRunner.h"
+
+/**
+* One sketch built for the host, with the state machines it declares
+*/
+struct HostSketch
+{
+	const char* m_Name;
+	LedStateMachine* const* m_Machines;
+	uint8_t m_NumMachines;
+	TickScheduler* m_Ticker;
+	LedRunner* m_Runner;
+	void (*m_Loop)(void);
+};
+
+extern const HostSketch g_HostSketches[];
+extern const int g_NumHostSketches;
+
+#endif
@@ -0,0 +1,227 @@
+/**
+* @file spsccheck.cpp
+* @brief checks the PACKET_QUEUE_SPSC PacketQueue with a producer and a
+*  consumer on threads of their own
+*
+* The producer builds groups of 1 to eSpscMaxGroup packets in place, the
+* way a BLE or UART handler would, now and then reserving a slot too many
+* and giving it back, and commits each group whole. The consumer plays
+* them the way the LedStateMachine does: it waits for a group, gets its
+* packets, walks it with retrieveNextMessage() and releases it. Neither
+* side takes a lock, only the counts and barriers of the queue keep them
+* apart. The consumer checks that
+*
+*	- groups come out whole and in order, none lost or seen twice
+*	- every packet holds what the producer wrote into it, none torn
+*	- retrieveNextMessage() comes back round to the group's first packet
+*	- peek() sees the group's first packet until it is released
+*
+* and the producer that it never gets a slot the consumer still holds.
+* A queue that stops handing out groups for eSpscStallMs fails as well.
+*
+* usage: spsccheck [groups]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include "packet_queue.h"
+
+#ifndef PACKET_QUEUE_SPSC
+#error "spsccheck is built with PACKET_QUEUE_SPSC"
+#endif
+
+enum
+{
+	eSpscSlots = 16,
+	eSpscMaxGroup = 8,
+	eSpscStallMs = 5000
+};
+
+static Packet s_Slots[eSpscSlots];
+static PacketQueue s_Queue(s_Slots, eSpscSlots);
+
+// the slots the consumer holds, for the producer to check against
+static std::atomic<bool> s_Held[eSpscSlots];
+
+static std::atomic<int> s_Failures(0);
+
+// groups played so far, and set when either side gives up
+static std::atomic<unsigned long> s_Played(0);
+static std::atomic<bool> s_Stop(false);
+
+static void check(bool a_Ok, const char* a_What, unsigned long a_Group)
+{
+	if (!a_Ok)
+	{
+		if (s_Failures < 20)
+			printf("FAIL group %lu: %s\n", a_Group, a_What);
+		++s_Failures;
+	}
+}
+
+/**
+* What the producer puts in a packet, from its group and place in it
+*/
+static uint8_t level(unsigned long a_Group, int a_Index, int a_Led, int a_Color)
+{
+	return (uint8_t)(a_Group * 131 + a_Index * 37 + a_Led * 11 + a_Color * 5);
+}
+
+static void fill(Packet* a_Packet, unsigned long a_Group, int a_Index, int a_Length)
+{
+	uint8_t l_Flags = (a_Length - 1 == a_Index) ? HeadsUpMessageProtocol::eLastInGroupMask : 0;
+
+	a_Packet->hostSet(l_Flags, (uint8_t)a_Group, (uint16_t)a_Group, a_Length, a_Index);
+	for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+	{
+		a_Packet->getLeds()[i].setRed(level(a_Group, a_Index, i, 0));
+		a_Packet->getLeds()[i].setGreen(level(a_Group, a_Index, i, 1));
+		a_Packet->getLeds()[i].setBlue(level(a_Group, a_Index, i, 2));
+	}
+}
+
+static bool holds(Packet* a_Packet, unsigned long a_Group, int a_Index, int a_Length)
+{
+	if (a_Packet->getGroupId() != (uint8_t)a_Group || a_Packet->getRepetitions() != (uint16_t)a_Group ||
+		a_Packet->getEasing() != a_Length || a_Packet->getDuration() != a_Index)
+	{
+		return false;
+	}
+	for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+	{
+		if (a_Packet->getLeds()[i].getRed() != level(a_Group, a_Index, i, 0) ||
+			a_Packet->getLeds()[i].getGreen() != level(a_Group, a_Index, i, 1) ||
+			a_Packet->getLeds()[i].getBlue() != level(a_Group, a_Index, i, 2))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void producer(unsigned long a_Groups)
+{
+	unsigned int l_Seed = 1;
+
+	for (unsigned long g = 0; g < a_Groups; g++)
+	{
+		int l_Length = 1 + rand_r(&l_Seed) % eSpscMaxGroup;
+
+		for (int i = 0; i < l_Length; i++)
+		{
+			Packet* l_Slot;
+
+			while (NULL == (l_Slot = s_Queue.reserve()))
+			{
+				if (s_Stop)
+					return;
+				std::this_thread::yield();
+			}
+			check(!s_Held[l_Slot - s_Slots], "producer got a slot the consumer holds", g);
+			fill(l_Slot, g, i, l_Length);
+		}
+
+		// a slot claimed and given back goes nowhere
+		if (0 == rand_r(&l_Seed) % 4)
+		{
+			Packet* l_Spare = s_Queue.reserve();
+
+			if (l_Spare)
+			{
+				l_Spare->hostSet(0, 0xee, 0xeeee, 0xeeee, 0xeeee);
+				s_Queue.unreserve();
+			}
+		}
+		s_Queue.producerCommit();
+	}
+}
+
+static void consumer(unsigned long a_Groups)
+{
+	for (unsigned long g = 0; g < a_Groups; g++)
+	{
+		Packet* l_First;
+		Packet* l_Packet;
+		Packet l_Peeked;
+		int l_Length;
+
+		while (!s_Queue.canGet())
+		{
+			if (s_Stop)
+				return;
+			std::this_thread::yield();
+		}
+
+		check(s_Queue.get(&l_First), "get() failed after canGet()", g);
+		l_Length = l_First->getEasing();
+		check(l_Length >= 1 && l_Length <= eSpscMaxGroup, "group length torn", g);
+		if (l_Length < 1 || l_Length > eSpscMaxGroup)
+		{
+			s_Stop = true;
+			return;
+		}
+		check(holds(l_First, g, 0, l_Length), "first packet wrong", g);
+		s_Held[l_First - s_Slots] = true;
+
+		// the rest of the group is committed with its first packet
+		for (int i = 1; i < l_Length; i++)
+		{
+			check(s_Queue.get(&l_Packet), "group committed in part", g);
+			check(holds(l_Packet, g, i, l_Length), "packet wrong", g);
+			s_Held[l_Packet - s_Slots] = true;
+		}
+
+		// walk it the way the state machine repeats a group
+		l_Packet = l_First;
+		for (int i = 1; i <= l_Length; i++)
+		{
+			l_Packet = s_Queue.retrieveNextMessage(l_Packet);
+			check(holds(l_Packet, g, i % l_Length, l_Length), "retrieveNextMessage() off the group", g);
+		}
+		check(s_Queue.peek(&l_Peeked) && holds(&l_Peeked, g, 0, l_Length), "peek() is not the group's first packet", g);
+
+		l_Packet = l_First;
+		for (int i = 0; i < l_Length; i++)
+		{
+			s_Held[l_Packet - s_Slots] = false;
+			l_Packet = s_Queue.retrieveNextMessage(l_Packet);
+		}
+		s_Queue.consumerRelease();
+		s_Played++;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Groups = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+	std::thread l_Consumer(consumer, l_Groups);
+	std::thread l_Producer(producer, l_Groups);
+
+	unsigned long l_Seen = 0;
+	int l_Still = 0;
+
+	// a queue that lost count leaves both sides waiting on each other
+	while (s_Played < l_Groups && !s_Stop)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		if (l_Seen != s_Played)
+		{
+			l_Seen = s_Played;
+			l_Still = 0;
+		}
+		else if (++l_Still * 10 >= eSpscStallMs)
+		{
+			check(false, "queue stalled", l_Seen);
+			s_Stop = true;
+		}
+	}
+	l_Producer.join();
+	l_Consumer.join();
+	if (!s_Stop)
+		check(s_Queue.isEmpty() && !s_Queue.canGet(), "queue not empty at the end", l_Groups);
+
+	printf("%lu groups through %d slots, %d failures\n", l_Groups, eSpscSlots, s_Failures.load());
+	return s_Failures ? 1 : 0;
+}
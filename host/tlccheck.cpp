@@ -0,0 +1,264 @@
+/**
+* @file tlccheck.cpp
+* @brief checks TLC59711Async against a mock SPI with TLC59711s on it
+*
+* Writes a_Frames frames, some of them the same as the one before as a
+* steady step's would be, and completes the transfers at random points:
+* between calls, or as the driver enters a critical section so the
+* completion runs as it leaves it. Checks that
+*
+*	- no transfer is started while one is on the wire, and no frame is
+*	  changed while it is on it
+*	- every frame that goes out is well formed, and is one that was
+*	  written, never older than the one before it
+*	- two frames in a row are never the same, and writing the frame the
+*	  chips show starts no transfer
+*	- once the wire is quiet the chips show the last frame written
+*
+* usage: tlccheck [frames]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "mbed.h"
+#include "tlc59711_async.h"
+
+#define TLCCHECK_BRIGHTNESS		0x55
+
+typedef RgbLed Frame[RgbLed::m_NumberOfLeds];
+
+static int s_Failures = 0;
+
+static void check(bool a_Ok, const char* a_What, unsigned long a_Frame)
+{
+	if (!a_Ok)
+	{
+		if (s_Failures < 20)
+			printf("FAIL frame %lu: %s\n", a_Frame, a_What);
+		++s_Failures;
+	}
+}
+
+/**
+* The levels as the chips would show them, 8 bits a color
+*/
+struct Levels
+{
+	uint8_t m_Color[RgbLed::m_NumberOfLeds][3];
+
+	bool operator==(const Levels& a_Other) const { return 0 == memcmp(m_Color, a_Other.m_Color, sizeof(m_Color)); }
+};
+
+static Levels levels(Frame& a_Frame)
+{
+	Levels l_Levels;
+
+	for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+	{
+		l_Levels.m_Color[i][0] = a_Frame[i].getRed();
+		l_Levels.m_Color[i][1] = a_Frame[i].getGreen();
+		l_Levels.m_Color[i][2] = a_Frame[i].getBlue();
+	}
+	return l_Levels;
+}
+
+/**
+* Decode what the chain latched, the way the TLC59711s would
+*
+* @return - false if the frame is not well formed
+*/
+static bool decode(const uint8_t* a_Data, int a_Length, Levels& a_Levels)
+{
+	const uint32_t l_Command = ((uint32_t)0x25 << 26) | ((uint32_t)0x16 << 21) |
+		((uint32_t)TLCCHECK_BRIGHTNESS << 14) | ((uint32_t)TLCCHECK_BRIGHTNESS << 7) | TLCCHECK_BRIGHTNESS;
+
+	if (a_Length != TLC59711Async::eFrameBytes)
+		return false;
+
+	// the first chip's data goes out last
+	for (int c = 0; c < TLC59711Async::eChips; c++)
+	{
+		const uint8_t* l_Chip = a_Data + (TLC59711Async::eChips - 1 - c) * TLC59711Async::eChipBytes;
+		uint32_t l_Word = (uint32_t)l_Chip[0] << 24 | (uint32_t)l_Chip[1] << 16 | l_Chip[2] << 8 | l_Chip[3];
+
+		if (l_Word != l_Command)
+			return false;
+
+		// channel 11 (OUTR3) first, two bytes each
+		for (int ch = 0; ch < 12; ch++)
+		{
+			const uint8_t* l_Gs = l_Chip + 4 + (11 - ch) * 2;
+			int l_Led = c * 4 + ch / 3;
+
+			if (l_Gs[0] != l_Gs[1])
+				return false;
+			if (l_Led >= RgbLed::m_NumberOfLeds)
+			{
+				if (l_Gs[0])
+					return false;
+				continue;
+			}
+			// OUTB, OUTG, OUTR
+			a_Levels.m_Color[l_Led][2 - ch % 3] = l_Gs[0];
+		}
+	}
+	return true;
+}
+
+/**
+* Follows what comes off the wire
+*/
+struct Wire
+{
+	SPI m_Spi;
+	std::vector<Levels> m_Written;		// every frame written, in order
+	size_t m_Seen;						// index in m_Written of the last frame out
+	uint32_t m_Completed;
+	Levels m_Last;
+	bool m_HaveLast;
+};
+
+/**
+* Check the frame that went out last, if a new one has
+*/
+static void observe(Wire& a_Wire, unsigned long a_Frame)
+{
+	Levels l_Levels;
+	size_t i;
+
+	if (a_Wire.m_Spi.m_Transfers - a_Wire.m_Spi.hostBusy() == a_Wire.m_Completed)
+		return;
+	a_Wire.m_Completed = a_Wire.m_Spi.m_Transfers - a_Wire.m_Spi.hostBusy();
+
+	if (!decode(a_Wire.m_Spi.m_Last, a_Wire.m_Spi.m_LastLength, l_Levels))
+	{
+		check(false, "frame not well formed", a_Frame);
+		return;
+	}
+	check(!a_Wire.m_HaveLast || !(l_Levels == a_Wire.m_Last), "frame sent twice in a row", a_Frame);
+	a_Wire.m_Last = l_Levels;
+	a_Wire.m_HaveLast = true;
+
+	for (i = a_Wire.m_Seen; i < a_Wire.m_Written.size(); i++)
+	{
+		if (a_Wire.m_Written[i] == l_Levels)
+			break;
+	}
+	check(i < a_Wire.m_Written.size(), "frame out is not one written since the last", a_Frame);
+	if (i < a_Wire.m_Written.size())
+		a_Wire.m_Seen = i;
+}
+
+/**
+* Complete whatever is on the wire until it is quiet
+*/
+static void drain(Wire& a_Wire, unsigned long a_Frame)
+{
+	while (a_Wire.m_Spi.hostBusy())
+	{
+		a_Wire.m_Spi.hostComplete();
+		observe(a_Wire, a_Frame);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long l_Frames = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+	Wire* l_Wire = new Wire();
+	TLC59711Async l_Tlc(l_Wire->m_Spi, TLCCHECK_BRIGHTNESS);
+	Frame l_Frame;
+	uint32_t l_Skipped;
+	uint32_t l_Transfers;
+
+	srand(1);
+	l_Wire->m_Seen = 0;
+	l_Wire->m_Completed = 0;
+	l_Wire->m_HaveLast = false;
+
+	// all off, as LedStateMachine::reset() does
+	l_Tlc.clear();
+	l_Tlc.write();
+	l_Wire->m_Written.push_back(levels(l_Frame));
+
+	for (unsigned long f = 0; f < l_Frames; f++)
+	{
+		int l_Roll = rand() % 8;
+
+		// a third of the frames are the one before, the rest change a
+		// few colors
+		if (rand() % 3)
+		{
+			for (int n = 1 + rand() % 3; n; n--)
+			{
+				RgbLed& l_Led = l_Frame[rand() % RgbLed::m_NumberOfLeds];
+
+				switch (rand() % 3)
+				{
+					case 0: l_Led.setRed(rand()); break;
+					case 1: l_Led.setGreen(rand()); break;
+					default: l_Led.setBlue(rand()); break;
+				}
+			}
+		}
+
+		l_Wire->m_Spi.m_CompleteInCritical = (0 == l_Roll);
+		if (1 == l_Roll)
+		{
+			l_Tlc.clear();
+			for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+				l_Frame[i] = RgbLed();
+		}
+		else
+		{
+			l_Tlc.setLeds(&l_Frame);
+		}
+		if (2 == l_Roll)
+		{
+			l_Wire->m_Spi.hostComplete();
+			observe(*l_Wire, f);
+		}
+		l_Wire->m_Written.push_back(levels(l_Frame));
+		l_Tlc.write();
+		l_Wire->m_Spi.m_CompleteInCritical = false;
+		observe(*l_Wire, f);
+
+		// the wire is mostly quicker than a tick
+		if (l_Roll >= 4)
+		{
+			l_Wire->m_Spi.hostComplete();
+			observe(*l_Wire, f);
+		}
+
+		// now and then hold the last frame, as a steady step does, and
+		// see that it goes nowhere
+		if (0 == f % 1000)
+		{
+			drain(*l_Wire, f);
+			check(l_Wire->m_Last == l_Wire->m_Written.back(), "chips do not show the last frame", f);
+			l_Skipped = l_Tlc.getSkipped();
+			l_Transfers = l_Wire->m_Spi.m_Transfers;
+			for (int i = 0; i < 50; i++)
+			{
+				l_Tlc.setLeds(&l_Frame);
+				l_Tlc.write();
+			}
+			l_Tlc.write();
+			check(l_Wire->m_Spi.m_Transfers == l_Transfers, "steady frame sent again", f);
+			check(l_Tlc.getSkipped() == l_Skipped + 51, "steady frame not skipped", f);
+			l_Wire->m_Written.clear();
+			l_Wire->m_Written.push_back(levels(l_Frame));
+			l_Wire->m_Seen = 0;
+		}
+	}
+	drain(*l_Wire, l_Frames);
+	check(l_Wire->m_Last == l_Wire->m_Written.back(), "chips do not show the last frame", l_Frames);
+	check(0 == l_Wire->m_Spi.m_Overlaps, "transfer started on a busy wire", l_Frames);
+	check(0 == l_Wire->m_Spi.m_Torn, "frame changed on the wire", l_Frames);
+	check(l_Wire->m_Spi.m_Transfers == l_Tlc.getTransfers(), "transfer counts differ", l_Frames);
+
+	printf("%lu frames, %lu transfers, %lu skipped, %d failures\n", l_Frames,
+		(unsigned long)l_Tlc.getTransfers(), (unsigned long)l_Tlc.getSkipped(), s_Failures);
+	delete l_Wire;
+	return s_Failures ? 1 : 0;
+}
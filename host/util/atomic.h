@@ -0,0 +1,29 @@
+/**
+* @file atomic.h
+* @brief host stand-in for util/atomic.h
+*/
+#ifndef __HOST_UTIL_ATOMIC_H__
+#define __HOST_UTIL_ATOMIC_H__
+
+#include <avr/interrupt.h>
+
+/**
+* Put SREG back when an ATOMIC_RESTORESTATE block ends
+*/
+class HostAtomicRestore
+{
+public:
+	HostAtomicRestore(void) : m_Sreg(SREG), m_Once(true) { cli(); }
+	~HostAtomicRestore(void) { if (m_Sreg & _BV(SREG_I)) sei(); }
+
+	bool once(void) { bool l_Once = m_Once; m_Once = false; return l_Once; }
+
+protected:
+	uint8_t m_Sreg;
+	bool m_Once;
+};
+
+#define ATOMIC_RESTORESTATE		HostAtomicRestore
+#define ATOMIC_BLOCK(type)		for (type l_Atomic; l_Atomic.once(); )
+
+#endif
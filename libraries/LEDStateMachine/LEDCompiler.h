@@ -0,0 +1,187 @@
+/**
+* @file LEDCompiler
+* @brief compiles LEDStep tables into LEDPrograms when the sketch is built
+*
+*/
+#ifndef __LEDCOMPILER_H__
+#define __LEDCOMPILER_H__
+
+#include "LEDStateMachine.h"
+
+/**
+* The LEDTableRules class holds the constexpr checks and calculations the
+* compiler runs over a step table. They are recursive because C++11
+* constexpr functions are a single return statement, so a table can have
+* at most ~500 steps before gcc's -fconstexpr-depth needs raising.
+*/
+class LEDTableRules
+{
+public:
+	static constexpr bool isLast(const LEDStep* t, uint16_t i)
+	{
+		return 0 != (t[i].getFlags() & eLastInGroup);
+	}
+
+	/**
+	* The last step has to close a group, otherwise the idle state would
+	* read on into the first group looking for the end
+	*/
+	static constexpr bool endsWithGroup(const LEDStep* t, uint16_t n)
+	{
+		return n > 0 && isLast(t, n - 1);
+	}
+
+	/**
+	* The first step of every group carries the repetitions, 0 would play
+	* the group 65536 times
+	*/
+	static constexpr bool repetitionsSet(const LEDStep* t, uint16_t n, uint16_t i = 0, bool a_Head = true)
+	{
+		return i == n || ((!a_Head || 0 != t[i].getRepetitions()) && repetitionsSet(t, n, i + 1, isLast(t, i)));
+	}
+
+	/**
+	* Groups are counted with a uint8_t
+	*/
+	static constexpr bool groupsFit(const LEDStep* t, uint16_t n, uint16_t i = 0, uint16_t a_Length = 0)
+	{
+		return i == n || (a_Length < 255 && groupsFit(t, n, i + 1, isLast(t, i) ? 0 : a_Length + 1));
+	}
+
+	/**
+	* A step with no easing and no duration would hold for 65536 ticks
+	*/
+	static constexpr bool stepsTimed(const LEDStep* t, uint16_t n, uint16_t i = 0)
+	{
+		return i == n || ((0 != t[i].getEasing() || 0 != t[i].getDuration()) && stepsTimed(t, n, i + 1));
+	}
+
+	static constexpr uint16_t groupCount(const LEDStep* t, uint16_t n, uint16_t i = 0)
+	{
+		return i == n ? 0 : (isLast(t, i) ? 1 : 0) + groupCount(t, n, i + 1);
+	}
+
+	/**
+	* @return - index of the first step of group a_Group
+	*/
+	static constexpr uint16_t groupStart(const LEDStep* t, uint16_t a_Group, uint16_t i = 0)
+	{
+		return 0 == a_Group ? i : groupStart(t, isLast(t, i) ? a_Group - 1 : a_Group, i + 1);
+	}
+
+	/**
+	* @return - number of steps in the group starting at a_Start
+	*/
+	static constexpr uint8_t groupLength(const LEDStep* t, uint16_t a_Start)
+	{
+		return isLast(t, a_Start) ? 1 : 1 + groupLength(t, a_Start + 1);
+	}
+
+	/**
+	* Easing of step i, starting from where the step before it in the table ends
+	*/
+	static constexpr LEDEasingSetup stepSetup(const LEDStep* t, uint16_t n, uint16_t i)
+	{
+		return Easing::prepare(t[(i ? i : n) - 1].getLEDMagnitude(), t[i].getLEDMagnitude(), t[i].getEasing());
+	}
+
+	/**
+	* Group a_Group, including the easing of its first step when it
+	* repeats and so starts from the group's own last step
+	*/
+	static constexpr LEDGroupInfo group(const LEDStep* t, uint16_t a_Group)
+	{
+		return groupInfo(t, groupStart(t, a_Group), groupLength(t, groupStart(t, a_Group)));
+	}
+
+	static constexpr LEDGroupInfo groupInfo(const LEDStep* t, uint16_t a_Start, uint8_t a_Length)
+	{
+		return LEDGroupInfo{ a_Start, a_Length, t[a_Start].getRepetitions(),
+			Easing::prepare(t[a_Start + a_Length - 1].getLEDMagnitude(), t[a_Start].getLEDMagnitude(), t[a_Start].getEasing()) };
+	}
+};
+
+/**
+* A compile time list of indices, for expanding a table one entry at a time
+*/
+template <uint16_t... I>
+struct LEDIndices
+{
+};
+
+template <uint16_t N, uint16_t... I>
+struct LEDMakeIndices : LEDMakeIndices<N - 1, N - 1, I...>
+{
+};
+
+template <uint16_t... I>
+struct LEDMakeIndices<0, I...>
+{
+	typedef LEDIndices<I...> Type;
+};
+
+template <const LEDStep* Table, uint16_t Count, class Indices>
+struct LEDCompiledSetups;
+
+template <const LEDStep* Table, uint16_t Count, uint16_t... I>
+struct LEDCompiledSetups<Table, Count, LEDIndices<I...> >
+{
+	static const LEDEasingSetup m_Data[sizeof...(I)];
+};
+
+template <const LEDStep* Table, uint16_t Count, uint16_t... I>
+const LEDEasingSetup LEDCompiledSetups<Table, Count, LEDIndices<I...> >::m_Data[sizeof...(I)] PROGMEM =
+{
+	LEDTableRules::stepSetup(Table, Count, I)...
+};
+
+template <const LEDStep* Table, class Indices>
+struct LEDCompiledGroups;
+
+template <const LEDStep* Table, uint16_t... I>
+struct LEDCompiledGroups<Table, LEDIndices<I...> >
+{
+	static const LEDGroupInfo m_Data[sizeof...(I)];
+};
+
+template <const LEDStep* Table, uint16_t... I>
+const LEDGroupInfo LEDCompiledGroups<Table, LEDIndices<I...> >::m_Data[sizeof...(I)] PROGMEM =
+{
+	LEDTableRules::group(Table, I)...
+};
+
+/**
+* The LEDCompiler class checks a constexpr step table while the sketch
+* builds, and lays out its group descriptors and per step easing in flash
+* so LEDQueue can start groups and steps without scanning or dividing.
+*
+*	constexpr LEDStep g_LED0Steps[] PROGMEM =
+*	{
+*		LEDStep(	0,				 2,		20,		20,		0 ),
+*		LEDStep(	eLastInGroup,	 0,		77,		20,		0 ),
+*	};
+*	LEDQueue g_LED0Queue(LED_PROGRAM(g_LED0Steps));
+*/
+template <const LEDStep* Table, uint16_t Count>
+class LEDCompiler
+{
+public:
+	static_assert(LEDTableRules::endsWithGroup(Table, Count), "the last step of a table must be flagged eLastInGroup");
+	static_assert(LEDTableRules::repetitionsSet(Table, Count), "the first step of every group needs Reps of 1 or more");
+	static_assert(LEDTableRules::groupsFit(Table, Count), "a group can have at most 255 steps");
+	static_assert(LEDTableRules::stepsTimed(Table, Count), "a step needs a Fade or a Duration");
+
+	static const uint16_t m_NumGroups = LEDTableRules::groupCount(Table, Count);
+
+	typedef LEDCompiledSetups<Table, Count, typename LEDMakeIndices<Count>::Type> Setups;
+	typedef LEDCompiledGroups<Table, typename LEDMakeIndices<m_NumGroups>::Type> Groups;
+
+	static constexpr LEDProgram program(void)
+	{
+		return LEDProgram{ Table, Setups::m_Data, Groups::m_Data, Count, m_NumGroups };
+	}
+};
+
+#define LED_PROGRAM(table)	LEDCompiler<table, sizeof(table)/sizeof(LEDStep)>::program()
+
+#endif
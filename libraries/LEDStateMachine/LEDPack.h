@@ -0,0 +1,179 @@
+/**
+* @file LEDPack
+* @brief packs step tables with runs and varints, checked when the sketch is built
+*
+*/
+#ifndef __LEDPACK_H__
+#define __LEDPACK_H__
+
+#include "LEDStateMachine.h"
+
+/**
+* A packed table is a list of runs and a 0 to end it. A run is a template
+* of steps played a number of times, with a fixed change of magnitude
+* each time round:
+*
+*	steps times delta		the template length (1 - 255), how many times it
+*							plays (1 - 255) and the magnitude added each time
+*	flags reps magnitude easing duration
+*							one step of the template; easing and duration
+*							are varints, 7 bits a byte, low bits first
+*
+* A fade written out a level at a time, 256 steps that only differ by
+* their magnitude, packs into one run of 2 steps played 128 times.
+* host/ledpack writes packed tables from ordinary ones.
+*/
+#define LED_PACK_RUN(steps, times, delta)	(steps), (times), (uint8_t)(delta)
+#define LED_PACK_STEP(flags, reps, mag)		(flags), (reps), (mag)
+#define LED_PACK_END						0
+
+// varints of 1, 2 and 3 bytes, for values below 128, 16384 and 65536
+#define LED_PACK_V1(v)	(uint8_t)((v) & 0x7f)
+#define LED_PACK_V2(v)	(uint8_t)(((v) & 0x7f) | 0x80), (uint8_t)(((v) >> 7) & 0x7f)
+#define LED_PACK_V3(v)	(uint8_t)(((v) & 0x7f) | 0x80), (uint8_t)((((v) >> 7) & 0x7f) | 0x80), (uint8_t)((v) >> 14)
+
+/**
+* The LEDPackRules class walks a packed table at compile time, the same
+* way LEDTableRules checks an ordinary one
+*/
+class LEDPackRules
+{
+public:
+	static constexpr int32_t eBad = -1;
+
+	static constexpr uint16_t varintEnd(const uint8_t* t, uint16_t i)
+	{
+		return (t[i] & 0x80) ? ((t[i + 1] & 0x80) ? i + 3 : i + 2) : i + 1;
+	}
+
+	/**
+	* @return - index of the byte after the step at i
+	*/
+	static constexpr uint16_t stepEnd(const uint8_t* t, uint16_t i)
+	{
+		return varintEnd(t, varintEnd(t, i + 3));
+	}
+
+	/**
+	* A varint has to fit a uint16_t and the last byte of the table
+	*/
+	static constexpr bool varintOk(const uint8_t* t, uint16_t n, uint16_t i)
+	{
+		return i < n && (!(t[i] & 0x80) || (i + 1 < n && (!(t[i + 1] & 0x80) || (i + 2 < n && t[i + 2] < 4))));
+	}
+
+	static constexpr bool stepOk(const uint8_t* t, uint16_t n, uint16_t i)
+	{
+		return i + 3 < n && varintOk(t, n, i + 3) && varintOk(t, n, varintEnd(t, i + 3));
+	}
+
+	/**
+	* @return - index of the byte after a_Steps steps from i, or n if the
+	*  table ends first
+	*/
+	static constexpr uint16_t templateEnd(const uint8_t* t, uint16_t n, uint16_t i, uint8_t a_Steps)
+	{
+		return 0 == a_Steps ? i : (stepOk(t, n, i) ? templateEnd(t, n, stepEnd(t, i), a_Steps - 1) : n);
+	}
+
+	/**
+	* @return - index of the last step of the template at i
+	*/
+	static constexpr uint16_t lastStep(const uint8_t* t, uint16_t i, uint8_t a_Steps)
+	{
+		return 1 == a_Steps ? i : lastStep(t, stepEnd(t, i), a_Steps - 1);
+	}
+
+	/**
+	* @return - number of steps the runs from i on play, or eBad if the
+	*  table is cut short, has an empty run or does not end in a 0
+	*/
+	static constexpr int32_t count(const uint8_t* t, uint16_t n, uint16_t i = 0)
+	{
+		return i >= n ? eBad
+			: 0 == t[i] ? (i + 1 == n ? 0 : eBad)
+			: (i + 3 > n || 0 == t[i + 1]) ? eBad
+			: add((int32_t)t[i] * t[i + 1], count(t, n, templateEnd(t, n, i + 3, t[i])));
+	}
+
+	static constexpr int32_t add(int32_t a_Steps, int32_t a_Rest)
+	{
+		return eBad == a_Rest ? eBad : a_Steps + a_Rest;
+	}
+
+	/**
+	* The table has to end on a step flagged eLastInGroup, same as an
+	* ordinary one
+	*/
+	static constexpr bool endsWithGroup(const uint8_t* t, uint16_t n, uint16_t i = 0)
+	{
+		return 0 == t[templateEnd(t, n, i + 3, t[i])] ? 0 != (t[lastStep(t, i + 3, t[i])] & eLastInGroup)
+			: endsWithGroup(t, n, templateEnd(t, n, i + 3, t[i]));
+	}
+
+	/**
+	* The first step of every group carries the repetitions, same as an
+	* ordinary table. A run played more than once comes back round to its
+	* first step, which starts a group too if the run ends one.
+	*/
+	static constexpr bool repetitionsSet(const uint8_t* t, uint16_t n, uint16_t i = 0, bool a_Head = true)
+	{
+		return 0 == t[i] || (headsSet(t, i + 3, t[i], a_Head)
+			&& (1 == t[i + 1] || headsSet(t, i + 3, t[i], endsGroup(t, i)))
+			&& repetitionsSet(t, n, templateEnd(t, n, i + 3, t[i]), endsGroup(t, i)));
+	}
+
+	/**
+	* @return - true if the last step of the run at i is flagged eLastInGroup
+	*/
+	static constexpr bool endsGroup(const uint8_t* t, uint16_t i)
+	{
+		return 0 != (t[lastStep(t, i + 3, t[i])] & eLastInGroup);
+	}
+
+	/**
+	* @return - false if a step of the template at i that starts a group
+	*  has Reps of 0
+	*/
+	static constexpr bool headsSet(const uint8_t* t, uint16_t i, uint8_t a_Steps, bool a_Head)
+	{
+		return 0 == a_Steps || ((!a_Head || 0 != t[i + 1]) && headsSet(t, stepEnd(t, i), a_Steps - 1, 0 != (t[i] & eLastInGroup)));
+	}
+};
+
+/**
+* The LEDPacker class checks a constexpr packed table while the sketch
+* builds and counts its steps, so LEDQueue does not have to.
+*
+*	constexpr uint8_t g_LED0Steps[] PROGMEM =
+*	{
+*		LED_PACK_RUN(2, 128, -2),
+*		LED_PACK_STEP(0, 1, 255),				LED_PACK_V3(65535),	LED_PACK_V3(65535),
+*		LED_PACK_STEP(eLastInGroup, 0, 254),	LED_PACK_V3(65535),	LED_PACK_V3(65535),
+*		LED_PACK_END
+*	};
+*	LEDQueue g_LED0Queue(LED_PACKED(g_LED0Steps));
+*
+* @note - packed tables are read in order, so they get none of the
+*  LEDCompiler lookups; the easing is worked out as each step starts
+*/
+template <const uint8_t* Table, uint16_t Size>
+class LEDPacker
+{
+public:
+	static constexpr int32_t m_Count = LEDPackRules::count(Table, Size);
+
+	static_assert(m_Count > 0, "a packed table must be whole runs ending in LED_PACK_END");
+	static_assert(m_Count <= 0x7fff, "a packed table can play at most 32767 steps");
+	static_assert(m_Count <= 0 || LEDPackRules::endsWithGroup(Table, Size), "the last step of a table must be flagged eLastInGroup");
+	static_assert(m_Count <= 0 || LEDPackRules::repetitionsSet(Table, Size), "the first step of every group needs Reps of 1 or more");
+
+	static constexpr LEDPacked packed(void)
+	{
+		return LEDPacked{ Table, (uint16_t)m_Count };
+	}
+};
+
+#define LED_PACKED(table)	LEDPacker<table, sizeof(table)>::packed()
+
+#endif
@@ -1,24 +1,28 @@
 
 #include "Arduino.h"
+#include <util/atomic.h>
 #include "LEDStateMachine.h"
 
 
 
-LEDStep::LEDStep(uint8_t a_Flags, uint8_t a_Reps, uint8_t a_Magnitude, uint16_t a_Easing, uint16_t a_Duration)
-	: m_Flags(a_Flags), m_Repetitions(a_Reps), m_LEDMagnitude(a_Magnitude), m_Easing(a_Easing), m_Duration(a_Duration)
-{
-}
-
-
-
 /**
 * Create a LEDQueue object with an array of packets
 *
 * @param a_Buffer - an array of Packets
 * @param a_Count - number of items packet array
+* @param a_Storage - eStorageProgmem if a_Buffer was declared PROGMEM,
+*  eStorageRing if it is an empty, writable array to stream steps into
 */
-LEDQueue::LEDQueue(LEDStep* a_Buffer, int a_Count)
+LEDQueue::LEDQueue(const LEDStep* a_Buffer, int a_Count, StepStorage a_Storage)
+	: m_Storage(a_Storage)
 {
+	if (eStorageRing != a_Storage)
+	{
+		m_Table.m_Setups = NULL;
+		m_Table.m_Groups = NULL;
+		m_Table.m_NumGroups = 0;
+	}
+
 	// Set up the fixed stuff
 	
 	// store pointers to keep track of the queue
@@ -32,6 +36,38 @@ LEDQueue::LEDQueue(LEDStep* a_Buffer, int a_Count)
 	reset();
 }
 
+/**
+* Create a LEDQueue object that plays a compiled table
+*
+* @param a_Program - the table, its groups and easing, all in flash (see LEDCompiler.h)
+*/
+LEDQueue::LEDQueue(const LEDProgram& a_Program)
+	: m_Storage(eStorageProgmem)
+{
+	m_Table.m_Setups = a_Program.m_Setups;
+	m_Table.m_Groups = a_Program.m_Groups;
+	m_Table.m_NumGroups = a_Program.m_NumGroups;
+	m_Head = a_Program.m_Steps;
+	m_Count = a_Program.m_NumSteps;
+
+	reset();
+}
+
+/**
+* Create a LEDQueue object that plays a packed table
+*
+* @param a_Packed - the table, in flash (see LEDPack.h)
+*/
+LEDQueue::LEDQueue(const LEDPacked& a_Packed)
+	: m_Storage(eStoragePacked)
+{
+	m_Packed.m_Bytes = a_Packed.m_Bytes;
+	m_Head = NULL;
+	m_Count = a_Packed.m_NumSteps;
+
+	reset();
+}
+
 /**
 * Destructor
 */
@@ -41,6 +77,8 @@ LEDQueue::~LEDQueue()
 
 /**
 * Reset the queue
+*
+* @note - a ring queue is emptied, its producer must not be running
 */
 void LEDQueue::reset(void)
 {
@@ -48,25 +86,144 @@ void LEDQueue::reset(void)
 	m_GroupCurIndex = 0;
 	m_GroupStartIndex = 0;
 	m_GroupEndIndex = 0;
+	m_Repeating = false;
+
+	switch (m_Storage)
+	{
+		case eStorageRing:
+			m_Ring.m_WrIndex = 0;
+			m_Ring.m_Written = 0;
+			m_Ring.m_Committed = 0;
+			m_Ring.m_Released = 0;
+			m_Ring.m_GroupLength = 0;
+			break;
+		case eStoragePacked:
+			m_Packed.m_Scan.m_Record = m_Packed.m_Bytes;
+			m_Packed.m_Scan.m_Next = m_Packed.m_Bytes + 3;
+			m_Packed.m_Scan.m_Pos = 0;
+			m_Packed.m_Scan.m_Time = 0;
+			m_Packed.m_Scan.m_Offset = 0;
+			m_Packed.m_Walk = m_Packed.m_Scan;
+			m_Packed.m_Mark = m_Packed.m_Scan;
+			break;
+		default:
+			m_Table.m_GroupNumber = 0;
+			break;
+	}
+}
+
+
+/**
+* Read a step out of the table
+*
+* @note - for flash tables the step is copied into m_Step, so the
+*  returned pointer is only good until the next call
+*
+* @param a_Index - index of the step in the table
+* @return pointer to the step
+*/
+const LEDStep* LEDQueue::fetch(int a_Index)
+{
+	if (eStorageProgmem == m_Storage)
+	{
+		memcpy_P(&m_Step, &m_Head[a_Index], sizeof(LEDStep));
+		return &m_Step;
+	}
+	return &m_Head[a_Index];
+}
+
+/**
+* Read a varint of a packed table, 7 bits a byte, low bits first
+*
+* @param a_Next - where it is in flash, moved on past it
+* @return - the value
+*/
+static uint16_t unpackVarint(const uint8_t*& a_Next)
+{
+	uint8_t l_Byte = pgm_read_byte(a_Next++);
+	uint16_t l_Value = l_Byte & 0x7f;
+
+	if (l_Byte & 0x80)
+	{
+		l_Byte = pgm_read_byte(a_Next++);
+		l_Value |= (uint16_t)(l_Byte & 0x7f) << 7;
+		if (l_Byte & 0x80)
+		{
+			l_Value |= (uint16_t)pgm_read_byte(a_Next++) << 14;
+		}
+	}
+	return l_Value;
 }
 
+/**
+* Read the next step of a packed table into m_Step
+*
+* @note - the cost is the same for every step: a run's header, at most
+*  three bytes for each varint and the step's three fixed bytes
+*
+* @param a_Cursor - where to read, moved on to the step after
+* @return pointer to the step, good until the next call
+*/
+const LEDStep* LEDQueue::unpack(LEDPackCursor& a_Cursor)
+{
+	uint8_t l_Flags;
+	uint8_t l_Reps;
+	uint8_t l_Magnitude;
+	uint16_t l_Easing;
+	uint16_t l_Duration;
+
+	if (a_Cursor.m_Pos == pgm_read_byte(a_Cursor.m_Record))
+	{
+		// the template is done, play it again or go on to the next run
+		a_Cursor.m_Pos = 0;
+		if (++a_Cursor.m_Time < pgm_read_byte(a_Cursor.m_Record + 1))
+		{
+			a_Cursor.m_Offset += pgm_read_byte(a_Cursor.m_Record + 2);
+		}
+		else
+		{
+			a_Cursor.m_Record = pgm_read_byte(a_Cursor.m_Next) ? a_Cursor.m_Next : m_Packed.m_Bytes;
+			a_Cursor.m_Time = 0;
+			a_Cursor.m_Offset = 0;
+		}
+		a_Cursor.m_Next = a_Cursor.m_Record + 3;
+	}
+
+	l_Flags = pgm_read_byte(a_Cursor.m_Next++);
+	l_Reps = pgm_read_byte(a_Cursor.m_Next++);
+	l_Magnitude = pgm_read_byte(a_Cursor.m_Next++) + a_Cursor.m_Offset;
+	l_Easing = unpackVarint(a_Cursor.m_Next);
+	l_Duration = unpackVarint(a_Cursor.m_Next);
+	++a_Cursor.m_Pos;
+
+	m_Step = LEDStep(l_Flags, l_Reps, l_Magnitude, l_Easing, l_Duration);
+	return &m_Step;
+}
 
 /**
-* Get an item from the queue in an IRQ handler
+* Read the next step of a group that is read through to eLastInGroup
+*
+* @note - startGroup() calls this for tables without a group index, and
+*  for ring queues once it has seen a group committed
 *
-* @return true if item fetched, false if queue is empty
+* @param a_Start - true for the group's first step, which is marked for
+*  retrieveNextMessage() to come back round to
+* @return pointer to the step, for flash and packed tables only good
+*  until the next read
 */
-LEDStep* LEDQueue::get(bool a_Start)
+const LEDStep* LEDQueue::get(bool a_Start)
 {
-	LEDStep* l_RetVal;
+	const LEDStep* l_RetVal;
 
 	if (a_Start)
 	{
 		m_GroupStartIndex = m_CurIndex;
 		m_GroupCurIndex = m_CurIndex;
+		if (eStoragePacked == m_Storage)
+			m_Packed.m_Mark = m_Packed.m_Scan;
 	}
 
-	l_RetVal = &m_Head[m_CurIndex];
+	l_RetVal = eStoragePacked == m_Storage ? unpack(m_Packed.m_Scan) : fetch(m_CurIndex);
 
 	if (++m_CurIndex >= m_Count)
 		m_CurIndex = 0;
@@ -75,52 +232,390 @@ LEDStep* LEDQueue::get(bool a_Start)
 }
 
 /**
-* Just retrieve the next packet without modifying
-* queue data. Returns a pointer to the next packet
+* Set up the next group to play
+*
+* @note - compiled and indexed tables look the group up, other tables
+*  are read through to the step flagged eLastInGroup
+*
+* @param [out] a_NumInGroup - number of steps in the group
+* @return pointer to the first step of the group, NULL if a ring queue
+*  has nothing committed to play
+*/
+const LEDStep* LEDQueue::startGroup(uint8_t& a_NumInGroup)
+{
+	const LEDStep* l_Msg;
+
+	m_Repeating = false;
+	if (eStorageRing == m_Storage)
+	{
+		bool l_Ready;
+
+		// the group that just played goes back to the producer
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			m_Ring.m_Released += m_Ring.m_GroupLength;
+			l_Ready = (m_Ring.m_Committed != m_Ring.m_Released);
+		}
+		m_Ring.m_GroupLength = 0;
+		if (!l_Ready)
+		{
+			a_NumInGroup = 0;
+			return NULL;
+		}
+	}
+	else if (m_Storage < eStorageRing && m_Table.m_NumGroups)
+	{
+		uint16_t l_Start;
+
+		if (m_Table.m_Setups)
+		{
+			LEDGroupInfo l_Group;
+
+			memcpy_P(&l_Group, &m_Table.m_Groups[m_Table.m_GroupNumber], sizeof(l_Group));
+			l_Start = l_Group.m_Start;
+			a_NumInGroup = l_Group.m_Length;
+			m_Table.m_RepeatSetup = l_Group.m_RepeatSetup;
+		}
+		else
+		{
+			l_Start = m_Table.m_Spans[m_Table.m_GroupNumber].m_Start;
+			a_NumInGroup = m_Table.m_Spans[m_Table.m_GroupNumber].m_Length;
+		}
+		if (++m_Table.m_GroupNumber >= m_Table.m_NumGroups)
+			m_Table.m_GroupNumber = 0;
+
+		m_GroupStartIndex = l_Start;
+		m_GroupCurIndex = l_Start;
+		m_CurIndex = l_Start + a_NumInGroup;
+		if (m_CurIndex >= m_Count)
+			m_CurIndex = 0;
+		m_GroupEndIndex = m_CurIndex;
+		return fetch(m_GroupStartIndex);
+	}
+
+	a_NumInGroup = 0;
+	do
+	{
+		l_Msg = get(0 == a_NumInGroup++);
+	} while (!(l_Msg->getFlags() & eLastInGroup));
+	SetEndIndex();
+	if (eStorageRing == m_Storage)
+		m_Ring.m_GroupLength = a_NumInGroup;
+
+	// flash tables only have one staging copy, so read the first step again
+	if (eStoragePacked == m_Storage)
+	{
+		m_Packed.m_Walk = m_Packed.m_Mark;
+		return unpack(m_Packed.m_Walk);
+	}
+	return fetch(m_GroupStartIndex);
+}
+
+/**
+* Move on to the next step of the group playing, back round to its
+* first step after the last one
 *
-* @note This is bit complicated.
-*  m_ProdRdIndex is the first packet of the group
-*  m_ConRdIndex is the packet past the last packet of the group
+* @note - startGroup() leaves m_GroupStartIndex on the group's first
+*  step and m_GroupEndIndex on the step past its last, whatever the
+*  storage. Coming back round sets m_Repeating for getEasingSetup()
 *
-* @param packet pointer to the current packet
-* @return pointer to the next packet (possibly wrapped around)
+* @return pointer to the step, for flash and packed tables only good
+*  until the next read
 */
-LEDStep* LEDQueue::retrieveNextMessage(void)
+const LEDStep* LEDQueue::retrieveNextMessage(void)
 {
 	if (++m_GroupCurIndex >= m_Count)
 		m_GroupCurIndex = 0;
 
-	if (m_GroupCurIndex == m_GroupEndIndex)
+	m_Repeating = (m_GroupCurIndex == m_GroupEndIndex);
+	if (m_Repeating)
+	{
 		m_GroupCurIndex = m_GroupStartIndex;
+		if (eStoragePacked == m_Storage)
+			m_Packed.m_Walk = m_Packed.m_Mark;
+	}
+
+	return eStoragePacked == m_Storage ? unpack(m_Packed.m_Walk) : fetch(m_GroupCurIndex);
+}
+
+/**
+* Get the precomputed easing of the current step
+*
+* @note - the setup assumes the step starts from the magnitude the step
+*  before it in the table (or the group, when it repeats) ends on
+*
+* @param [out] a_Setup - the easing parameters
+* @return true for compiled tables, false if the caller has to work it out
+*/
+bool LEDQueue::getEasingSetup(LEDEasingSetup& a_Setup)
+{
+	if (m_Storage >= eStorageRing || NULL == m_Table.m_Setups)
+		return false;
+
+	if (m_Repeating)
+		a_Setup = m_Table.m_RepeatSetup;
+	else
+		memcpy_P(&a_Setup, &m_Table.m_Setups[m_GroupCurIndex], sizeof(a_Setup));
+	return true;
+}
+
+
+
+
+
+/**
+* Index the groups of an ordinary table, once, when it is loaded. After
+* this startGroup() looks each group up instead of reading through it,
+* and selectGroup() can pick any of them
+*
+* @note - only for eStorageRam and eStorageProgmem tables: compiled
+*  tables come with their index in flash (see LEDCompiler.h), packed ones
+*  can only be read in order and a ring changes as it plays. The index
+*  is used in place, so a_Index has to last as long as the queue
+*
+* @param [out] a_Index - room for the index, a_Max groups
+* @param [in] a_Max - number of groups a_Index can hold
+* @return - number of groups indexed, 0 if the table cannot be indexed
+*  or has more than a_Max groups, and the queue reads through it as before
+*/
+uint16_t LEDQueue::indexGroups(LEDGroupSpan* a_Index, uint16_t a_Max)
+{
+	uint16_t l_Groups = 0;
+	uint16_t l_Next = 0;
+	int l_Start = 0;
+
+	if (m_Storage >= eStorageRing || m_Table.m_Setups)
+		return 0;
+
+	for (int i = 0; i < m_Count; i++)
+	{
+		const LEDStep* l_Step = fetch(i);
+
+		if (i == l_Start)
+		{
+			if (l_Groups == a_Max)
+				return 0;
+			a_Index[l_Groups].m_Start = i;
+			if (i == m_CurIndex)
+				l_Next = l_Groups;
+		}
+		if (l_Step->getFlags() & eLastInGroup)
+		{
+			// groups are counted with a uint8_t
+			if (i - l_Start >= 255)
+				return 0;
+			a_Index[l_Groups++].m_Length = i - l_Start + 1;
+			l_Start = i + 1;
+		}
+	}
+
+	// the last step has to close a group, as LEDCompiler checks
+	if (l_Start != m_Count)
+		return 0;
+
+	m_Table.m_Spans = a_Index;
+	m_Table.m_NumGroups = l_Groups;
+	m_Table.m_GroupNumber = l_Next;
+	return l_Groups;
+}
+
+/**
+* Make a_Group the next group startGroup() plays, the ones after it
+* follow in order
+*
+* @param [in] a_Group - number of the group, 0 for the first in the table
+* @return - false if the queue has no index or no such group
+*/
+bool LEDQueue::selectGroup(uint16_t a_Group)
+{
+	if (a_Group >= getNumGroups())
+		return false;
+
+	m_Table.m_GroupNumber = a_Group;
+	return true;
+}
+
+/**
+* Claim the next free step of a ring queue, for the producer to fill in
+*
+* @return the step, or NULL if the ring is full
+*/
+LEDStep* LEDQueue::reserve(void)
+{
+	LEDStep* l_Slot;
+
+	if (0 == getFree())
+		return NULL;
+
+	l_Slot = const_cast<LEDStep*>(&m_Head[m_Ring.m_WrIndex]);
+	if (++m_Ring.m_WrIndex >= m_Count)
+		m_Ring.m_WrIndex = 0;
+	++m_Ring.m_Written;
+	return l_Slot;
+}
+
+/**
+* Give back the last step claimed by reserve() that is not committed yet
+*/
+void LEDQueue::unreserve(void)
+{
+	if (m_Ring.m_Written == m_Ring.m_Committed)
+		return;
+
+	if (0 == m_Ring.m_WrIndex)
+		m_Ring.m_WrIndex = m_Count;
+	--m_Ring.m_WrIndex;
+	--m_Ring.m_Written;
+}
+
+/**
+* Let the state machine see every step reserved so far
+*
+* @note - the last step committed has to be flagged eLastInGroup
+*/
+void LEDQueue::producerCommit(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		m_Ring.m_Committed = m_Ring.m_Written;
+	}
+}
+
+/**
+* Find out how many steps the producer can reserve
+*
+* @return - number of free steps in the ring
+*/
+uint16_t LEDQueue::getFree(void)
+{
+	return m_Count - (uint16_t)(m_Ring.m_Written - getReleased());
+}
+
+/**
+* Getter for the m_Released
+*
+* @return - number of steps played and handed back, it wraps at 65536
+*/
+uint16_t LEDQueue::getReleased(void)
+{
+	uint16_t l_Released;
 
-	return &m_Head[m_GroupCurIndex];
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		l_Released = m_Ring.m_Released;
+	}
+	return l_Released;
+}
+
+/**
+* Count how many more calc() calls will leave the LED where it is
+*
+* @param [in] a_Limit - the most ticks the caller is interested in
+* @return - number of calc() calls before the output changes, at most a_Limit
+*/
+uint16_t Easing::ticksUntilChange(uint16_t a_Limit)
+{
+	uint32_t l_Ticks;
+
+#ifdef LEDSM_EXACT_EASING
+	// the LED is not showing the easing yet (first tick after init)
+	if (m_State.m_Value != m_LED->getMagnitude())
+		return 0;
+
+	// moving every tick, or about to carry
+	if (m_Setup.m_Step || m_State.m_Error >= m_Setup.m_Back)
+		return 0;
+
+	if (0 == m_Setup.m_Rem)
+		return a_Limit;
+
+	// calls until the error carries
+	l_Ticks = ((uint32_t)m_Setup.m_Back - m_State.m_Error + m_Setup.m_Rem - 1) / m_Setup.m_Rem;
+#else
+	// the LED is not showing the accumulator yet (first tick after calcFirst/init)
+	if ((uint8_t)(m_State >> 15) != m_LED->getMagnitude())
+		return 0;
+
+	if (0 == m_Setup)
+		return a_Limit;
+
+	// distance to the next 1/32768 boundary in the direction of travel
+	if (m_Setup > 0)
+		l_Ticks = (0x7fff - (m_State & 0x7fff)) / (uint32_t)m_Setup;
+	else
+		l_Ticks = (m_State & 0x7fff) / (uint32_t)-m_Setup;
+#endif
+
+	return (l_Ticks < a_Limit) ? l_Ticks : a_Limit;
 }
 
+/**
+* Advance the easing as if calc() had been called a_Ticks times,
+* without touching the LED
+*
+* @param [in] a_Ticks - number of calc() calls to account for, no more than ticksUntilChange()
+*/
+void Easing::skip(uint16_t a_Ticks)
+{
+	m_Times += a_Ticks;
+#ifdef LEDSM_EXACT_EASING
+	// none of them carry
+	m_State.m_Error += (uint32_t)a_Ticks * m_Setup.m_Rem;
+#else
+	m_State += (int32_t)a_Ticks * m_Setup;
+#endif
+}
 
+/**
+* Advance the easing as if calc() had been called a_Ticks times, carries
+* and all, and show the magnitude it got to
+*
+* @param [in] a_Ticks - number of calc() calls, no more than are left in the easing
+*/
+void Easing::advance(uint16_t a_Ticks)
+{
+	m_Times += a_Ticks;
+#ifdef LEDSM_EXACT_EASING
+	// each tick adds m_Rem to the error, modulo the easing time, and
+	// carries whenever it wraps
+	uint16_t l_Time = m_Setup.m_Rem + m_Setup.m_Back;
 
+	if (l_Time)
+	{
+		uint32_t l_Error = m_State.m_Error + (uint32_t)a_Ticks * m_Setup.m_Rem;
 
+		m_State.m_Value += (uint8_t)a_Ticks * m_Setup.m_Step + (uint8_t)(l_Error / l_Time) * m_Setup.m_Unit;
+		m_State.m_Error = l_Error % l_Time;
+	}
+	m_LED->setMagnitude(m_State.m_Value);
+#else
+	m_State += (int32_t)a_Ticks * m_Setup;
+	m_LED->setMagnitude(m_State >> 15);
+#endif
+}
 
 /**
-* Create the LedStateMachine object, and reset the m_LEDQueue
+* Create the LedStateMachine object, and reset the m_Queue
 *
-* @param [in] a_SpiLeds - a TLC59711 shared between this object and others
-* @param [in] a_LEDQueue - a LEDQueue shared between this object and others
+* @param [in] a_LED - the LED to drive
+* @param [in] a_Steps - a LEDQueue shared between this object and others
 */
-LedStateMachine::LedStateMachine(LED& a_LED, LEDQueue& a_Steps) : m_LED(a_LED), m_LEDQueue(a_Steps)
+LedStateMachine::LedStateMachine(LED& a_LED, LEDQueue& a_Steps) : Core(a_LED, a_Steps)
 {
-	// Note - RgbLeds are clear by their constructor
-	m_Easing.setLED(&m_LED);
+	m_Easing.setLED(&m_Output);
 	reset();
 }
 
 /**
-* Reset all member variables, including resetting the m_LEDQueue and shutting off the LEDs
+* Reset all member variables, including resetting the m_Queue and shutting off the LEDs
 */
 void LedStateMachine::reset(void)
 {
 	m_State = eStateIdle;
+	m_CurrentLeds[0] = 0;
+	m_Canonical = false;
 
-	// TODO
+	m_Queue.reset();
 	turnOffLed();
 }
 
@@ -129,147 +624,239 @@ void LedStateMachine::reset(void)
 */
 void LedStateMachine::turnOffLed(void)
 {
-	m_LED.clear();
+	m_Output.clear();
 }
 
 /**
-* Get the next message from the queue
+* Take the next group off the queue
 *
-* @return - a pointer to a Packet object, or NULL if repititions are exhausted
+* @return - false if a streamed queue ran dry, the LED holds and the
+*  machine looks again next tick
 */
-LEDStep* LedStateMachine::nextMessage(void)
+bool LedStateMachine::startGroup(void)
 {
-	if (++m_CurrentIndex == m_NumInGroup)
+	const LEDStep* l_Msg = m_Queue.startGroup(m_NumInGroup);
+
+	if (NULL == l_Msg)
 	{
-		// Are we done
-		if (0 == --m_Repetitions)
-		{
-			return NULL;
-		}
-		else
-		{
-			m_CurrentIndex = 0;
-		}
+		return false;
+	}
+	m_CurrentMsg = *l_Msg;
+	m_Repetitions = m_CurrentMsg.getRepetitions();
+	LEDSM_TRACE_EVENT(LedTrace::eTraceGroup, m_Output.getPin(), m_NumInGroup);
+	return true;
+}
+
+/**
+* Work out the step about to play, a sweep's next sub-step ends
+* getSweepStep() levels on from where the LED is
+*/
+void LedStateMachine::beginStep(void)
+{
+	m_EasingTime = m_CurrentMsg.getEasing();
+	m_Duration = m_CurrentMsg.getDuration();
+	m_EndLeds[0] = m_CurrentMsg.isSweep() ? sweepTarget(m_CurrentLeds[0], m_CurrentMsg) : m_CurrentMsg.getLEDMagnitude();
+}
+
+/**
+* Start the step's easing and work out its first tick
+*/
+void LedStateMachine::beginEasing(void)
+{
+	LEDEasingSetup l_Setup;
+
+	// compiled tables have the increment worked out already, but only
+	// for starting where the previous step ended, not from reset(),
+	// and not for the sub-steps of a sweep
+	if (m_Canonical && !m_CurrentMsg.isSweep() && m_Queue.getEasingSetup(l_Setup))
+		m_Easing.init(m_CurrentLeds[0], l_Setup);
+	else
+		m_Easing.init(m_CurrentLeds[0], m_EndLeds[0], m_EasingTime);
+	m_Easing.calc();
+}
+
+/**
+* Move on from a step that has finished its easing and duration, to the
+* sweep's next sub-step or the next step
+*
+* @return - false when the group is done
+*/
+bool LedStateMachine::nextStep(void)
+{
+	const LEDStep* l_Msg;
+
+	if (m_CurrentMsg.isSweep() && m_CurrentLeds[0] != m_CurrentMsg.getLEDMagnitude())
+	{
+		return true;
+	}
+	if (!nextInGroup() || NULL == (l_Msg = m_Queue.retrieveNextMessage()))
+	{
+		return false;
 	}
-	return m_LEDQueue.retrieveNextMessage();
+	m_CurrentMsg = *l_Msg;
+	return true;
 }
 
 /**
 * This updates the state machine
 *
-* @note - this is called by the main thread approx. every 10 ms.
+* @note - this is called by the main thread approx. every 10 ms. The LED
+*  is only staged, the caller writes it once every machine has run
+*
+* @return - false if the machine is idle with nothing to play
 */
 bool LedStateMachine::updateState(void)
 {
-	LEDStep *l_Msg;
+	return Core::updateState();
+}
 
-	switch (m_State)
+/**
+* Drop the group playing and play a_Group from the next tick, then the
+* groups after it in order
+*
+* @note - the queue needs a group index, a compiled table's or one from
+*  LEDQueue::indexGroups(). A machine run by a LedRunner may have its
+*  next tick skipped far ahead, pick the group with
+*  LedRunner::selectGroup() instead.
+*
+* @param [in] a_Group - number of the group, 0 for the first in the table
+* @return - false if there is no such group, the machine plays on
+*/
+bool LedStateMachine::selectGroup(uint16_t a_Group)
+{
+	if (!m_Queue.selectGroup(a_Group))
 	{
-		case eStateIdle:
-			m_NumInGroup = 0;
-			while (1)
-			{
-				l_Msg = m_LEDQueue.get(m_NumInGroup == 0);
-				if (0 == m_NumInGroup++)
-				{
-					// turn the LED display driver power on and then delay
-					// for 10 ms
-					m_State = eStateDelay;
-					m_CountDown = 1;
-
-					m_CurrentIndex = 0;
-					m_CurrentMsg = l_Msg;
-					m_Repetitions = m_CurrentMsg->getRepetitions();
-				}
-				// last message - then leave
-				if (l_Msg->getFlags() & LEDMasks::eLastInGroup)
-				{
-					m_LEDQueue.SetEndIndex();
-					break;
-				}
-			}
-			// return true if there are LED messages to process
-			// return false if we are idle and there are no LED messages
-			//
-			return (m_NumInGroup != 0);
-		case eStateDelay:
-			if (0 == --m_CountDown)
-			{
-				m_State = eStateMessageBegin;
-			}
-			break;
-		case eStateMessageBegin:
-			m_EasingTime = m_CurrentMsg->getEasing();
-			m_Duration = m_CurrentMsg->getDuration();
-			if (m_EasingTime)
-			{
-
-				m_State = eStateEasing;
-				m_CountDown = m_EasingTime;
-				m_EndLed = m_CurrentMsg->getLEDMagnitude();
-
-				m_Easing.init(m_CurrentLed, m_EndLed, m_EasingTime);
-				m_Easing.calc();
-			}
-			else
-			{
-				m_State = eStateSteady;
-				m_CountDown = m_Duration;
-				m_CurrentLed = m_CurrentMsg->getLEDMagnitude();
-			}
-			m_LED.setMagnitude(m_CurrentLed);
+		return false;
+	}
+	m_State = eStateIdle;
 
-			break;
+	// the step before a_Group in the table is not what the LED shows, so
+	// its compiled easing does not fit
+	m_Canonical = false;
+	return true;
+}
+
+/**
+* Find out how many of the next updateState() calls would only count down
+*
+* @note - those ticks change nothing visible, so a runner can account for
+*  them with skipTicks() and sleep instead of calling updateState()
+*
+* @return - number of ticks before the state or the LED changes
+*/
+uint16_t LedStateMachine::ticksUntilTransition(void)
+{
+	switch (m_State)
+	{
 		case eStateEasing:
-			// are we done with Easing
-			if (0 == --m_CountDown)
-			{
-				// reconcile that easing may have not ended precicely on the correct value
-				// so just copy in the correct values 
-				m_CurrentLed = m_CurrentMsg->getLEDMagnitude();
-				m_CountDown = m_Duration;
-				if (m_CountDown)
-				{
-					m_State = eStateSteady;
-					m_CountDown = m_Duration;
-				}
-				else
+			// the tick that takes m_CountDown to 0 ends the easing
+			return m_Easing.ticksUntilChange(m_CountDown - 1);
+		case eStateSteady:
+			// m_CountDown of 0 wraps, which is also what updateState() does
+			return m_CountDown - 1;
+		default:
+			return 0;
+	}
+}
+
+/**
+* Account for ticks without running them
+*
+* @param [in] a_Ticks - number of ticks, no more than ticksUntilTransition()
+*/
+void LedStateMachine::skipTicks(uint16_t a_Ticks)
+{
+	m_CountDown -= a_Ticks;
+	if (eStateEasing == m_State)
+	{
+		m_Easing.skip(a_Ticks);
+	}
+}
+
+/**
+* Move the machine on by a_Ticks ticks, ending up exactly where that many
+* updateState() calls would have left it, LED included
+*
+* @note - easings and steady levels are jumped in one go, and once the
+*  table has been seen to come back round to the same state the whole
+*  cycles left are dropped, so the cost does not grow with a_Ticks. The
+*  LED is only staged, as with updateState()
+*
+* @param [in] a_Ticks - number of ticks
+*/
+void LedStateMachine::advance(uint32_t a_Ticks)
+{
+	// state at the idle tick a cycle is measured from
+	int l_Position = -1;
+	uint32_t l_Left = 0;
+	uint8_t l_Led = 0;
+	uint8_t l_Shown = 0;
+	bool l_Canonical = false;
+	uint16_t l_Ticks;
+	int l_Here;
+
+	while (a_Ticks)
+	{
+		switch (m_State)
+		{
+			case eStateIdle:
+				l_Here = m_Queue.getPosition();
+				if (l_Here >= 0 && l_Here == l_Position && l_Led == m_CurrentLeds[0]
+					&& l_Shown == m_Output.getMagnitude() && l_Canonical == m_Canonical)
 				{
-					if (NULL != (m_CurrentMsg = nextMessage()))
-					{
-						m_State = eStateMessageBegin;
-					}
-					else
-					{
-						m_State = eStateIdle;
-					}
+					// every cycle from here on plays the same way
+					a_Ticks %= l_Left - a_Ticks;
+					l_Position = -2;
+					continue;
 				}
-			}
-			else
-			{
-				// Ease on down the road
-				m_Easing.calc();
-			}
-			// write the new values
-			m_LED.write();
-			break;
-		case eStateSteady:
-			if (0 == --m_CountDown)
-			{
-				// STEADY State is done so go to next MSG
-				if (NULL != (m_CurrentMsg = nextMessage()))
+				if (l_Here >= 0 && (-1 == l_Position || l_Here == l_Position))
 				{
-					m_State = eStateMessageBegin;
+					l_Position = l_Here;
+					l_Left = a_Ticks;
+					l_Led = m_CurrentLeds[0];
+					l_Shown = m_Output.getMagnitude();
+					l_Canonical = m_Canonical;
 				}
-				else
+				updateState();
+				--a_Ticks;
+
+				// a streamed queue that ran dry stays idle
+				if (eStateIdle == m_State)
+					return;
+				break;
+			case eStateEasing:
+			case eStateSteady:
+				// all but the tick that takes m_CountDown to 0, which ends the step
+				l_Ticks = m_CountDown - 1;
+				if (a_Ticks < l_Ticks)
+					l_Ticks = a_Ticks;
+				if (l_Ticks)
 				{
-					m_State = eStateIdle;
+					m_CountDown -= l_Ticks;
+					a_Ticks -= l_Ticks;
+					if (eStateEasing == m_State)
+						m_Easing.advance(l_Ticks);
+					break;
 				}
-			}
-			break;
-		default:
-			break;
+				updateState();
+				--a_Ticks;
+				break;
+			default:
+				updateState();
+				--a_Ticks;
+				break;
+		}
 	}
-	return true;
 }
 
+/**
+* Put the machine where it would be a_Tick updateState() calls after
+* reset(), the way to start a show part way through
+*
+* @param [in] a_Tick - number of ticks since the start of the table
+*/
+void LedStateMachine::seekTo(uint32_t a_Tick)
+{
+	reset();
+	advance(a_Tick);
+}
@@ -6,42 +6,102 @@
 #ifndef __LEDSTATEMACHINE_H__
 #define __LEDSTATEMACHINE_H__
 
+#ifdef LEDSM_DIRECT_PWM
+#include "PwmPin.h"
+#endif
+#include "LedTrace.h"
+#include "LedCore.h"
 
 #pragma pack(push, 1)
 
 enum LEDMasks
 {
 	eLastInGroup = 0x80,	// For messages, this indicates whether this is the last message
+	eSweep = 0x40,			// the step sweeps to its magnitude in sub-steps, see LedStateMachine
+	eSweepStepMask = 0x3f	// levels a sweep moves each sub-step, 0 is taken as 1
 };
 
+#ifdef LEDSM_EXACT_EASING
+/**
+* Precomputed easing parameters for a step, see Easing::prepare()
+*
+* Exact easing moves the magnitude m_Step every tick and spreads what is
+* left over (m_Rem / easing time per tick) with an error accumulator, the
+* way Bresenham draws a line. Fading down is done with uint8_t wraparound,
+* m_Step and m_Unit hold the negated values.
+*/
+struct LEDEasingSetup
+{
+	uint16_t m_Rem;		// remainder of the magnitude change, in 1/easing time per tick
+	uint16_t m_Back;	// easing time - m_Rem, taken off the error when it carries
+	uint8_t m_Step;		// whole magnitude change per tick
+	uint8_t m_Unit;		// 1 fading up, 0xff fading down
+};
 
+// Where an easing is up to
+struct LEDEasingState
+{
+	uint16_t m_Error;
+	uint8_t m_Value;
+};
+#else
+// Precomputed easing parameters for a step, see Easing::prepare()
+typedef int32_t LEDEasingSetup;		// 17.15 fixed point increment per tick
+
+// Where an easing is up to
+typedef int32_t LEDEasingState;		// 17.15 fixed point magnitude
+#endif
+
+
+/**
+* The LED class stages the value for one PWM pin. setMagnitude() only
+* records the value, write() puts it on the pin if it changed.
+*
+* Building with LEDSM_DIRECT_PWM writes the pin through a PwmPin, a store
+* to the timer's compare register, instead of analogWrite().
+*/
 class LED
 {
 public:
 	/**
 	 * Create the LED object, and clear it
 	 */
+#ifdef LEDSM_DIRECT_PWM
+	LED(uint8_t a_Pin) : m_Pin(a_Pin), m_Output(a_Pin) { clear(); }
+#else
 	LED(uint8_t a_Pin) : m_Pin(a_Pin) { clear(); }
+#endif
 
 	/**
 	 * Clears the value of the LED
 	 */
-	void clear(void) { m_Magnitude = 0; }
+	void clear(void) { m_Magnitude = 0; m_Dirty = true; }
 
-	// TODO
-	void write(void) {  }
 	/**
-	 * Set the value of the LED
+	 * Put the staged value on the pin, if it changed since the last write
+	 *
+	 * @return - true if the pin was written
+	 */
+	bool write(void)
+	{
+		if (!m_Dirty)
+			return false;
+		m_Dirty = false;
+		LEDSM_TRACE_EVENT(LedTrace::eTraceWrite, m_Pin, m_Magnitude);
+#ifdef LEDSM_DIRECT_PWM
+		m_Output.write(m_Magnitude);
+#else
+		analogWrite(m_Pin, m_Magnitude);
+#endif
+		return true;
+	}
+
+	/**
+	 * Set the value of the LED, it reaches the pin on the next write()
 	 * 
 	 * @param [in] value - the value to set the LED to
 	 */
-	void setMagnitude(uint8_t value) {	m_Magnitude = value;
-#if 0
-		Serial.print(m_Magnitude);
-		Serial.print('\t');
-		Serial.println(millis());
-#endif
-										analogWrite(m_Pin, m_Magnitude);	}
+	void setMagnitude(uint8_t value) {	if (value != m_Magnitude) { m_Magnitude = value; m_Dirty = true; }	}
 	void setMagnitude(LED& a_LED) { setMagnitude(a_LED.getMagnitude());		}
 
 	/**
@@ -51,10 +111,21 @@ public:
 	 */
 	uint8_t getMagnitude(void) { return m_Magnitude; }
 
+	/**
+	 * Getter for the m_Pin
+	 *
+	 * @return - a copy of m_Pin
+	 */
+	uint8_t getPin(void) { return m_Pin; }
+
 	static const uint8_t m_NumberOfLeds = 1;
 protected:
 	uint8_t m_Pin;
 	uint8_t	m_Magnitude;
+	bool m_Dirty;			// m_Magnitude has not been written to the pin
+#ifdef LEDSM_DIRECT_PWM
+	PwmPin m_Output;
+#endif
 };
 
 /**
@@ -64,14 +135,25 @@ protected:
 class LEDStep
 {
 public:
-	LEDStep(uint8_t a_Flags, uint8_t a_Reps, uint8_t a_Magnitude, uint16_t a_Easing, uint16_t a_Duration);
+	/**
+	* Create an empty step
+	*/
+	constexpr LEDStep(void)
+		: m_Flags(0), m_Repetitions(0), m_LEDMagnitude(0), m_Easing(0), m_Duration(0) {}
+
+	/**
+	* Create a step. The constructor is constexpr so that step tables can be
+	* constant initialized and placed in flash with PROGMEM
+	*/
+	constexpr LEDStep(uint8_t a_Flags, uint8_t a_Reps, uint8_t a_Magnitude, uint16_t a_Easing, uint16_t a_Duration)
+		: m_Flags(a_Flags), m_Repetitions(a_Reps), m_LEDMagnitude(a_Magnitude), m_Easing(a_Easing), m_Duration(a_Duration) {}
 
 	/**
 	* Getter for the m_Flags
 	*
 	* @return - a copy of m_Flags
 	*/
-	uint8_t getFlags(void) { return m_Flags; }
+	constexpr uint8_t getFlags(void) const { return m_Flags; }
 
 
 	/**
@@ -79,28 +161,42 @@ public:
 	*
 	* @return - a copy of m_Repetitions
 	*/
-	uint8_t getRepetitions(void) { return m_Repetitions; }
+	constexpr uint8_t getRepetitions(void) const { return m_Repetitions; }
 
 	/**
 	* Getter for the m_Leds
 	*
 	* @return - a copy of m_Leds
 	*/
-	uint8_t getLEDMagnitude(void) { return m_LEDMagnitude; }
+	constexpr uint8_t getLEDMagnitude(void) const { return m_LEDMagnitude; }
 
 	/**
 	* Getter for the m_Easing
 	*
 	* @return - a copy of m_Easing
 	*/
-	uint16_t getEasing(void) { return m_Easing; }
+	constexpr uint16_t getEasing(void) const { return m_Easing; }
 
 	/**
 	* Getter for the m_Duration
 	*
 	* @return - a copy of m_Duration
 	*/
-	uint16_t getDuration(void) { return m_Duration; }
+	constexpr uint16_t getDuration(void) const { return m_Duration; }
+
+	/**
+	* Find out if the step is a sweep
+	*
+	* @return - true if eSweep is set
+	*/
+	constexpr bool isSweep(void) const { return 0 != (m_Flags & eSweep); }
+
+	/**
+	* Getter for the sweep's step size
+	*
+	* @return - levels each sub-step of a sweep moves, 1 to 63
+	*/
+	constexpr uint8_t getSweepStep(void) const { return (m_Flags & eSweepStepMask) ? (m_Flags & eSweepStepMask) : 1; }
 
 protected:
 	uint8_t m_Flags;			// bit definitions defined above
@@ -113,6 +209,60 @@ protected:
 };
 
 
+/**
+* Describes one group of a compiled step table
+*/
+struct LEDGroupInfo
+{
+	uint16_t m_Start;				// index of the group's first step
+	uint8_t m_Length;				// number of steps in the group
+	uint8_t m_Repetitions;			// number of times the group plays
+	LEDEasingSetup m_RepeatSetup;	// easing of the first step when the group repeats
+};
+
+/**
+* Describes one group of a table indexed when it is loaded, see
+* LEDQueue::indexGroups()
+*/
+struct LEDGroupSpan
+{
+	uint16_t m_Start;				// index of the group's first step, which holds its repetitions
+	uint8_t m_Length;				// number of steps in the group
+};
+
+/**
+* A step table with its groups and easing worked out ahead of time,
+* see LEDCompiler.h. All of the arrays live in flash.
+*/
+struct LEDProgram
+{
+	const LEDStep* m_Steps;
+	const LEDEasingSetup* m_Setups;	// easing of each step, coming from the step before it
+	const LEDGroupInfo* m_Groups;
+	uint16_t m_NumSteps;
+	uint16_t m_NumGroups;
+};
+
+/**
+* A step table in the packed format of LEDPack.h, in flash
+*/
+struct LEDPacked
+{
+	const uint8_t* m_Bytes;
+	uint16_t m_NumSteps;
+};
+
+/**
+* Where a packed table is being read, see LEDQueue::unpack()
+*/
+struct LEDPackCursor
+{
+	const uint8_t* m_Record;		// run being played
+	const uint8_t* m_Next;			// next step's bytes
+	uint8_t m_Pos;					// steps of the run's template done this time round
+	uint8_t m_Time;					// times the template has been played
+	uint8_t m_Offset;				// magnitude added to this time round
+};
 
 /**
 * The PacketQueue class will manage the packets in a queue
@@ -120,34 +270,170 @@ protected:
 class LEDQueue
 {
 public:
-	LEDQueue(LEDStep* a_Buffer, int a_Count);
-	virtual ~LEDQueue(void);
+	/**
+	* Where the step table lives
+	*
+	* @note - the tables read by index come before eStorageRing, see
+	*  m_Table
+	*/
+	enum StepStorage
+	{
+		eStorageRam,				// table is a normal array in SRAM
+		eStorageProgmem,			// table was declared const ... PROGMEM and lives in flash
+		eStorageRing,				// table is a writable SRAM ring, filled while it plays (see LEDStream)
+		eStoragePacked				// table is packed into flash (see LEDPack.h)
+	};
+
+	LEDQueue(const LEDStep* a_Buffer, int a_Count, StepStorage a_Storage = eStorageRam);
+	LEDQueue(const LEDProgram& a_Program);
+	LEDQueue(const LEDPacked& a_Packed);
+	~LEDQueue(void);
 
 	void reset(void);
 	void SetEndIndex(void)		{ m_GroupEndIndex = m_CurIndex; }
-	LEDStep* get(bool a_Start);
-	LEDStep* retrieveNextMessage(void);
+	const LEDStep* get(bool a_Start);
+	const LEDStep* startGroup(uint8_t& a_NumInGroup);
+	const LEDStep* retrieveNextMessage(void);
+	bool getEasingSetup(LEDEasingSetup& a_Setup);
+	uint16_t indexGroups(LEDGroupSpan* a_Index, uint16_t a_Max);
+	bool selectGroup(uint16_t a_Group);
+
+	/**
+	* Getter for the m_NumGroups
+	*
+	* @return - number of groups in the index, 0 if the queue has none
+	*/
+	uint16_t getNumGroups(void) const { return m_Storage < eStorageRing ? m_Table.m_NumGroups : 0; }
+
+	// producer side of an eStorageRing queue
+	LEDStep* reserve(void);
+	void unreserve(void);
+	void producerCommit(void);
+	uint16_t getFree(void);
+	uint16_t getReleased(void);
+
+	/**
+	* Getter for the m_Count
+	*
+	* @return - number of steps the table or ring holds
+	*/
+	uint16_t getCapacity(void) const { return m_Count; }
 
+	/**
+	* Where the next group starts. A table comes back to the same place
+	* every time round, a ring does not, its steps change as it plays
+	*
+	* @return - index of the next step get() reads, or -1 for a ring
+	*/
+	int getPosition(void) const { return eStorageRing == m_Storage ? -1 : m_CurIndex; }
 
 
 protected:
+	/**
+	* eStorageRam and eStorageProgmem, groups are looked up once the
+	* table is compiled or indexed
+	*/
+	struct TableState
+	{
+		const LEDEasingSetup* m_Setups;		// only set for compiled tables
+		union
+		{
+			const LEDGroupInfo* m_Groups;	// compiled, in flash
+			const LEDGroupSpan* m_Spans;	// built by indexGroups(), in SRAM
+		};
+		uint16_t m_NumGroups;				// 0 to read through the table
+		uint16_t m_GroupNumber;				// next group to play
+		LEDEasingSetup m_RepeatSetup;		// of the group being played
+	};
+
+	/**
+	* eStorageRing. The counts run free, the consumer only sees steps up
+	* to m_Committed and the producer only reuses steps up to m_Released
+	*/
+	struct RingState
+	{
+		int m_WrIndex;						// producer write index
+		uint16_t m_Written;					// number of steps reserved
+		volatile uint16_t m_Committed;		// number of steps the consumer can see
+		volatile uint16_t m_Released;		// number of steps played and done with
+		uint8_t m_GroupLength;				// steps in the group being played
+	};
+
+	/**
+	* eStoragePacked. Packed steps can only be read in order, so get()
+	* and retrieveNextMessage() each keep their own place
+	*/
+	struct PackedState
+	{
+		const uint8_t* m_Bytes;
+		LEDPackCursor m_Scan;				// next step for get()
+		LEDPackCursor m_Walk;				// next step for retrieveNextMessage()
+		LEDPackCursor m_Mark;				// first step of the group
+	};
+
+	const LEDStep* fetch(int a_Index);
+	const LEDStep* unpack(LEDPackCursor& a_Cursor);
+
 	int m_Count;					// number of items in the queue
-	
-	LEDStep* m_Head;				// pointer to the head of the queue
+	uint8_t m_Storage;				// a StepStorage, where m_Head points
+
+	const LEDStep* m_Head;			// pointer to the head of the queue, or the ring
+	LEDStep m_Step;					// RAM copy of the last step read from flash
 	int m_CurIndex;
 
 	int m_GroupCurIndex;
 	int m_GroupStartIndex;
 	int m_GroupEndIndex;
+	bool m_Repeating;				// the current step is the group's first, played again
+
+	// what only one kind of table needs, m_Storage says which
+	union
+	{
+		TableState m_Table;
+		RingState m_Ring;
+		PackedState m_Packed;
+	};
+};
 
-	LEDStep* m_ConStartIndex;		// consumer start index
-	LEDStep* m_ConEndIndex;			// consumer end index + 1
-	LEDStep* m_ConRdIndex;			// consumer end index
+#ifdef LEDSM_EXACT_EASING
+/**
+* Shift and subtract division for Easing::prepare(), one quotient bit per
+* level. The bit number is a template argument so the compiler unrolls it.
+*/
+template <uint8_t Bit>
+struct LEDEasingDivider
+{
+	static constexpr LEDEasingSetup divide(uint8_t a_Change, uint16_t a_Time, bool a_Up, uint16_t a_Rem, uint8_t a_Quot)
+	{
+		return subtract(a_Change, a_Time, a_Up, (a_Rem << 1) | ((a_Change >> (Bit - 1)) & 1), a_Quot << 1);
+	}
 
+	static constexpr LEDEasingSetup subtract(uint8_t a_Change, uint16_t a_Time, bool a_Up, uint16_t a_Rem, uint8_t a_Quot)
+	{
+		return a_Rem >= a_Time ? LEDEasingDivider<Bit - 1>::divide(a_Change, a_Time, a_Up, a_Rem - a_Time, a_Quot | 1)
+			: LEDEasingDivider<Bit - 1>::divide(a_Change, a_Time, a_Up, a_Rem, a_Quot);
+	}
+};
+
+template <>
+struct LEDEasingDivider<0>
+{
+	static constexpr LEDEasingSetup divide(uint8_t a_Change, uint16_t a_Time, bool a_Up, uint16_t a_Rem, uint8_t a_Quot)
+	{
+		return (void)a_Change, LEDEasingSetup{ a_Rem, (uint16_t)(a_Time - a_Rem), (uint8_t)(a_Up ? a_Quot : -a_Quot), (uint8_t)(a_Up ? 1 : 0xff) };
+	}
 };
 
+#endif
 /**
 * The Easing class will control the rate and brightness of the LEDs
+*
+* By default the magnitude is a 17.15 fixed point value, stepped by an
+* increment that costs a 32 bit divide to work out and can end a little
+* short of the target. Building with LEDSM_EXACT_EASING uses the
+* LEDEasingSetup error accumulator instead: it is worked out with an 8 bit
+* shift and subtract, every calc() is 8 and 16 bit adds, and the last
+* calc() lands on the end magnitude.
 */
 class Easing
 {
@@ -162,22 +448,100 @@ public:
 	/**
 	* The clear function will set the increment member variables to 0
 	*/
-	void clear(void) { m_Inc = 0; }
+	void clear(void) { m_Setup = LEDEasingSetup(); }
 
+#ifdef LEDSM_EXACT_EASING
 	/**
-	* The init function initializes the accumulator, increment and times member variables
+	* Work out the easing parameters for a step. This is constexpr so
+	* LEDCompiler can do it when the sketch is built.
 	*
-	* @param [in] a_StartLed - a LED used to determine initial values for accumulator member variables
-	* @param [in] a_EndLed - a LED used to determine final values for increment member variables
-	* @param [in] m_EasingTime - the total time the easing shall take to get from a_StartLed to a_EndLed
+	* @param [in] a_StartMag - magnitude the easing starts from
+	* @param [in] a_EndMag - magnitude the easing ends on
+	* @param [in] a_EasingTime - number of ticks the easing takes
+	* @return - the parameters to hand to init()
 	*/
-	void init(uint8_t a_StartMag, uint8_t a_EndMag, uint16_t m_EasingTime)
+	static constexpr LEDEasingSetup prepare(uint8_t a_StartMag, uint8_t a_EndMag, uint16_t a_EasingTime)
 	{
-		m_Times = 0;
+		return 0 == a_EasingTime ? LEDEasingSetup{ 0, 0, 0, 0 }
+			: a_EndMag >= a_StartMag
+			? divide(a_EndMag - a_StartMag, a_EasingTime, true)
+			: divide(a_StartMag - a_EndMag, a_EasingTime, false);
+	}
+
+	/**
+	* Start an easing
+	*
+	* @param [out] a_State - the easing to start
+	* @param [in] a_StartMag - magnitude the easing starts from
+	* @param [in] a_Setup - the easing parameters
+	*/
+	static void begin(LEDEasingState& a_State, uint8_t a_StartMag, const LEDEasingSetup& a_Setup)
+	{
+		// starting the error half way rounds the ramp instead of truncating it
+		a_State.m_Value = a_StartMag;
+		a_State.m_Error = ((uint32_t)a_Setup.m_Rem + a_Setup.m_Back) >> 1;
+	}
+
+	/**
+	* Move an easing on by one tick
+	*
+	* @param [in,out] a_State - the easing
+	* @param [in] a_Setup - the easing parameters
+	* @return - the new magnitude
+	*/
+	static uint8_t step(LEDEasingState& a_State, const LEDEasingSetup& a_Setup)
+	{
+		a_State.m_Value += a_Setup.m_Step;
+		if (a_State.m_Error >= a_Setup.m_Back)
+		{
+			a_State.m_Error -= a_Setup.m_Back;
+			a_State.m_Value += a_Setup.m_Unit;
+		}
+		else
+		{
+			a_State.m_Error += a_Setup.m_Rem;
+		}
+		return a_State.m_Value;
+	}
+#else
+	/**
+	* Work out the easing parameters for a step. This is constexpr so
+	* LEDCompiler can do it when the sketch is built.
+	*
+	* @param [in] a_StartMag - magnitude the easing starts from
+	* @param [in] a_EndMag - magnitude the easing ends on
+	* @param [in] a_EasingTime - number of ticks the easing takes
+	* @return - the parameters to hand to init()
+	*/
+	static constexpr LEDEasingSetup prepare(uint8_t a_StartMag, uint8_t a_EndMag, uint16_t a_EasingTime)
+	{
+		return a_EasingTime ? ((((int32_t)a_EndMag) << 15) - (((int32_t)a_StartMag) << 15)) / a_EasingTime : 0;
+	}
 
-		m_Accum = ((int32_t)a_StartMag) << 15;
+	/**
+	* Start an easing
+	*
+	* @param [out] a_State - the easing to start
+	* @param [in] a_StartMag - magnitude the easing starts from
+	* @param [in] a_Setup - the easing parameters
+	*/
+	static void begin(LEDEasingState& a_State, uint8_t a_StartMag, const LEDEasingSetup& a_Setup)
+	{
+		(void)a_Setup;
+		a_State = ((int32_t)a_StartMag) << 15;
+	}
 
-		m_Inc = ((((int32_t)a_EndMag) << 15) - m_Accum) / m_EasingTime;
+	/**
+	* Move an easing on by one tick
+	*
+	* @param [in,out] a_State - the easing
+	* @param [in] a_Setup - the easing parameters
+	* @return - the new magnitude
+	*/
+	static uint8_t step(LEDEasingState& a_State, const LEDEasingSetup& a_Setup)
+	{
+		a_State += a_Setup;
+		return a_State >> 15;
 	}
 
 	/**
@@ -191,7 +555,33 @@ public:
 		// Put the ticks in the right place, say easing is 2, so the ticks
 		// are 1/4 and 3/4 so the first time we add half the easing value
 		++m_Times;
-		m_LED->setMagnitude(((((int32_t) a_Led.getMagnitude()) << 15) + m_Inc/2) >> 15);
+		m_LED->setMagnitude(((((int32_t) a_Led.getMagnitude()) << 15) + m_Setup/2) >> 15);
+	}
+#endif
+
+	/**
+	* Initialize from parameters worked out by prepare()
+	*
+	* @param [in] a_StartMag - magnitude the easing starts from, the same one given to prepare()
+	* @param [in] a_Setup - the easing parameters
+	*/
+	void init(uint8_t a_StartMag, const LEDEasingSetup& a_Setup)
+	{
+		m_Times = 0;
+		m_Setup = a_Setup;
+		begin(m_State, a_StartMag, m_Setup);
+	}
+
+	/**
+	* The init function initializes the accumulator, increment and times member variables
+	*
+	* @param [in] a_StartLed - a LED used to determine initial values for accumulator member variables
+	* @param [in] a_EndLed - a LED used to determine final values for increment member variables
+	* @param [in] m_EasingTime - the total time the easing shall take to get from a_StartLed to a_EndLed
+	*/
+	void init(uint8_t a_StartMag, uint8_t a_EndMag, uint16_t m_EasingTime)
+	{
+		init(a_StartMag, prepare(a_StartMag, a_EndMag, m_EasingTime));
 	}
 
 	/**
@@ -203,59 +593,122 @@ public:
 	{
 		++m_Times;
 
-		m_Accum += m_Inc;
-
-		m_LED->setMagnitude(m_Accum >> 15);
+		m_LED->setMagnitude(step(m_State, m_Setup));
 	}
 
+	uint16_t ticksUntilChange(uint16_t a_Limit);
+	void skip(uint16_t a_Ticks);
+	void advance(uint16_t a_Ticks);
+
 protected:
+#ifdef LEDSM_EXACT_EASING
+	/**
+	* Divide a magnitude change by the easing time. The change is 8 bits so
+	* there are only 8 quotient bits to find, and an easing time past 255
+	* leaves it all as remainder.
+	*/
+	static constexpr LEDEasingSetup divide(uint8_t a_Change, uint16_t a_Time, bool a_Up)
+	{
+		return a_Time > 255 ? LEDEasingDivider<0>::divide(a_Change, a_Time, a_Up, a_Change, 0)
+			: LEDEasingDivider<8>::divide(a_Change, a_Time, a_Up, 0, 0);
+	}
+
+#endif
 	int m_Times;
 	LED* m_LED;
-	int32_t m_Inc;
-	int32_t m_Accum;
+	LEDEasingSetup m_Setup;
+	LEDEasingState m_State;
 };
 
 /**
 * The LedStateMachine class will manage the LEDs
+*
+* A step flagged eSweep is played as a run of sub-steps, each with the
+* step's fade and duration, that move from the level the LED is at to the
+* step's magnitude getSweepStep() levels at a time; the last one lands on
+* the magnitude exactly. Only the sub-step being played is worked out, so
+*
+*	LEDStep(	eSweep | 1,		0,		0,		100,	0 ),
+*
+* fades down through every level to 0 from wherever the step before left
+* it. A sweep that starts on its magnitude plays once, like any other step.
+*
+* The run through the states is LedCore's, with one channel: m_Output is
+* the LED, m_Queue the table and m_CurrentLeds[0] the level.
 */
-class LedStateMachine
+class LedStateMachine : public LedCore<LedStateMachine, uint8_t, LED::m_NumberOfLeds, LEDQueue, LED>
 {
-public:
-	enum LedStateMachineStates
-	{
-		eStateIdle,
-		eStateDelay,
-		eStateMessageBegin,
-		eStateEasing,
-		eStateSteady
-	};
+	typedef LedCore<LedStateMachine, uint8_t, LED::m_NumberOfLeds, LEDQueue, LED> Core;
+	friend Core;
 
+public:
 	LedStateMachine(LED& a_LED, LEDQueue& a_Steps);
 	void reset(void);
 	void turnOffLed(void);
 	bool updateState(void);
 
+	/**
+	* Getter for the m_Output
+	*
+	* @return - the LED this state machine drives
+	*/
+	LED& getLED(void) { return m_Output; }
+
+	/**
+	* Getter for the m_Queue
+	*
+	* @return - the queue this state machine plays
+	*/
+	LEDQueue& getQueue(void) { return m_Queue; }
+
+	bool selectGroup(uint16_t a_Group);
+	uint16_t ticksUntilTransition(void);
+	void skipTicks(uint16_t a_Ticks);
+	void advance(uint32_t a_Ticks);
+	void seekTo(uint32_t a_Tick);
+
+	/**
+	* Work out where the next sub-step of a sweep goes
+	*
+	* @param [in] a_From - level the sub-step starts from
+	* @param [in] a_Step - the sweep
+	* @return - the level the sub-step ends on
+	*/
+	static uint8_t sweepTarget(uint8_t a_From, const LEDStep& a_Step)
+	{
+		uint8_t l_End = a_Step.getLEDMagnitude();
+		uint8_t l_Size = a_Step.getSweepStep();
+
+		if (a_From < l_End)
+			return (l_End - a_From > l_Size) ? a_From + l_Size : l_End;
+		return (a_From - l_End > l_Size) ? a_From - l_Size : l_End;
+	}
 
 protected:
-	LEDStep* nextMessage(void);
+	// LedCore's hooks
+	bool startGroup(void);
+	void beginStep(void);
+	void beginEasing(void);
 
-	LED& m_LED;
+	/**
+	* One more tick of the easing, straight onto the LED
+	*/
+	void ease(void) { m_Easing.calc(); }
 
-	LEDQueue& m_LEDQueue;
+	/**
+	* A step has begun, stage its level
+	*/
+	void showStep(void) { m_Output.setMagnitude(m_CurrentLeds[0]); m_Canonical = true; }
 
-	LedStateMachineStates m_State;
-	uint16_t m_CountDown;
-	uint16_t m_Duration;
-	uint16_t m_EasingTime;
-	uint16_t m_Repetitions;
-	uint8_t m_NumInGroup;
-	uint8_t m_CurrentIndex;
+	bool nextStep(void);
 
-	LEDStep* m_CurrentMsg;
-	LED* m_CurrentCmd;
+	/**
+	* The group is starting again
+	*/
+	void repeatGroup(void) { LEDSM_TRACE_EVENT(LedTrace::eTraceRepeat, m_Output.getPin(), m_Repetitions); }
 
-	uint8_t m_EndLed;
-	uint8_t m_CurrentLed;
+	bool m_Canonical;				// steps are starting from the magnitude the table expects
+	LEDStep m_CurrentMsg;			// copy of the active step, the queue may only hold a staging copy
 
 	Easing m_Easing;
 };
@@ -0,0 +1,208 @@
+#include "Arduino.h"
+#include "LEDStream.h"
+
+// the wire format of a step is its layout in memory
+static_assert(sizeof(LEDStep) == LEDStream::eStepBytes, "LEDStep is not packed");
+
+/**
+* Create the LEDStream object
+*
+* @param [in] a_Serial - link the frames come in on and the credits go out on
+* @param [in] a_Queues - eStorageRing queues, one per channel
+* @param [in] a_Count - number of queues, no more than eMaxChannels
+*/
+LEDStream::LEDStream(Stream& a_Serial, LEDQueue* const* a_Queues, uint8_t a_Count)
+	: m_Serial(a_Serial), m_Queues(a_Queues), m_Count(a_Count > eMaxChannels ? (uint8_t)eMaxChannels : a_Count),
+	m_State(eParseSync), m_Queue(NULL), m_Frames(0), m_Steps(0), m_BadFrames(0), m_Overflows(0), m_Rejected(0)
+{
+	for (uint8_t i = 0; i < eMaxChannels; i++)
+	{
+		m_Discarded[i] = 0;
+		m_Credited[i] = 0xffff;
+	}
+}
+
+/**
+* Tell the host how much room each channel has
+*
+* @note - call once the serial port is open
+*/
+void LEDStream::begin(void)
+{
+	sendCredits();
+}
+
+/**
+* Take in whatever the serial port has received and report progress
+*/
+void LEDStream::service(void)
+{
+	int l_Avail = m_Serial.available();
+
+	while (l_Avail-- > 0)
+	{
+		parse((uint8_t)m_Serial.read());
+	}
+	sendCredits();
+}
+
+/**
+* Run one received byte through the frame parser
+*
+* @param [in] a_Byte - the byte
+*/
+void LEDStream::parse(uint8_t a_Byte)
+{
+	m_Sum += a_Byte;
+
+	switch (m_State)
+	{
+		case eParseSync:
+			if (eStreamSync == a_Byte)
+			{
+				m_Sum = 0;
+				m_State = eParseLength;
+			}
+			break;
+
+		case eParseLength:
+			m_Length = a_Byte;
+			m_State = eParseType;
+			break;
+
+		case eParseType:
+			m_Queue = NULL;
+			m_FrameSteps = 0;
+			if (0 == m_Length)
+				m_State = eParseCheck;
+			else if (eFrameGroup == a_Byte)
+				m_State = eParseChannel;
+			else
+				m_State = eParseSkip;
+			break;
+
+		case eParseChannel:
+		{
+			uint8_t l_Steps = (m_Length - 1) / eStepBytes;
+
+			--m_Length;
+			m_State = m_Length ? eParseSkip : eParseCheck;
+			if (a_Byte >= m_Count || 0 == l_Steps || l_Steps > eMaxGroupSteps || m_Length != l_Steps * eStepBytes)
+				break;
+
+			if (m_Queues[a_Byte]->getFree() < l_Steps)
+			{
+				// the host sent past its credit, drop the group but still account for it
+				m_Discarded[a_Byte] += l_Steps;
+				++m_Overflows;
+				break;
+			}
+			m_Channel = a_Byte;
+			m_Queue = m_Queues[a_Byte];
+			m_SlotByte = 0;
+			m_Playable = true;
+			m_State = eParseStep;
+			break;
+		}
+
+		case eParseStep:
+			if (0 == m_SlotByte)
+			{
+				// the flags, only the frame's last step ends the group
+				m_Slot = (uint8_t*)m_Queue->reserve();
+				++m_FrameSteps;
+				a_Byte &= ~eLastInGroup;
+			}
+			else if (1 == m_SlotByte && 1 == m_FrameSteps && 0 == a_Byte)
+			{
+				// the first step's repetitions, 0 would play the group
+				// 65536 times
+				m_Playable = false;
+			}
+			m_Slot[m_SlotByte] = a_Byte;
+			if (++m_SlotByte >= eStepBytes)
+				m_SlotByte = 0;
+			if (0 == --m_Length)
+				m_State = eParseCheck;
+			break;
+
+		case eParseSkip:
+			if (0 == --m_Length)
+				m_State = eParseCheck;
+			break;
+
+		case eParseCheck:
+			endFrame(0 == m_Sum);
+			m_State = eParseSync;
+			break;
+	}
+}
+
+/**
+* Finish a frame, committing its steps or handing them back
+*
+* @note - a group the state machine cannot play is handed back the same
+*  as a frame that failed its checksum
+*
+* @param [in] a_Good - the checksum matched
+*/
+void LEDStream::endFrame(bool a_Good)
+{
+	if (!a_Good)
+		++m_BadFrames;
+
+	if (NULL == m_Queue)
+		return;
+
+	if (a_Good && !m_Playable)
+	{
+		++m_Rejected;
+		a_Good = false;
+	}
+
+	if (!a_Good)
+	{
+		m_Discarded[m_Channel] += m_FrameSteps;
+		while (m_FrameSteps--)
+			m_Queue->unreserve();
+		return;
+	}
+
+	// the frame is the whole group, whatever flags the host put on it
+	m_Slot[0] |= eLastInGroup;
+	m_Queue->producerCommit();
+	m_Steps += m_FrameSteps;
+	++m_Frames;
+}
+
+/**
+* Send a credit frame for each channel whose count moved, as far as the
+* transmit buffer has room
+*/
+void LEDStream::sendCredits(void)
+{
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		uint16_t l_Done = m_Queues[i]->getReleased() + m_Discarded[i];
+		uint8_t l_Frame[8];
+		uint8_t l_Sum = 0;
+
+		if (l_Done == m_Credited[i])
+			continue;
+		if (m_Serial.availableForWrite() < (int)sizeof(l_Frame))
+			return;
+
+		l_Frame[0] = eStreamSync;
+		l_Frame[1] = 4;
+		l_Frame[2] = eFrameCredit;
+		l_Frame[3] = i;
+		l_Frame[4] = (uint8_t)l_Done;
+		l_Frame[5] = (uint8_t)(l_Done >> 8);
+		l_Frame[6] = m_Queues[i]->getCapacity() > 0xff ? 0xff : m_Queues[i]->getCapacity();
+		for (uint8_t j = 1; j < 7; j++)
+			l_Sum += l_Frame[j];
+		l_Frame[7] = -l_Sum;
+		m_Serial.write(l_Frame, sizeof(l_Frame));
+		m_Credited[i] = l_Done;
+	}
+}
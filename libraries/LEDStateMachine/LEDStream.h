@@ -0,0 +1,123 @@
+/**
+* @file LEDStream
+* @brief defines the LEDStream class that feeds ring LEDQueues from a serial link
+*
+*/
+#ifndef __LEDSTREAM_H__
+#define __LEDSTREAM_H__
+
+#include "LEDStateMachine.h"
+
+/**
+* The LEDStream class reads step groups off a Stream (normally Serial) and
+* puts them straight into eStorageRing LEDQueues while they play.
+*
+* Every frame on the wire is
+*
+*	SYNC LEN TYPE payload[LEN] CHECK
+*
+* SYNC is eStreamSync, LEN counts the payload bytes only and CHECK makes
+* LEN + TYPE + payload + CHECK add up to 0 (mod 256).
+*
+* eFrameGroup (host to board) carries one whole group for one channel:
+* the channel number and then each step as 7 bytes, flags, repetitions,
+* magnitude, easing (LSB first) and duration (LSB first). That is the
+* LEDStep layout in memory, so the bytes go straight into the ring with
+* no staging buffer. The last step of the frame ends the group whatever
+* its flags say. A group whose first step has no repetitions is thrown
+* away and credited back, as LEDCompiler would refuse the table.
+*
+* eFrameCredit (board to host) is the flow control: the channel, the
+* number of steps the board has finished with (played, or thrown away
+* from a bad frame) as a 16 bit count that wraps, LSB first, and the size
+* of the ring. The host keeps the steps it has sent minus that count
+* below the ring size, so a group always has room when it arrives. A
+* credit goes out whenever the count moves and there is space in the
+* transmit buffer, so print() never blocks the LEDs.
+*
+* The receive side of the Arduino core is interrupt driven; service()
+* only has to empty its 64 byte buffer before it overflows, about every
+* 5 ms at 115200 baud. That rules out the LedRunner sleep, leave it at
+* eSleepOff.
+*
+*	LEDStep g_Ring0[64];
+*	LEDQueue g_Queue0(g_Ring0, 64, LEDQueue::eStorageRing);
+*	LEDQueue* const g_Queues[] = { &g_Queue0 };
+*	LEDStream g_Stream(Serial, g_Queues, 1);
+*
+*	void loop()
+*	{
+*		g_Runner.service();
+*		g_Stream.service();
+*	}
+*
+* @note - a frame whose SYNC byte is lost is never seen, so its steps are
+*  never credited. The host has to time out and start over with a reset.
+*/
+class LEDStream
+{
+public:
+	enum
+	{
+		eStreamSync = 0xa5,
+		eFrameGroup = 0x01,
+		eFrameCredit = 0x81,
+		eMaxChannels = 6,
+		eStepBytes = 7,
+		eMaxGroupSteps = 36			// keeps LEN in a byte
+	};
+
+	LEDStream(Stream& a_Serial, LEDQueue* const* a_Queues, uint8_t a_Count);
+
+	void begin(void);
+	void service(void);
+
+	uint32_t getFrames(void) const { return m_Frames; }
+	uint32_t getSteps(void) const { return m_Steps; }
+	uint16_t getBadFrames(void) const { return m_BadFrames; }
+	uint16_t getOverflows(void) const { return m_Overflows; }
+	uint16_t getRejected(void) const { return m_Rejected; }
+
+protected:
+	enum ParseState
+	{
+		eParseSync,
+		eParseLength,
+		eParseType,
+		eParseChannel,
+		eParseStep,
+		eParseSkip,
+		eParseCheck
+	};
+
+	void parse(uint8_t a_Byte);
+	void endFrame(bool a_Good);
+	void sendCredits(void);
+
+	Stream& m_Serial;
+	LEDQueue* const* m_Queues;
+	uint8_t m_Count;
+
+	// frame being parsed
+	ParseState m_State;
+	uint8_t m_Length;				// payload bytes still to come
+	uint8_t m_Sum;
+	LEDQueue* m_Queue;				// NULL while the frame is being skipped
+	uint8_t m_Channel;
+	uint8_t* m_Slot;				// step being filled in
+	uint8_t m_SlotByte;
+	uint8_t m_FrameSteps;			// steps reserved for this frame
+	bool m_Playable;				// the first step has repetitions
+
+	// steps thrown away from bad frames, credited on top of the released ones
+	uint16_t m_Discarded[eMaxChannels];
+	uint16_t m_Credited[eMaxChannels];
+
+	uint32_t m_Frames;
+	uint32_t m_Steps;
+	uint16_t m_BadFrames;
+	uint16_t m_Overflows;
+	uint16_t m_Rejected;			// good frames with a group that cannot be played
+};
+
+#endif
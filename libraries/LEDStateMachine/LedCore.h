@@ -0,0 +1,323 @@
+/**
+* @file LedCore
+* @brief defines the LedCore template the Arduino and mbed state machines are built on
+*
+*/
+#ifndef __LEDCORE_H__
+#define __LEDCORE_H__
+
+#include <stdint.h>
+
+/**
+* Run an operation for each of Count channels. The channel number is a
+* template argument all the way down, so the compiler unrolls the lot and
+* a single channel costs nothing over writing it out by hand.
+*
+* @note - a_Op is called as a_Op(channel), for channels 0 to Count - 1
+*/
+template <uint8_t Count>
+struct LedUnroll
+{
+	template <class Op>
+	static void each(Op& a_Op)
+	{
+		LedUnroll<Count - 1>::each(a_Op);
+		a_Op(Count - 1);
+	}
+};
+
+template <>
+struct LedUnroll<0>
+{
+	template <class Op>
+	static void each(Op& a_Op) { (void)a_Op; }
+};
+
+/**
+* Copies one set of channel levels to another, for LedUnroll
+*/
+template <class Channel>
+struct LedCopy
+{
+	LedCopy(Channel* a_To, const Channel* a_From) : m_To(a_To), m_From(a_From) {}
+
+	void operator()(uint8_t a_Channel) { m_To[a_Channel] = m_From[a_Channel]; }
+
+	Channel* m_To;
+	const Channel* m_From;
+};
+
+/**
+* The LedCore class is the part of a state machine that does not change
+* with what it drives: the run from idle through the delay, each step's
+* easing and steady time, the repetitions of the group and back to idle.
+* The Arduino LedStateMachine (one LED, an LEDQueue) and the mbed one
+* (RgbLed arrays, PacketLanes and TLC59711s) are both built on it, so
+* a fix to the flow is made once.
+*
+* The machine passes itself in as Machine, along with the type and number
+* of its channels, its queue and its output. What differs between them is
+* called on the Machine, resolved when it is compiled and inlined, so
+* there are no virtual calls:
+*
+*	bool startGroup()	- take the next group off the queue, set
+*						  m_NumInGroup, m_Repetitions and the first step,
+*						  false if there is nothing to play
+*	void beginStep()	- set m_EasingTime, m_Duration and m_EndLeds from
+*						  the step about to play
+*	void beginEasing()	- start easing from m_CurrentLeds to m_EndLeds and
+*						  work out the first tick of it
+*	void ease()			- one more tick of the easing
+*	void showStep()		- a step has begun, show it
+*	void showEasing()	- after every tick of an easing (optional)
+*	bool nextStep()		- move on to the next step, false when the group
+*						  is done (nextInGroup() does the counting)
+*	void repeatGroup()	- the group is starting again (optional)
+*	void endGroup()		- the group is done, back to idle (optional)
+*
+* Hooks the Machine does not declare fall back to the empty ones here.
+*/
+template <class Machine, class Channel, uint8_t Count, class Queue, class Output>
+class LedCore
+{
+public:
+	enum LedStateMachineStates
+	{
+		eStateIdle,
+		eStateDelay,
+		eStateMessageBegin,
+		eStateEasing,
+		eStateSteady
+	};
+
+	static const uint8_t m_NumberOfChannels = Count;
+
+	/**
+	* Create the LedCore object
+	*
+	* @param [in] a_Output - where the channels are shown
+	* @param [in] a_Queue - the steps to play
+	*/
+	LedCore(Output& a_Output, Queue& a_Queue) : m_Output(a_Output), m_Queue(a_Queue), m_State(eStateIdle) {}
+
+	/**
+	* This updates the state machine
+	*
+	* @note - this is called by the main thread approx. every 10 ms.
+	*
+	* @return - false if the machine is idle with nothing to play
+	*/
+	bool updateState(void)
+	{
+		switch (m_State)
+		{
+			case eStateIdle:
+				if (!machine().startGroup())
+				{
+					return false;
+				}
+
+				// turn the LED display driver power on and then delay
+				// for 10 ms
+				m_State = eStateDelay;
+				m_CountDown = 1;
+				m_CurrentIndex = 0;
+
+				// return true if there are LED messages to process
+				// return false if we are idle and there are no LED messages
+				//
+				return (m_NumInGroup != 0);
+			case eStateDelay:
+				if (0 == --m_CountDown)
+				{
+					m_State = eStateMessageBegin;
+				}
+				break;
+			case eStateMessageBegin:
+				machine().beginStep();
+				if (m_EasingTime)
+				{
+					m_State = eStateEasing;
+					m_CountDown = m_EasingTime;
+					machine().beginEasing();
+				}
+				else
+				{
+					m_State = eStateSteady;
+					m_CountDown = m_Duration;
+					copyLevels(m_CurrentLeds, m_EndLeds);
+				}
+				machine().showStep();
+				break;
+			case eStateEasing:
+				// are we done with Easing
+				if (0 == --m_CountDown)
+				{
+					// reconcile that easing may have not ended precicely on the correct value
+					// so just copy in the correct values
+					copyLevels(m_CurrentLeds, m_EndLeds);
+					if (m_Duration)
+					{
+						m_State = eStateSteady;
+						m_CountDown = m_Duration;
+					}
+					else
+					{
+						endStep();
+					}
+				}
+				else
+				{
+					// Ease on down the road
+					machine().ease();
+				}
+				machine().showEasing();
+				break;
+			case eStateSteady:
+				if (0 == --m_CountDown)
+				{
+					// STEADY State is done so go to next MSG
+					endStep();
+				}
+				break;
+			default:
+				break;
+		}
+		return true;
+	}
+
+	/**
+	* Getter for the m_State
+	*
+	* @return - a copy of m_State
+	*/
+	LedStateMachineStates getState(void) { return m_State; }
+
+	/**
+	* Copy channel levels, unrolled
+	*
+	* @param [out] a_To - levels to set
+	* @param [in] a_From - levels to set them to
+	*/
+	static void copyLevels(Channel* a_To, const Channel* a_From)
+	{
+		LedCopy<Channel> l_Copy(a_To, a_From);
+
+		LedUnroll<Count>::each(l_Copy);
+	}
+
+protected:
+	/**
+	* Move on to the next step of the group, or start the group again
+	*
+	* @return - false once the group's repetitions are done
+	*/
+	bool nextInGroup(void)
+	{
+		if (++m_CurrentIndex == m_NumInGroup)
+		{
+			// Are we done
+			if (0 == --m_Repetitions)
+			{
+				return false;
+			}
+			m_CurrentIndex = 0;
+			machine().repeatGroup();
+		}
+		return true;
+	}
+
+	/**
+	* Move on from a step that has finished its easing and duration
+	*/
+	void endStep(void)
+	{
+		if (machine().nextStep())
+		{
+			m_State = eStateMessageBegin;
+		}
+		else
+		{
+			m_State = eStateIdle;
+			machine().endGroup();
+		}
+	}
+
+	/**
+	* Where a group is in its play: the state, the step and repetition,
+	* and the levels, so a machine can put a group aside and pick it up
+	* where it stopped. Anything else the machine keeps for the group
+	* (its easing, the step it has) it saves with it.
+	*/
+	struct Position
+	{
+		LedStateMachineStates m_State;
+		uint16_t m_CountDown;
+		uint16_t m_Duration;
+		uint16_t m_EasingTime;
+		uint16_t m_Repetitions;
+		uint8_t m_NumInGroup;
+		uint8_t m_CurrentIndex;
+		Channel m_EndLeds[Count];
+		Channel m_CurrentLeds[Count];
+	};
+
+	/**
+	* Save where the group is
+	*
+	* @param [out] a_Position - where to save it
+	*/
+	void savePosition(Position& a_Position)
+	{
+		a_Position.m_State = m_State;
+		a_Position.m_CountDown = m_CountDown;
+		a_Position.m_Duration = m_Duration;
+		a_Position.m_EasingTime = m_EasingTime;
+		a_Position.m_Repetitions = m_Repetitions;
+		a_Position.m_NumInGroup = m_NumInGroup;
+		a_Position.m_CurrentIndex = m_CurrentIndex;
+		copyLevels(a_Position.m_EndLeds, m_EndLeds);
+		copyLevels(a_Position.m_CurrentLeds, m_CurrentLeds);
+	}
+
+	/**
+	* Pick a group up where savePosition() left it
+	*
+	* @param [in] a_Position - where it was
+	*/
+	void restorePosition(const Position& a_Position)
+	{
+		m_State = a_Position.m_State;
+		m_CountDown = a_Position.m_CountDown;
+		m_Duration = a_Position.m_Duration;
+		m_EasingTime = a_Position.m_EasingTime;
+		m_Repetitions = a_Position.m_Repetitions;
+		m_NumInGroup = a_Position.m_NumInGroup;
+		m_CurrentIndex = a_Position.m_CurrentIndex;
+		copyLevels(m_EndLeds, a_Position.m_EndLeds);
+		copyLevels(m_CurrentLeds, a_Position.m_CurrentLeds);
+	}
+
+	// the optional hooks
+	void showEasing(void) {}
+	void repeatGroup(void) {}
+	void endGroup(void) {}
+
+	Machine& machine(void) { return *static_cast<Machine*>(this); }
+
+	Output& m_Output;
+	Queue& m_Queue;
+
+	LedStateMachineStates m_State;
+	uint16_t m_CountDown;
+	uint16_t m_Duration;
+	uint16_t m_EasingTime;
+	uint16_t m_Repetitions;
+	uint8_t m_NumInGroup;
+	uint8_t m_CurrentIndex;
+
+	Channel m_EndLeds[Count];		// levels the step ends on
+	Channel m_CurrentLeds[Count];	// levels at the end of the last step
+};
+
+#endif
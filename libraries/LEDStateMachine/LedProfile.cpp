@@ -0,0 +1,144 @@
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "LedProfile.h"
+
+#ifdef LEDSM_PROFILE
+
+LedProfile::Figures LedProfile::s_Figures;
+uint32_t LedProfile::s_Late = 0;
+
+static const char* const s_StateNames[LedProfile::eStates] =
+{
+	"idle",
+	"delay",
+	"begin",
+	"easing",
+	"steady"
+};
+
+/**
+* Zero all the figures
+*/
+void LedProfile::clear(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset(&s_Figures, 0, sizeof(s_Figures));
+	}
+}
+
+/**
+* Note how late a tick is starting
+*
+* @note - TickScheduler and LedTimer call this just before the tick runs
+*
+* @param [in] a_Late - microseconds past the tick's deadline
+*/
+void LedProfile::late(uint32_t a_Late)
+{
+	uint8_t l_Bucket = 0;
+
+	s_Late = a_Late;
+	for (a_Late >>= eLateShift; a_Late && l_Bucket < eLateBuckets - 1; a_Late >>= 1)
+	{
+		++l_Bucket;
+	}
+	++s_Figures.m_Late[l_Bucket];
+}
+
+/**
+* Account for a whole tick, once its LEDs are written
+*
+* @param [in] a_Start - micros() when the tick started
+* @param [in] a_Period - the tick budget, in microseconds
+*/
+void LedProfile::tick(uint32_t a_Start, uint32_t a_Period)
+{
+	uint32_t l_Latency = s_Late + (micros() - a_Start);
+
+	s_Late = 0;
+	++s_Figures.m_Ticks;
+	s_Figures.m_LatencySum += l_Latency;
+	if (l_Latency > s_Figures.m_MaxLatency)
+		s_Figures.m_MaxLatency = l_Latency > 0xffff ? 0xffff : l_Latency;
+	if (l_Latency >= a_Period)
+		++s_Figures.m_Overruns;
+}
+
+/**
+* Print the figures
+*
+* @note - this blocks until the text is in the transmit buffer, call it
+*  when a long loop() does not matter
+*
+* @param [in] a_Out - where to print them, normally Serial
+*/
+void LedProfile::report(Print& a_Out)
+{
+	Figures l_Figures;
+
+	// the interrupt may be adding to them while they are printed
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		l_Figures = s_Figures;
+	}
+
+	a_Out.println("state calls avg_cycles max_cycles");
+	for (uint8_t i = 0; i < eStates; i++)
+	{
+		a_Out.print(s_StateNames[i]);
+		a_Out.print(' ');
+		a_Out.print(l_Figures.m_Calls[i]);
+		a_Out.print(' ');
+		a_Out.print(l_Figures.m_Calls[i] ? l_Figures.m_Counts[i] * 64 / l_Figures.m_Calls[i] : 0UL);
+		a_Out.print(' ');
+		a_Out.println(l_Figures.m_MaxCounts[i] * 64);
+	}
+
+	a_Out.print("ticks ");
+	a_Out.print(l_Figures.m_Ticks);
+	a_Out.print(" latency_us avg ");
+	a_Out.print(l_Figures.m_Ticks ? l_Figures.m_LatencySum / l_Figures.m_Ticks : 0UL);
+	a_Out.print(" max ");
+	a_Out.print((unsigned int)l_Figures.m_MaxLatency);
+	a_Out.print(" overruns ");
+	a_Out.println((unsigned int)l_Figures.m_Overruns);
+
+	a_Out.print("late_us");
+	for (uint8_t i = 0; i < eLateBuckets; i++)
+	{
+		a_Out.print(i == eLateBuckets - 1 ? " >=" : " <");
+		a_Out.print((unsigned long)1 << (eLateShift + (i == eLateBuckets - 1 ? i - 1 : i)));
+		a_Out.print(':');
+		a_Out.print((unsigned int)l_Figures.m_Late[i]);
+	}
+	a_Out.println();
+}
+
+/**
+* Print the figures when a '?' comes in, clear them on a '!'
+*
+* @note - this takes bytes off the port, only use it on a link nothing
+*  else reads, not alongside LEDStream or a TickSync follower
+*
+* @param [in] a_Serial - the port to listen and print on
+*/
+void LedProfile::poll(Stream& a_Serial)
+{
+	while (a_Serial.available() > 0)
+	{
+		switch (a_Serial.read())
+		{
+			case '?':
+				report(a_Serial);
+				break;
+			case '!':
+				clear();
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,121 @@
+/**
+* @file LedProfile
+* @brief timing instrumentation for the state machines, built with LEDSM_PROFILE
+*
+*/
+#ifndef __LEDPROFILE_H__
+#define __LEDPROFILE_H__
+
+#include "LEDStateMachine.h"
+
+#ifdef LEDSM_PROFILE
+#include <avr/io.h>
+
+/**
+* The LedProfile class measures how much of the tick budget the state
+* machines use, so there is something to go on before adding channels.
+*
+* It records, from LedRunner, TickScheduler and LedTimer:
+*
+*	- updateState() calls and their time, per state the call started in
+*	- the time from a tick's deadline to its LEDs being written, average
+*	  and worst
+*	- how late ticks start, as a histogram: under 64 us, under 128 us and
+*	  so on doubling, the last bucket is 4096 us and over
+*	- overruns, ticks whose LEDs went out a whole period or more after
+*	  their deadline
+*
+* updateState() is timed with timer 0, which the Arduino core runs at
+* clock / 64 for millis(), so one count is 64 cycles. A call takes only a
+* few counts, but the calls start at all points of the timer's count, so
+* the average over many of them comes out finer than a count. Whole
+* ticks are timed with micros().
+*
+* Build with LEDSM_PROFILE defined for the library and the sketch (add
+* -DLEDSM_PROFILE to CXXFLAGS). Without it every hook below is empty and
+* nothing is added to the build. LEDSM_PROFILE_POLL() in loop() prints
+* the figures whenever a '?' comes in on the port, and clears them on a
+* '!':
+*
+*	void loop()
+*	{
+*		g_Runner.service();
+*		LEDSM_PROFILE_POLL(Serial);
+*	}
+*/
+class LedProfile
+{
+public:
+	enum
+	{
+		eStates = LedStateMachine::eStateSteady + 1,
+		eLateBuckets = 8,
+		eLateShift = 6					// the first bucket is under 1 << eLateShift us
+	};
+
+	/**
+	* The figures, kept together so they can be copied out in one go
+	*/
+	struct Figures
+	{
+		uint32_t m_Calls[eStates];
+		uint32_t m_Counts[eStates];		// timer 0 counts
+		uint8_t m_MaxCounts[eStates];
+		uint32_t m_Ticks;
+		uint32_t m_LatencySum;			// us
+		uint16_t m_MaxLatency;			// us
+		uint16_t m_Overruns;
+		uint16_t m_Late[eLateBuckets];
+	};
+
+	static void clear(void);
+	static void report(Print& a_Out);
+	static void poll(Stream& a_Serial);
+
+	/**
+	* Read the cycle timer
+	*
+	* @return - timer 0 count, 64 cycles each
+	*/
+	static uint8_t stamp(void) { return TCNT0; }
+
+	/**
+	* Account for one updateState() call
+	*
+	* @param [in] a_State - state the machine was in when the call started
+	* @param [in] a_Stamp - stamp() from before the call
+	*/
+	static void state(uint8_t a_State, uint8_t a_Stamp)
+	{
+		uint8_t l_Counts = TCNT0 - a_Stamp;
+
+		++s_Figures.m_Calls[a_State];
+		s_Figures.m_Counts[a_State] += l_Counts;
+		if (l_Counts > s_Figures.m_MaxCounts[a_State])
+			s_Figures.m_MaxCounts[a_State] = l_Counts;
+	}
+
+	static void late(uint32_t a_Late);
+	static void tick(uint32_t a_Start, uint32_t a_Period);
+
+protected:
+	static Figures s_Figures;
+	static uint32_t s_Late;				// how late the tick being run started, us
+};
+
+#define LEDSM_PROFILE_STATE_BEGIN(var, machine)		uint8_t var##State = (machine).getState(); uint8_t var = LedProfile::stamp()
+#define LEDSM_PROFILE_STATE_END(var)				LedProfile::state(var##State, var)
+#define LEDSM_PROFILE_TICK_BEGIN(var)				uint32_t var = micros()
+#define LEDSM_PROFILE_TICK_END(var, period)			LedProfile::tick(var, period)
+#define LEDSM_PROFILE_LATE(us)						LedProfile::late(us)
+#define LEDSM_PROFILE_POLL(serial)					LedProfile::poll(serial)
+#else
+#define LEDSM_PROFILE_STATE_BEGIN(var, machine)
+#define LEDSM_PROFILE_STATE_END(var)
+#define LEDSM_PROFILE_TICK_BEGIN(var)
+#define LEDSM_PROFILE_TICK_END(var, period)
+#define LEDSM_PROFILE_LATE(us)
+#define LEDSM_PROFILE_POLL(serial)
+#endif
+
+#endif
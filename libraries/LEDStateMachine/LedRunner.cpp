@@ -0,0 +1,430 @@
+#include "Arduino.h"
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include "LedRunner.h"
+#include "LedProfile.h"
+#include "LedTrace.h"
+
+// the Arduino core's millis() clock, kept by wiring.c
+extern "C" volatile unsigned long timer0_overflow_count;
+extern "C" volatile unsigned long timer0_millis;
+
+static volatile bool s_WdtFired = false;
+
+/**
+* Create the LedRunner object
+*
+* @param [in] a_Machines - the state machines to run
+* @param [in] a_Count - number of state machines in a_Machines
+* @param [in] a_Scheduler - the tick source
+*/
+LedRunner::LedRunner(LedStateMachine* const* a_Machines, uint8_t a_Count, TickScheduler& a_Scheduler)
+	: m_Machines(a_Machines), m_Count(a_Count), m_Scheduler(a_Scheduler), m_Sleep(eSleepOff), m_WdtUs(0), m_MillisFract(0), m_Owed(0), m_SkippedTicks(0), m_Dropped(0), m_Wakeups(0), m_Writes(0)
+{
+}
+
+/**
+* Run any due ticks, skip ahead to the next deadline and, if sleep is on,
+* sleep until then
+*
+* @note - this is called from loop()
+*
+* @param [in] a_Now - the current micros() value, the sleep reads its own
+*/
+void LedRunner::service(uint32_t a_Now)
+{
+	uint16_t l_Idle;
+	uint32_t l_Dropped;
+
+	while (m_Scheduler.due(a_Now))
+	{
+		// the ticks skipped ahead came before this one, then the dropped
+		// ticks, the oldest of the rest
+		catchUp();
+		l_Dropped = m_Scheduler.getDropped();
+		if (l_Dropped > m_Dropped)
+		{
+			for (uint8_t i = 0; i < m_Count; i++)
+			{
+				m_Machines[i]->advance(l_Dropped - m_Dropped);
+			}
+			LEDSM_TRACE_TICKS(l_Dropped - m_Dropped);
+		}
+		m_Dropped = l_Dropped;
+		tick();
+	}
+
+	// every channel is only counting down until the earliest deadline,
+	// so skip the schedule past those ticks rather than waking up for
+	// each one. The channels are moved over them when the deadline comes.
+	if (!m_Owed)
+	{
+		l_Idle = idleTicks();
+		if (l_Idle)
+		{
+			m_Scheduler.skip(l_Idle);
+			m_Owed = l_Idle;
+			m_SkippedTicks += l_Idle;
+		}
+	}
+
+	if (eSleepOff != m_Sleep)
+	{
+		sleepUntilDue();
+	}
+}
+
+/**
+* Run one tick of every state machine, then write the LEDs
+*
+* @note - service() calls this when a tick is due, LedTimer calls it from
+*  its interrupt instead
+*/
+void LedRunner::tick(void)
+{
+	LEDSM_PROFILE_TICK_BEGIN(l_Start);
+
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		LEDSM_PROFILE_STATE_BEGIN(l_Stamp, *m_Machines[i]);
+		LEDSM_TRACE_STATE_BEGIN(l_From, *m_Machines[i]);
+		m_Machines[i]->updateState();
+		LEDSM_TRACE_STATE_END(l_From, *m_Machines[i]);
+		LEDSM_PROFILE_STATE_END(l_Stamp);
+	}
+	write();
+	LEDSM_TRACE_TICKS(1);
+
+	LEDSM_PROFILE_TICK_END(l_Start, m_Scheduler.getPeriod());
+}
+
+/**
+* Move every state machine on by a number of ticks without running each
+* one, then write the LEDs
+*
+* @param [in] a_Ticks - number of ticks
+*/
+void LedRunner::advance(uint32_t a_Ticks)
+{
+	catchUp();
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		m_Machines[i]->advance(a_Ticks);
+	}
+	LEDSM_TRACE_TICKS(a_Ticks);
+	write();
+}
+
+/**
+* Start every state machine a_Tick ticks into its table, so a box that
+* is powered up late can join a show that is already playing
+*
+* @param [in] a_Tick - number of ticks since the start of the show
+*/
+void LedRunner::seekTo(uint32_t a_Tick)
+{
+	m_Owed = 0;
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		m_Machines[i]->seekTo(a_Tick);
+	}
+	LEDSM_TRACE_SEEK(a_Tick);
+	write();
+}
+
+/**
+* Take back the ticks skipped ahead that are still to come, so the next
+* tick is due within a period of a_Now and the state machines are where
+* they should be at a_Now
+*
+* @note - call it before changing a state machine between ticks, the
+*  ticks skipped ahead were only quiet for the machines as they were
+*
+* @param [in] a_Now - the current micros() value
+*/
+void LedRunner::wake(uint32_t a_Now)
+{
+	int32_t l_Early;
+	uint16_t l_Ahead;
+
+	if (!m_Owed)
+	{
+		return;
+	}
+
+	// the skipped ticks come a period apart before the deadline, the ones
+	// not due yet are those more than a period before it from a_Now
+	l_Early = (int32_t)(m_Scheduler.getDeadline() - a_Now);
+	if (l_Early > (int32_t)m_Scheduler.getPeriod())
+	{
+		l_Ahead = (l_Early - 1) / m_Scheduler.getPeriod();
+		if (l_Ahead > m_Owed)
+		{
+			l_Ahead = m_Owed;
+		}
+		m_Scheduler.rewind(l_Ahead);
+
+		// a trimmed period is a little longer, so one more may be ahead
+		if (l_Ahead < m_Owed && (int32_t)(m_Scheduler.getDeadline() - a_Now) > (int32_t)m_Scheduler.getPeriod())
+		{
+			m_Scheduler.rewind(1);
+			++l_Ahead;
+		}
+		m_Owed -= l_Ahead;
+		m_SkippedTicks -= l_Ahead;
+	}
+	catchUp();
+}
+
+/**
+* Play a group on one of the state machines from the next tick
+*
+* @note - see LedStateMachine::selectGroup(), the runner is woken first
+*  so the group does not wait for a deadline set while the machine was
+*  counting down
+*
+* @param [in] a_Machine - index of the state machine
+* @param [in] a_Group - number of the group, 0 for the first in the table
+* @param [in] a_Now - the current micros() value
+* @return - false if there is no such group, the machine plays on
+*/
+bool LedRunner::selectGroup(uint8_t a_Machine, uint16_t a_Group, uint32_t a_Now)
+{
+	if (a_Machine >= m_Count)
+	{
+		return false;
+	}
+	wake(a_Now);
+	return m_Machines[a_Machine]->selectGroup(a_Group);
+}
+
+/**
+* Move the state machines over the ticks skipped ahead
+*/
+void LedRunner::catchUp(void)
+{
+	if (m_Owed)
+	{
+		for (uint8_t i = 0; i < m_Count; i++)
+		{
+			m_Machines[i]->skipTicks(m_Owed);
+		}
+		LEDSM_TRACE_TICKS(m_Owed);
+		m_Owed = 0;
+	}
+}
+
+/**
+* Put the LEDs that changed this tick on their pins
+*/
+void LedRunner::write(void)
+{
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		if (m_Machines[i]->getLED().write())
+		{
+			++m_Writes;
+		}
+	}
+}
+
+/**
+* Find the earliest deadline across the state machines
+*
+* @return - number of ticks every state machine can skip
+*/
+uint16_t LedRunner::idleTicks(void)
+{
+	uint16_t l_Idle = 0xffff;
+
+	for (uint8_t i = 0; i < m_Count && l_Idle; i++)
+	{
+		uint16_t l_Ticks = m_Machines[i]->ticksUntilTransition();
+
+		if (l_Ticks < l_Idle)
+		{
+			l_Idle = l_Ticks;
+		}
+	}
+	return l_Idle;
+}
+
+/**
+* Sleep until the scheduler's next deadline
+*
+* @note - idle mode is the deepest one that keeps the PWM timers running.
+*  Timer0's overflow interrupt (the millis() clock) wakes the MCU about
+*  once a millisecond, unless the watchdog sleep has it masked
+*/
+void LedRunner::sleepUntilDue(void)
+{
+	int32_t l_Left;
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	while ((l_Left = (int32_t)(m_Scheduler.getDeadline() - micros())) > 0)
+	{
+		if (eSleepWatchdog == m_Sleep && watchdogSleep(l_Left))
+		{
+			continue;
+		}
+		sleep_mode();
+		++m_Wakeups;
+	}
+}
+
+/**
+* Sleep part of a hold on the watchdog, with Timer0's overflow interrupt
+* masked so it does not wake the MCU every 1024 us
+*
+* Timer0 counts on while its interrupt is masked, it is the PWM of pins
+* 5 and 6. Afterwards the watchdog's time says about how many overflows
+* the millis() clock missed and TCNT0 says exactly where in one the count
+* is, so the clock is put back to the count nearest the watchdog's time.
+* That needs the watchdog right to within 512 us: it is timed against
+* micros() the first time, kept up to date from every sleep after that,
+* and slept on for at most 256 ms at a time.
+*
+* @param [in] a_Us - microseconds left until the deadline
+*
+* @return - false if the hold is too short to sleep on the watchdog
+*/
+bool LedRunner::watchdogSleep(uint32_t a_Us)
+{
+	uint8_t l_Prescale;
+	uint8_t l_Count;
+	uint8_t l_Start;
+	uint32_t l_Period;
+	uint32_t l_Counts;
+	uint32_t l_Overflows;
+	uint32_t l_Missed;
+	uint32_t l_Fract;
+
+	if (!m_WdtUs)
+	{
+		// the oscillator is only good to 10% or so until it is timed
+		if (a_Us < (LEDRUNNER_WDT_NOMINAL_US << LEDRUNNER_WDT_CAL_PRESCALE) * 3 / 2)
+			return false;
+		calibrateWatchdog();
+		return true;
+	}
+
+	// the longest period that ends before the deadline, with some margin
+	for (l_Prescale = LEDRUNNER_WDT_MAX_PRESCALE; ; l_Prescale--)
+	{
+		l_Period = (uint32_t)m_WdtUs << l_Prescale;
+		if (l_Period + (l_Period >> 5) + 1024 <= a_Us)
+			break;
+		if (!l_Prescale)
+			return false;
+	}
+
+	cli();
+	TIMSK0 &= ~_BV(TOIE0);
+
+	// where the clock is, with an overflow that is flagged but not counted
+	l_Start = TCNT0;
+	l_Overflows = timer0_overflow_count;
+	if ((TIFR0 & _BV(TOV0)) && l_Start < 255)
+		l_Overflows++;
+
+	startWatchdog(l_Prescale);
+	waitWatchdog();
+	stopWatchdog();
+
+	// Timer0 counts 4 us steps; find the one TCNT0 is at nearest the
+	// watchdog's time. An overflow flagged after TCNT0 was read is left
+	// for the interrupt, as micros() does.
+	TIFR0 = _BV(TOV0);
+	l_Count = TCNT0;
+	if ((TIFR0 & _BV(TOV0)) && l_Count < 255)
+		TIFR0 = _BV(TOV0);
+	l_Counts = l_Start + (l_Period >> 2);
+	l_Counts += (int8_t)(l_Count - (uint8_t)l_Counts);
+
+	// how long the watchdog really took, for the next one
+	m_WdtUs += ((int32_t)(((l_Counts - l_Start) << 2) >> l_Prescale) - m_WdtUs) / 4;
+
+	// put the clock back, and millis() on by 1.024 ms an overflow as the
+	// core's interrupt would have
+	l_Overflows += l_Counts >> 8;
+	l_Missed = l_Overflows - timer0_overflow_count;
+	l_Fract = l_Missed * 24 + m_MillisFract;
+	timer0_millis += l_Missed + l_Fract / 1000;
+	m_MillisFract = l_Fract % 1000;
+	timer0_overflow_count = l_Overflows;
+
+	TIMSK0 |= _BV(TOIE0);
+	sei();
+	return true;
+}
+
+/**
+* Time the watchdog against micros(), Timer0's interrupt left running
+*/
+void LedRunner::calibrateWatchdog(void)
+{
+	uint32_t l_Start;
+
+	cli();
+	startWatchdog(LEDRUNNER_WDT_CAL_PRESCALE);
+	l_Start = micros();
+	waitWatchdog();
+	m_WdtUs = (micros() - l_Start) >> LEDRUNNER_WDT_CAL_PRESCALE;
+	stopWatchdog();
+	sei();
+}
+
+/**
+* Start the watchdog in interrupt mode, from the start of its period
+*
+* @param [in] a_Prescale - the period is the shortest one << a_Prescale
+*
+* @note - called with interrupts off
+*/
+void LedRunner::startWatchdog(uint8_t a_Prescale)
+{
+	// a watchdog reset flag left set would keep it in reset mode
+	MCUSR &= ~_BV(WDRF);
+	wdt_reset();
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = _BV(WDIE) | ((a_Prescale & 8) ? _BV(WDP3) : 0) | (a_Prescale & 7);
+	s_WdtFired = false;
+}
+
+/**
+* Sleep until the watchdog's interrupt, whatever else wakes the MCU
+*
+* @note - called and returns with interrupts off. The instruction after
+*  sei() runs before any interrupt, so the sleep can not miss one that
+*  comes after the check.
+*/
+void LedRunner::waitWatchdog(void)
+{
+	while (!s_WdtFired)
+	{
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+		++m_Wakeups;
+	}
+}
+
+/**
+* Stop the watchdog
+*
+* @note - called with interrupts off
+*/
+void LedRunner::stopWatchdog(void)
+{
+	wdt_reset();
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = 0;
+}
+
+ISR(WDT_vect)
+{
+	s_WdtFired = true;
+}
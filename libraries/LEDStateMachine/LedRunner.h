@@ -0,0 +1,149 @@
+/**
+* @file LedRunner
+* @brief defines the LedRunner class that ticks a set of state machines
+*
+*/
+#ifndef __LEDRUNNER_H__
+#define __LEDRUNNER_H__
+
+#include "LEDStateMachine.h"
+#include "TickScheduler.h"
+
+// the watchdog's shortest period in microseconds, before it is timed
+#define LEDRUNNER_WDT_NOMINAL_US	16000UL
+// the longest watchdog sleep is its shortest period << this, 256 ms
+#define LEDRUNNER_WDT_MAX_PRESCALE	4
+// the first watchdog sleep is timed against micros(), 64 ms
+#define LEDRUNNER_WDT_CAL_PRESCALE	2
+
+/**
+* The LedRunner class runs all of a sketch's state machines off one
+* TickScheduler, and skips the ticks where nothing would change.
+*
+* After the due ticks have run it asks every state machine how long it
+* will only be counting down. The smallest answer is the next deadline;
+* the scheduler skips those ticks up front, so loop() does no work until
+* the deadline, and the state machines are moved over them when it comes.
+* Anything that changes a state machine in between, like selectGroup(),
+* has to wake() the runner first. With setSleep() the MCU sleeps until
+* the deadline as well:
+*
+*	- eSleepIdle sleeps in idle mode. Timer0's millis() interrupt still
+*	  wakes it every 1024 us, each wakeup checks the deadline.
+*	- eSleepWatchdog sleeps the long holds on the watchdog, with Timer0's
+*	  interrupt masked, waking a few times a second (see watchdogSleep()).
+*	  The other interrupts still run, but loop() does not, so serial
+*	  input waits up to 256 ms. The runner owns WDT_vect.
+*
+* Sleep is off by default, loop() comes straight back and can do other
+* work; the LEDSM_PROFILE and LEDSM_TRACE builds poll the serial port
+* from loop() and should leave it off.
+*
+* The state machines only stage their LEDs; once all of them have run a
+* tick, the runner writes the ones whose value changed.
+*
+* Ticks the scheduler drops after an overrun are not lost to the show,
+* the state machines are advanced over them before the next one runs.
+*/
+class LedRunner
+{
+public:
+	enum SleepMode
+	{
+		eSleepOff,
+		eSleepIdle,
+		eSleepWatchdog
+	};
+
+	LedRunner(LedStateMachine* const* a_Machines, uint8_t a_Count, TickScheduler& a_Scheduler);
+
+	void service(uint32_t a_Now);
+	void tick(void);
+	void advance(uint32_t a_Ticks);
+	void seekTo(uint32_t a_Tick);
+	void wake(uint32_t a_Now);
+	bool selectGroup(uint8_t a_Machine, uint16_t a_Group, uint32_t a_Now);
+
+	/**
+	* Run the due ticks, skip ahead and sleep, by the current time
+	*/
+	void service(void) { service(micros()); }
+
+	/**
+	* Take back the ticks skipped ahead that are still to come, by the
+	* current time
+	*/
+	void wake(void) { wake(micros()); }
+
+	/**
+	* Play a group on one of the state machines from the next tick, by the
+	* current time
+	*
+	* @param [in] a_Machine - index of the state machine
+	* @param [in] a_Group - number of the group, 0 for the first in the table
+	* @return - false if there is no such group, the machine plays on
+	*/
+	bool selectGroup(uint8_t a_Machine, uint16_t a_Group) { return selectGroup(a_Machine, a_Group, micros()); }
+
+	/**
+	* Choose how to wait for the next deadline. Sketches that do other
+	* work in loop() should leave it eSleepOff.
+	*
+	* @param [in] a_Mode - one of the SleepMode
+	*/
+	void setSleep(SleepMode a_Mode) { m_Sleep = a_Mode; }
+
+	/**
+	* Getter for the m_SkippedTicks
+	*
+	* @return - number of ticks accounted for without running updateState()
+	*/
+	uint32_t getSkippedTicks(void) { return m_SkippedTicks; }
+
+	/**
+	* Getter for the m_Wakeups
+	*
+	* @return - number of times the MCU woke from sleep
+	*/
+	uint32_t getWakeups(void) { return m_Wakeups; }
+
+	/**
+	* Getter for the m_WdtUs
+	*
+	* @return - the watchdog's shortest period as timed, 0 until it is
+	*/
+	uint16_t getWatchdogUs(void) { return m_WdtUs; }
+
+	/**
+	* Getter for the m_Writes
+	*
+	* @return - number of times a pin was written
+	*/
+	uint32_t getWrites(void) { return m_Writes; }
+
+protected:
+	void write(void);
+	void catchUp(void);
+	uint16_t idleTicks(void);
+	void sleepUntilDue(void);
+	bool watchdogSleep(uint32_t a_Us);
+	void calibrateWatchdog(void);
+	void startWatchdog(uint8_t a_Prescale);
+	void waitWatchdog(void);
+	void stopWatchdog(void);
+
+	LedStateMachine* const* m_Machines;
+	uint8_t m_Count;
+	TickScheduler& m_Scheduler;
+	uint8_t m_Sleep;			// one of the SleepMode
+	uint16_t m_WdtUs;			// the watchdog's shortest period, timed against Timer0
+	uint16_t m_MillisFract;		// thousandths of a ms owed to millis() by watchdog sleeps
+
+	uint16_t m_Owed;			// ticks skipped ahead the state machines are not moved over yet
+	uint32_t m_SkippedTicks;
+	uint32_t m_Dropped;			// scheduler drops already advanced over
+	uint32_t m_Wakeups;
+	uint32_t m_Writes;
+};
+
+#endif
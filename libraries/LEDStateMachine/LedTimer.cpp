@@ -0,0 +1,141 @@
+#include "Arduino.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "LedTimer.h"
+#include "LedProfile.h"
+
+LedTimer* volatile LedTimer::s_Active = NULL;
+
+/**
+* Create the LedTimer object
+*
+* @param [in] a_Runner - the state machines to tick
+* @param [in] a_PeriodUs - time between ticks, in microseconds, at least LEDTIMER_OVERFLOW_US
+*/
+LedTimer::LedTimer(LedRunner& a_Runner, uint32_t a_PeriodUs)
+	: m_Runner(a_Runner), m_Period(a_PeriodUs), m_Elapsed(0), m_Ticks(0), m_MaxIsrTime(0), m_MaxLate(0)
+{
+}
+
+/**
+* Start ticking from the interrupt
+*/
+void LedTimer::begin(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		s_Active = this;
+		m_Elapsed = 0;
+		TIFR1 = _BV(TOV1);
+		TIMSK1 |= _BV(TOIE1);
+	}
+}
+
+/**
+* Stop ticking, the foreground owns the state machines again
+*/
+void LedTimer::end(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TIMSK1 &= ~_BV(TOIE1);
+		s_Active = NULL;
+	}
+}
+
+/**
+* Getter for the m_Ticks
+*
+* @return - number of ticks run by the interrupt
+*/
+uint32_t LedTimer::getTicks(void)
+{
+	uint32_t l_Ticks;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		l_Ticks = m_Ticks;
+	}
+	return l_Ticks;
+}
+
+/**
+* Getter for the m_MaxIsrTime
+*
+* @return - the longest the interrupt has taken to run a tick, in microseconds
+*/
+uint16_t LedTimer::getMaxIsrTime(void)
+{
+	uint16_t l_Time;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		l_Time = m_MaxIsrTime;
+	}
+	return l_Time;
+}
+
+/**
+* Getter for the m_MaxLate
+*
+* @return - the furthest a tick has run past its deadline, in microseconds
+*/
+uint16_t LedTimer::getMaxLate(void)
+{
+	uint16_t l_Late;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		l_Late = m_MaxLate;
+	}
+	return l_Late;
+}
+
+/**
+* Zero the tick count and the worst case times
+*/
+void LedTimer::clearStats(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		m_Ticks = 0;
+		m_MaxIsrTime = 0;
+		m_MaxLate = 0;
+	}
+}
+
+/**
+* Account for one timer 1 overflow, running a tick if one is due
+*
+* @note - interrupts are off in here, micros() still works
+*/
+void LedTimer::overflow(void)
+{
+	uint32_t l_Start;
+	uint32_t l_Time;
+
+	m_Elapsed += LEDTIMER_OVERFLOW_US;
+	if (m_Elapsed < m_Period)
+		return;
+
+	l_Start = micros();
+	m_Elapsed -= m_Period;
+	if (m_Elapsed > m_MaxLate)
+		m_MaxLate = m_Elapsed;
+	LEDSM_PROFILE_LATE(m_Elapsed);
+
+	m_Runner.tick();
+	++m_Ticks;
+
+	l_Time = micros() - l_Start;
+	if (l_Time > m_MaxIsrTime)
+		m_MaxIsrTime = l_Time > 0xffff ? 0xffff : l_Time;
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	LedTimer* l_Timer = LedTimer::s_Active;
+
+	if (l_Timer)
+		l_Timer->overflow();
+}
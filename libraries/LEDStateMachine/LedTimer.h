@@ -0,0 +1,70 @@
+/**
+* @file LedTimer
+* @brief defines the LedTimer class that ticks a LedRunner from the timer 1 interrupt
+*
+*/
+#ifndef __LEDTIMER_H__
+#define __LEDTIMER_H__
+
+#include "LedRunner.h"
+
+// timer 1 as the Arduino core sets it up: 8 bit phase correct PWM, clock / 64
+#define LEDTIMER_OVERFLOW_US	(510UL * 64 / (F_CPU / 1000000UL))
+
+/**
+* The LedTimer class runs a LedRunner's ticks from the timer 1 overflow
+* interrupt, so blocking work in loop() does not hold the LEDs up.
+*
+* Timer 1 is left the way the Arduino core sets it up, so pins 9 and 10
+* keep their PWM. It overflows every LEDTIMER_OVERFLOW_US (2040 us at
+* 16 MHz); the interrupt adds that up and runs a tick each time a whole
+* period has gone by, which keeps the average rate exact with at most one
+* overflow of jitter.
+*
+* The state machines belong to the interrupt once begin() is called. The
+* foreground can stop it with end(), or wrap its own changes to them in
+* ATOMIC_BLOCK(ATOMIC_RESTORESTATE). The statistics getters do that
+* themselves.
+*
+*	LedTimer g_Timer(g_Runner, 10000);
+*
+*	void setup()
+*	{
+*		g_Timer.begin();
+*	}
+*
+* @note - only one LedTimer can be running, and nothing else can use the
+*  timer 1 overflow interrupt (the TimerOne library does)
+*/
+class LedTimer
+{
+public:
+	LedTimer(LedRunner& a_Runner, uint32_t a_PeriodUs = 10000);
+
+	void begin(void);
+	void end(void);
+
+	uint32_t getTicks(void);
+	uint16_t getMaxIsrTime(void);
+	uint16_t getMaxLate(void);
+	void clearStats(void);
+
+	/**
+	* Run from the timer 1 overflow interrupt, not for calling directly
+	*/
+	void overflow(void);
+
+	static LedTimer* volatile s_Active;	// the LedTimer the interrupt serves
+
+protected:
+	LedRunner& m_Runner;
+	uint32_t m_Period;
+
+	// written by the interrupt
+	volatile uint32_t m_Elapsed;	// time since the last tick was due
+	volatile uint32_t m_Ticks;
+	volatile uint16_t m_MaxIsrTime;	// longest tick, in us
+	volatile uint16_t m_MaxLate;	// furthest a tick ran past its deadline, in us
+};
+
+#endif
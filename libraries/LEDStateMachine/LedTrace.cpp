@@ -0,0 +1,107 @@
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "LedTrace.h"
+
+#ifdef LEDSM_TRACE
+
+LedTrace::Event LedTrace::s_Events[LEDSM_TRACE_EVENTS];
+volatile uint8_t LedTrace::s_Head = 0;
+volatile uint8_t LedTrace::s_Tail = 0;
+uint8_t LedTrace::s_Lost = 0;
+uint32_t LedTrace::s_Tick = 0;
+
+/**
+* Empty the ring and start the tick count again
+*/
+void LedTrace::clear(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		s_Head = 0;
+		s_Tail = 0;
+		s_Lost = 0;
+		s_Tick = 0;
+		epoch();
+	}
+}
+
+/**
+* Start the tick count again at a_Tick, after LedRunner::seekTo()
+*
+* @param [in] a_Tick - the tick the show was moved to
+*/
+void LedTrace::seek(uint32_t a_Tick)
+{
+	s_Tick = a_Tick;
+	epoch();
+}
+
+/**
+* Record the top of the tick count
+*/
+void LedTrace::epoch(void)
+{
+	if (s_Lost)
+		lost();
+	put(eTraceEpoch << 4, 0, s_Tick >> 16);
+}
+
+/**
+* Record how many events were lost, once there is room again
+*/
+void LedTrace::lost(void)
+{
+	uint8_t l_Lost = s_Lost;
+
+	if ((uint8_t)(s_Head - s_Tail) == LEDSM_TRACE_EVENTS)
+		return;
+	s_Lost = 0;
+	put(eTraceLost << 4, l_Lost, s_Tick);
+}
+
+/**
+* Send as many events as fit in the port's transmit buffer, in one frame
+*
+* @note - this is called from loop(), it never waits on the port
+*
+* @param [in] a_Out - where to send them, normally Serial
+*/
+void LedTrace::drain(Print& a_Out)
+{
+	uint8_t l_Frame[eMaxFrameEvents * eEventBytes + 4];
+	uint8_t l_Tail = s_Tail;
+	uint8_t l_Count = s_Head - l_Tail;
+	int l_Room = (a_Out.availableForWrite() - 4) / eEventBytes;
+	uint8_t l_Sum;
+	uint8_t l_Pos;
+
+	if (l_Count > eMaxFrameEvents)
+		l_Count = eMaxFrameEvents;
+	if (l_Room < l_Count)
+		l_Count = l_Room > 0 ? l_Room : 0;
+	if (0 == l_Count)
+		return;
+
+	l_Frame[0] = eStreamSync;
+	l_Frame[1] = l_Count * eEventBytes;
+	l_Frame[2] = eFrameTrace;
+	l_Sum = l_Frame[1] + l_Frame[2];
+	l_Pos = 3;
+	for (uint8_t i = 0; i < l_Count; i++)
+	{
+		const Event& l_Event = s_Events[(uint8_t)(l_Tail + i) & (LEDSM_TRACE_EVENTS - 1)];
+
+		l_Frame[l_Pos++] = l_Event.m_Head;
+		l_Frame[l_Pos++] = l_Event.m_Arg;
+		l_Frame[l_Pos++] = l_Event.m_Tick;
+		l_Frame[l_Pos++] = l_Event.m_Tick >> 8;
+		l_Sum += l_Frame[l_Pos - 4] + l_Frame[l_Pos - 3] + l_Frame[l_Pos - 2] + l_Frame[l_Pos - 1];
+	}
+	l_Frame[l_Pos++] = -l_Sum;
+
+	// the slots are only given back once the frame is out of them
+	a_Out.write(l_Frame, l_Pos);
+	s_Tail = l_Tail + l_Count;
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**
+* @file LedTrace
+* @brief binary event trace of the state machines, built with LEDSM_TRACE
+*
+*/
+#ifndef __LEDTRACE_H__
+#define __LEDTRACE_H__
+
+#ifdef LEDSM_TRACE
+
+#ifndef LEDSM_TRACE_EVENTS
+#define LEDSM_TRACE_EVENTS	32		// ring size in events, a power of two up to 128
+#endif
+
+/**
+* The LedTrace class records what the state machines do as they do it,
+* for when a show looks wrong on the box and the host tools say the
+* tables are fine.
+*
+* Every event is four bytes in a ring in SRAM, put there with a handful
+* of stores and no interrupts turned off:
+*
+*	TYPE|CHANNEL ARG TICK[2]
+*
+* TYPE is in the top nibble, CHANNEL in the bottom one is the LED's pin.
+* TICK is the low 16 bits of the show's tick count, LSB first: the tick
+* being run, or where an advance() or seekTo() of the LedRunner moved the
+* show to for the writes that follow it. The events are:
+*
+*	eTraceState - ARG is the state the machine moved to
+*	eTraceGroup - ARG is the number of steps in the group it started
+*	eTraceRepeat - ARG is the low byte of the repetitions left
+*	eTraceWrite - ARG is the value written to the pin
+*	eTraceEpoch - TICK is the top 16 bits of the tick count, sent every
+*	  256 ticks and after a seek, so a decoder can rebuild the full count
+*	  even if it joins in the middle
+*	eTraceLost - ARG is how many events found the ring full (up to 255)
+*
+* drain() in loop() moves events to the port in the LEDStream framing,
+* with TYPE eFrameTrace and a whole number of events as the payload. It
+* only writes what fits in the transmit buffer, so loop() never waits on
+* the port and the interrupt sends the bytes out. host/ledtrace decodes
+* a capture of the port.
+*
+* Build with LEDSM_TRACE defined for the library and the sketch (add
+* -DLEDSM_TRACE to CXXFLAGS). Without it every hook below is empty and
+* nothing is added to the build.
+*
+*	void loop()
+*	{
+*		g_Runner.service();
+*		LEDSM_TRACE_DRAIN(Serial);
+*	}
+*
+* @note - the events are recorded by whatever runs the ticks, loop() or
+*  LedTimer's interrupt, and drained by loop(), one side each. A sleeping
+*  LedRunner only comes back to loop() at its next deadline, a busy show
+*  at 115200 baud drains best with the sleep left off.
+*/
+class LedTrace
+{
+public:
+	enum EventType
+	{
+		eTraceEpoch,
+		eTraceState,
+		eTraceGroup,
+		eTraceRepeat,
+		eTraceWrite,
+		eTraceLost
+	};
+
+	enum
+	{
+		eStreamSync = 0xa5,			// same as LEDStream
+		eFrameTrace = 0x82,
+		eEventBytes = 4,
+		eMaxFrameEvents = 15,		// 60 byte payload, the frame fits the AVR core's 64 byte buffer
+		eEpochShift = 8				// an epoch goes out every 1 << eEpochShift ticks
+	};
+
+	// One recorded event
+	struct Event
+	{
+		uint8_t m_Head;				// type << 4 | channel
+		uint8_t m_Arg;
+		uint16_t m_Tick;
+	};
+
+	static void clear(void);
+	static void drain(Print& a_Out);
+
+	/**
+	* Record an event at the current tick
+	*
+	* @param [in] a_Type - one of EventType
+	* @param [in] a_Channel - the LED's pin
+	* @param [in] a_Arg - depends on a_Type
+	*/
+	static void event(uint8_t a_Type, uint8_t a_Channel, uint8_t a_Arg)
+	{
+		if (s_Lost)
+			lost();
+		put(a_Type << 4 | (a_Channel & 0x0f), a_Arg, s_Tick);
+	}
+
+	/**
+	* Move the tick count on
+	*
+	* @param [in] a_Ticks - ticks run or skipped
+	*/
+	static void ticks(uint32_t a_Ticks)
+	{
+		uint32_t l_Tick = s_Tick + a_Ticks;
+		bool l_Epoch = (l_Tick ^ s_Tick) >> eEpochShift;
+
+		s_Tick = l_Tick;
+		if (l_Epoch)
+			epoch();
+	}
+
+	static void seek(uint32_t a_Tick);
+
+	/**
+	* Getter for the s_Lost
+	*
+	* @return - events lost since the last eTraceLost went in the ring
+	*/
+	static uint8_t getLost(void) { return s_Lost; }
+
+protected:
+	/**
+	* Put an event in the ring, or count it lost if the ring is full
+	*/
+	static void put(uint8_t a_Head, uint8_t a_Arg, uint16_t a_Tick)
+	{
+		uint8_t l_Head = s_Head;
+		Event* l_Event;
+
+		if ((uint8_t)(l_Head - s_Tail) == LEDSM_TRACE_EVENTS)
+		{
+			if (s_Lost != 0xff)
+				++s_Lost;
+			return;
+		}
+		l_Event = &s_Events[l_Head & (LEDSM_TRACE_EVENTS - 1)];
+		l_Event->m_Head = a_Head;
+		l_Event->m_Arg = a_Arg;
+		l_Event->m_Tick = a_Tick;
+		s_Head = l_Head + 1;
+	}
+
+	static void lost(void);
+	static void epoch(void);
+
+	static Event s_Events[LEDSM_TRACE_EVENTS];
+	static volatile uint8_t s_Head;		// free running, written by the ticks
+	static volatile uint8_t s_Tail;		// free running, written by drain()
+	static uint8_t s_Lost;
+	static uint32_t s_Tick;
+};
+
+#define LEDSM_TRACE_EVENT(type, channel, arg)		LedTrace::event(type, channel, arg)
+#define LEDSM_TRACE_STATE_BEGIN(var, machine)		uint8_t var = (machine).getState()
+#define LEDSM_TRACE_STATE_END(var, machine)			do { if ((machine).getState() != var) LedTrace::event(LedTrace::eTraceState, (machine).getLED().getPin(), (machine).getState()); } while (0)
+#define LEDSM_TRACE_TICKS(count)					LedTrace::ticks(count)
+#define LEDSM_TRACE_SEEK(tick)						LedTrace::seek(tick)
+#define LEDSM_TRACE_DRAIN(serial)					LedTrace::drain(serial)
+#else
+#define LEDSM_TRACE_EVENT(type, channel, arg)
+#define LEDSM_TRACE_STATE_BEGIN(var, machine)
+#define LEDSM_TRACE_STATE_END(var, machine)
+#define LEDSM_TRACE_TICKS(count)
+#define LEDSM_TRACE_SEEK(tick)
+#define LEDSM_TRACE_DRAIN(serial)
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#include "Arduino.h"
+#include "PwmPin.h"
+
+/**
+* Look up the timer registers of a pin
+*
+* @param [in] a_Pin - Arduino pin number
+*/
+void PwmPin::attach(uint8_t a_Pin)
+{
+	m_Pin = a_Pin;
+	m_Tccr = NULL;
+	m_Com = 0;
+
+	switch (a_Pin)
+	{
+		case 6:		m_Ocr = &OCR0A;		m_Tccr = &TCCR0A;	m_Com = _BV(COM0A1);	break;
+		case 5:		m_Ocr = &OCR0B;		m_Tccr = &TCCR0A;	m_Com = _BV(COM0B1);	break;
+		case 9:		m_Ocr = &OCR1AL;	m_Tccr = &TCCR1A;	m_Com = _BV(COM1A1);	break;
+		case 10:	m_Ocr = &OCR1BL;	m_Tccr = &TCCR1A;	m_Com = _BV(COM1B1);	break;
+		case 11:	m_Ocr = &OCR2A;		m_Tccr = &TCCR2A;	m_Com = _BV(COM2A1);	break;
+		case 3:		m_Ocr = &OCR2B;		m_Tccr = &TCCR2A;	m_Com = _BV(COM2B1);	break;
+		default:	m_Ocr = NULL;		break;
+	}
+
+	if (m_Ocr)
+	{
+		// with the compare output disconnected the pin shows its PORT bit
+		*m_Tccr &= ~m_Com;
+		digitalWrite(a_Pin, LOW);
+	}
+}
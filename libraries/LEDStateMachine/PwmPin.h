@@ -0,0 +1,76 @@
+/**
+* @file PwmPin
+* @brief defines the PwmPin class, a PWM output that writes its timer's compare register
+*
+*/
+#ifndef __PWMPIN_H__
+#define __PWMPIN_H__
+
+/**
+* The PwmPin class drives one PWM pin without going through analogWrite().
+*
+* The pin's OCRnx register and TCCRnA compare output bit are looked up once
+* when the object is made, after that a duty value is one store. The
+* compare output is only connected while the value is not 0: timer 0 runs
+* fast PWM, where an OCR of 0 still gives a short pulse every period, so 0
+* disconnects it and leaves the pin driven low by its PORT bit.
+*
+* Pins 3, 5, 6, 9, 10 and 11 on a 328. Other pins fall back to analogWrite().
+*
+* @note - timer 1 is written through OCR1xL only. The high byte comes from
+*  the shared TEMP register, which stays 0 while timer 1 runs 8 bit PWM
+*/
+class PwmPin
+{
+public:
+	PwmPin(void) : m_Pin(0), m_Ocr(NULL), m_Tccr(NULL), m_Com(0) {}
+	PwmPin(uint8_t a_Pin) { attach(a_Pin); }
+
+	void attach(uint8_t a_Pin);
+
+	/**
+	* Set the duty
+	*
+	* @param [in] a_Value - 0 is off, 255 is fully on
+	*/
+	void write(uint8_t a_Value)
+	{
+		if (NULL == m_Ocr)
+		{
+			analogWrite(m_Pin, a_Value);
+			return;
+		}
+
+		*m_Ocr = a_Value;
+		if (0 == a_Value)
+		{
+			*m_Tccr &= ~m_Com;
+		}
+		else if (!(*m_Tccr & m_Com))
+		{
+			*m_Tccr |= m_Com;
+		}
+	}
+
+	/**
+	* Getter for the m_Pin
+	*
+	* @return - a copy of m_Pin
+	*/
+	uint8_t getPin(void) { return m_Pin; }
+
+	/**
+	* Find out whether the pin has a compare register
+	*
+	* @return - true if write() stores straight to the timer
+	*/
+	bool isDirect(void) { return NULL != m_Ocr; }
+
+protected:
+	uint8_t m_Pin;
+	volatile uint8_t* m_Ocr;		// OCRnx of the pin's timer, NULL to use analogWrite()
+	volatile uint8_t* m_Tccr;		// TCCRnA of the pin's timer
+	uint8_t m_Com;					// COMnx1 bit in m_Tccr
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "Arduino.h"
+#include "TickScheduler.h"
+#include "LedProfile.h"
+
+/**
+* Create the TickScheduler object
+*
+* @param [in] a_PeriodUs - tick period in microseconds
+* @param [in] a_MaxCatchUp - most missed ticks that will be run back to back
+*/
+TickScheduler::TickScheduler(uint32_t a_PeriodUs, uint8_t a_MaxCatchUp)
+	: m_Period(a_PeriodUs), m_Deadline(0), m_Trim(0), m_TrimFraction(0), m_MaxCatchUp(a_MaxCatchUp), m_Started(false)
+{
+	clearStats();
+}
+
+/**
+* Clear the tick and overrun counters
+*/
+void TickScheduler::clearStats(void)
+{
+	m_Ticks = 0;
+	m_Overruns = 0;
+	m_Dropped = 0;
+	m_MaxLate = 0;
+}
+
+/**
+* Start the schedule, the first tick is due right away
+*
+* @param [in] a_Now - the current micros() value
+*/
+void TickScheduler::start(uint32_t a_Now)
+{
+	m_Deadline = a_Now;
+	m_Started = true;
+}
+
+/**
+* Check if a tick is due, and if so move on to the next deadline
+*
+* @note - the deadline is kept on the absolute grid, so a late tick does
+*  not push the ones after it back
+*
+* @param [in] a_Now - the current micros() value
+* @return - true if a tick should be run now
+*/
+bool TickScheduler::due(uint32_t a_Now)
+{
+	uint32_t l_Late;
+
+	if (!m_Started)
+	{
+		start(a_Now);
+	}
+
+	// signed compare so micros() wrapping every ~71 minutes is harmless
+	if ((int32_t)(a_Now - m_Deadline) < 0)
+	{
+		return false;
+	}
+
+	l_Late = a_Now - m_Deadline;
+	if (l_Late > m_MaxLate)
+	{
+		m_MaxLate = l_Late;
+	}
+	LEDSM_PROFILE_LATE(l_Late);
+
+	if (l_Late >= m_Period)
+	{
+		uint32_t l_Behind = l_Late / m_Period;
+
+		++m_Overruns;
+		// too far behind to catch up - give up on the oldest ticks
+		if (l_Behind > m_MaxCatchUp)
+		{
+			m_Dropped += l_Behind - m_MaxCatchUp;
+			m_Deadline += periods(l_Behind - m_MaxCatchUp);
+		}
+	}
+
+	m_Deadline += periods(1);
+	++m_Ticks;
+	return true;
+}
+
+/**
+* Move the schedule past ticks that the caller accounted for itself
+*
+* @param [in] a_Ticks - number of ticks to skip
+*/
+void TickScheduler::skip(uint32_t a_Ticks)
+{
+	m_Deadline += periods(a_Ticks);
+	m_Ticks += a_Ticks;
+}
+
+/**
+* Take back ticks that skip() moved the schedule past and that have not
+* come yet
+*
+* @param [in] a_Ticks - number of ticks, no more than were skipped
+*/
+void TickScheduler::rewind(uint16_t a_Ticks)
+{
+	int32_t l_Trim;
+
+	m_Ticks -= a_Ticks;
+	if (0 == m_Trim)
+	{
+		m_Deadline -= (uint32_t)a_Ticks * m_Period;
+		return;
+	}
+
+	// periods() backwards, the fraction borrows from the whole microseconds
+	l_Trim = (int32_t)m_TrimFraction - (int32_t)m_Trim * (int32_t)a_Ticks;
+	m_TrimFraction = l_Trim & 0xff;
+	m_Deadline -= (uint32_t)a_Ticks * m_Period - (l_Trim >> 8);
+}
+
+/**
+* Put the schedule on another tick, for following another board's
+*
+* @param [in] a_Ticks - number of ticks to count as fired already
+* @param [in] a_Deadline - the micros() value the next one is due at
+*/
+void TickScheduler::align(uint32_t a_Ticks, uint32_t a_Deadline)
+{
+	m_Ticks = a_Ticks;
+	m_Deadline = a_Deadline;
+	m_Started = true;
+}
+
+/**
+* Work out how long a run of periods takes, trim included
+*
+* @note - due() passes however many ticks it drops, so a_Ticks has no
+*  bound. Up to 65535 of them the trim fits a 32 bit product, more take
+*  a 64 bit one.
+*
+* @param [in] a_Ticks - number of periods
+* @return - microseconds, modulo 2^32 like the deadlines
+*/
+uint32_t TickScheduler::periods(uint32_t a_Ticks)
+{
+	int32_t l_Trim;
+	int64_t l_Long;
+
+	if (0 == m_Trim)
+	{
+		return a_Ticks * m_Period;
+	}
+
+	// the whole microseconds go in now, the fraction carries over
+	if (a_Ticks <= 0xffff)
+	{
+		l_Trim = (int32_t)m_Trim * (int32_t)a_Ticks + m_TrimFraction;
+		m_TrimFraction = l_Trim & 0xff;
+		return a_Ticks * m_Period + (l_Trim >> 8);
+	}
+	l_Long = (int64_t)m_Trim * a_Ticks + m_TrimFraction;
+	m_TrimFraction = l_Long & 0xff;
+	return a_Ticks * m_Period + (uint32_t)(l_Long >> 8);
+}
@@ -0,0 +1,134 @@
+/**
+* @file TickScheduler
+* @brief defines the fixed rate tick scheduler used to drive the state machines
+*
+*/
+#ifndef __TICKSCHEDULER_H__
+#define __TICKSCHEDULER_H__
+
+/**
+* The TickScheduler class fires ticks on absolute micros() deadlines.
+*
+* Each deadline is the previous deadline plus the period, so the time spent
+* running the state machines does not add up. If loop() falls behind, the
+* missed ticks are handed out back to back, up to m_MaxCatchUp of them;
+* anything beyond that is dropped and counted.
+*
+* Typical use in loop():
+*
+*	while (g_Ticker.due())
+*	{
+*		g_LED0SM.updateState();
+*	}
+*
+* The period can be trimmed in 1/256 us steps, and the schedule shifted
+* or moved to another tick, so TickSync can keep it in line with another
+* board's.
+*/
+class TickScheduler
+{
+public:
+	TickScheduler(uint32_t a_PeriodUs = 10000, uint8_t a_MaxCatchUp = 8);
+
+	void start(uint32_t a_Now);
+	bool due(uint32_t a_Now);
+	void skip(uint32_t a_Ticks);
+	void rewind(uint16_t a_Ticks);
+	void align(uint32_t a_Ticks, uint32_t a_Deadline);
+
+	/**
+	* Move the next deadline, and every one after it
+	*
+	* @param [in] a_Us - microseconds to move it by, negative to tick sooner
+	*/
+	void shift(int32_t a_Us) { m_Deadline += a_Us; }
+
+	/**
+	* Getter for the m_Deadline
+	*
+	* @return - the micros() value the next tick is due at
+	*/
+	uint32_t getDeadline(void) { return m_Deadline; }
+
+	/**
+	* Check the scheduler against the current time
+	*
+	* @return - true if a tick should be run now
+	*/
+	bool due(void) { return due(micros()); }
+
+	/**
+	* Setter for the m_Period
+	*
+	* @param [in] a_PeriodUs - tick period in microseconds
+	*/
+	void setPeriod(uint32_t a_PeriodUs) { m_Period = a_PeriodUs; }
+
+	/**
+	* Getter for the m_Period
+	*
+	* @return - a copy of m_Period
+	*/
+	uint32_t getPeriod(void) { return m_Period; }
+
+	/**
+	* Setter for the m_Trim
+	*
+	* @param [in] a_Trim - added to every period, in 1/256 us
+	*/
+	void setTrim(int16_t a_Trim) { m_Trim = a_Trim; }
+
+	/**
+	* Getter for the m_Trim
+	*
+	* @return - a copy of m_Trim
+	*/
+	int16_t getTrim(void) { return m_Trim; }
+
+	/**
+	* Getter for the m_Ticks
+	*
+	* @return - number of ticks fired since start
+	*/
+	uint32_t getTicks(void) { return m_Ticks; }
+
+	/**
+	* Getter for the m_Overruns
+	*
+	* @return - number of ticks that fired a whole period or more late
+	*/
+	uint32_t getOverruns(void) { return m_Overruns; }
+
+	/**
+	* Getter for the m_Dropped
+	*
+	* @return - number of ticks skipped because the backlog was past m_MaxCatchUp
+	*/
+	uint32_t getDropped(void) { return m_Dropped; }
+
+	/**
+	* Getter for the m_MaxLate
+	*
+	* @return - the latest any tick has fired, in microseconds
+	*/
+	uint32_t getMaxLate(void) { return m_MaxLate; }
+
+	void clearStats(void);
+
+protected:
+	uint32_t periods(uint32_t a_Ticks);
+
+	uint32_t m_Period;				// tick period in microseconds
+	uint32_t m_Deadline;			// micros() value the next tick is due at
+	int16_t m_Trim;					// added to every period, in 1/256 us
+	uint8_t m_TrimFraction;			// 1/256 us of trim not yet added to m_Deadline
+	uint8_t m_MaxCatchUp;			// most missed ticks that will be run back to back
+	bool m_Started;
+
+	uint32_t m_Ticks;
+	uint32_t m_Overruns;
+	uint32_t m_Dropped;
+	uint32_t m_MaxLate;
+};
+
+#endif
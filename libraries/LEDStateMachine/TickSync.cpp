@@ -0,0 +1,225 @@
+#include "Arduino.h"
+#include "TickSync.h"
+
+/**
+* Create the TickSync object
+*
+* @param [in] a_Serial - link the time frames go out on (master) or come in on (follower)
+* @param [in] a_Scheduler - the scheduler the box ticks off
+* @param [in] a_Role - eMaster or eFollower
+* @param [in] a_Baud - the link's baud rate, for how long a frame takes
+* @param [in] a_Runner - the runner to seek when a follower jumps, or NULL
+*/
+TickSync::TickSync(Stream& a_Serial, TickScheduler& a_Scheduler, Role a_Role, uint32_t a_Baud, LedRunner* a_Runner)
+	: m_Serial(a_Serial), m_Scheduler(a_Scheduler), m_Runner(a_Runner), m_Role(a_Role),
+	m_Delay((uint32_t)eFrameBytes * 10 * 1000000UL / a_Baud), m_Interval(eDefaultInterval), m_NextSend(0), m_TxEmpty(0),
+	m_Pos(0), m_Sum(0), m_Trim(0), m_LastTicks(0), m_Tracking(false), m_Syncs(0), m_Jumps(0), m_BadFrames(0), m_Error(0)
+{
+}
+
+/**
+* Get ready to sync
+*
+* @note - call once the serial port is open, before anything is sent on it
+*
+* @param [in] a_Interval - ticks between the master's frames
+*/
+void TickSync::begin(uint16_t a_Interval)
+{
+	m_Interval = a_Interval;
+	m_TxEmpty = m_Serial.availableForWrite();
+	m_NextSend = micros();
+}
+
+/**
+* Send a time frame when one is due (master), or take in what has arrived
+* (follower)
+*
+* @param [in] a_Now - the current micros() value
+*/
+void TickSync::service(uint32_t a_Now)
+{
+	if (eMaster == m_Role)
+	{
+		// only into an empty buffer, so the frame goes out straight away.
+		// The interval is timed on micros(), LedRunner moves getTicks()
+		// over a quiet stretch all at once.
+		if ((int32_t)(a_Now - m_NextSend) >= 0 && m_Serial.availableForWrite() >= m_TxEmpty)
+		{
+			send(a_Now);
+		}
+		return;
+	}
+
+	int l_Avail = m_Serial.available();
+
+	while (l_Avail-- > 0)
+	{
+		parse((uint8_t)m_Serial.read(), a_Now);
+	}
+}
+
+/**
+* Find the tick that is in progress: the next one to fire and how long
+* until it does
+*
+* @note - LedRunner accounts for quiet ticks ahead of time, and a late
+*  loop() can leave a deadline in the past, so getTicks() and
+*  getDeadline() are not always the tick in progress. The ticks skipped
+*  ahead were put in at the trimmed period, so they come off at it too.
+*
+* @param [in,out] a_Ticks - ticks fired
+* @param [in,out] a_Lead - us until the next one, brought into 1 .. period
+*/
+void TickSync::pending(uint32_t& a_Ticks, int32_t& a_Lead)
+{
+	int32_t l_Period = m_Scheduler.getPeriod();
+
+	if (a_Lead > l_Period)
+	{
+		int32_t l_Ahead = (a_Lead - 1) / l_Period;
+
+		a_Ticks -= l_Ahead;
+		a_Lead -= l_Ahead * l_Period + ((l_Ahead * m_Scheduler.getTrim()) >> 8);
+	}
+	while (a_Lead > l_Period)
+	{
+		a_Lead -= l_Period;
+		--a_Ticks;
+	}
+	while (a_Lead <= 0)
+	{
+		a_Lead += l_Period;
+		++a_Ticks;
+	}
+}
+
+/**
+* Tell the followers where the schedule is
+*
+* @param [in] a_Now - the current micros() value
+*/
+void TickSync::send(uint32_t a_Now)
+{
+	uint32_t l_Ticks = m_Scheduler.getTicks();
+	int32_t l_Lead = m_Scheduler.getDeadline() - a_Now;
+	uint8_t l_Frame[eFrameBytes];
+	uint8_t l_Sum = 0;
+
+	pending(l_Ticks, l_Lead);
+
+	l_Frame[0] = eStreamSync;
+	l_Frame[1] = eTimeBytes;
+	l_Frame[2] = eFrameTime;
+	l_Frame[3] = l_Ticks;
+	l_Frame[4] = l_Ticks >> 8;
+	l_Frame[5] = l_Ticks >> 16;
+	l_Frame[6] = l_Ticks >> 24;
+	l_Frame[7] = l_Lead;
+	l_Frame[8] = l_Lead >> 8;
+	for (uint8_t i = 1; i < eFrameBytes - 1; i++)
+	{
+		l_Sum += l_Frame[i];
+	}
+	l_Frame[eFrameBytes - 1] = -l_Sum;
+
+	m_Serial.write(l_Frame, eFrameBytes);
+	m_NextSend = a_Now + (uint32_t)m_Interval * m_Scheduler.getPeriod();
+	++m_Syncs;
+}
+
+/**
+* Run one received byte through the frame parser. Frames of other types
+* are passed over.
+*
+* @param [in] a_Byte - the byte
+* @param [in] a_Now - the micros() value it was read at
+*/
+void TickSync::parse(uint8_t a_Byte, uint32_t a_Now)
+{
+	m_Sum += a_Byte;
+
+	switch (m_Pos)
+	{
+		case 0:
+			if (eStreamSync == a_Byte)
+			{
+				m_Sum = 0;
+				++m_Pos;
+			}
+			return;
+		case 1:
+			m_Pos = (eTimeBytes == a_Byte) ? 2 : 0;
+			return;
+		case 2:
+			m_Pos = (eFrameTime == a_Byte) ? 3 : 0;
+			return;
+		case 3 + eTimeBytes:
+			m_Pos = 0;
+			if (m_Sum)
+			{
+				++m_BadFrames;
+				return;
+			}
+			follow(m_Frame[0] | ((uint32_t)m_Frame[1] << 8) | ((uint32_t)m_Frame[2] << 16) | ((uint32_t)m_Frame[3] << 24),
+				m_Frame[4] | (m_Frame[5] << 8), a_Now);
+			return;
+		default:
+			m_Frame[m_Pos++ - 3] = a_Byte;
+			return;
+	}
+}
+
+/**
+* Pull the schedule towards the master's
+*
+* @param [in] a_Ticks - ticks the master had fired when it sent the frame
+* @param [in] a_Lead - us the master had until its next tick
+* @param [in] a_Now - the micros() value the frame came in at
+*/
+void TickSync::follow(uint32_t a_Ticks, uint16_t a_Lead, uint32_t a_Now)
+{
+	int32_t l_Period = m_Scheduler.getPeriod();
+	int32_t l_Lead = (int32_t)a_Lead - m_Delay;
+	uint32_t l_Ticks = m_Scheduler.getTicks();
+	int32_t l_OwnLead = m_Scheduler.getDeadline() - a_Now;
+	int32_t l_Behind;
+
+	// both schedules as the tick in progress now
+	pending(a_Ticks, l_Lead);
+	pending(l_Ticks, l_OwnLead);
+	l_Behind = a_Ticks - l_Ticks;
+
+	++m_Syncs;
+	if (l_Behind > eMaxSlip || l_Behind < -eMaxSlip)
+	{
+		// too far out to pull in, start again on the master's tick
+		m_Scheduler.align(a_Ticks, a_Now + l_Lead);
+		if (m_Runner)
+		{
+			m_Runner->seekTo(a_Ticks);
+		}
+		m_Error = 0;
+		m_LastTicks = a_Ticks;
+		m_Tracking = true;
+		++m_Jumps;
+		return;
+	}
+
+	// how much later our deadline for a tick is than the master's for the same one
+	m_Error = l_OwnLead - l_Lead + l_Behind * l_Period;
+
+	if (m_Tracking && l_Ticks != m_LastTicks)
+	{
+		// shorten the period if we have been falling behind
+		m_Trim -= m_Error * 256 / (4 * (int32_t)(l_Ticks - m_LastTicks));
+		if (m_Trim > 32767)
+			m_Trim = 32767;
+		else if (m_Trim < -32767)
+			m_Trim = -32767;
+		m_Scheduler.setTrim(m_Trim);
+	}
+	m_Scheduler.shift(-m_Error / 2);
+	m_LastTicks = l_Ticks;
+	m_Tracking = true;
+}
@@ -0,0 +1,145 @@
+/**
+* @file TickSync
+* @brief defines the TickSync class that keeps boxes ticking together over a serial link
+*
+*/
+#ifndef __TICKSYNC_H__
+#define __TICKSYNC_H__
+
+#include "TickScheduler.h"
+#include "LedRunner.h"
+
+/**
+* The TickSync class lines up the TickScheduler of a follower box with
+* the one of a master box, so boxes next to each other stay in step over
+* a long show instead of drifting apart with their clocks.
+*
+* The master's TX line goes to the RX line of every follower. About once
+* a second the master sends where its schedule is, in the LEDStream
+* framing:
+*
+*	SYNC LEN TYPE ticks[4] lead[2] CHECK
+*
+* with TYPE eFrameTime, the number of ticks the master has run and the
+* microseconds until its next one, both LSB first. The master only sends
+* when its transmit buffer is empty, so the frame takes a known time to
+* arrive, and a follower knows where the master's schedule is the moment
+* the last byte comes in.
+*
+* A follower more than a couple of ticks out jumps straight to the
+* master's tick, seeking its state machines there (see
+* LedStateMachine::seekTo()). Otherwise it moves its next deadline half
+* way to the master's and trims its period by a quarter of the drift it
+* has seen since the last frame, which settles in a few frames and then
+* tracks the clock difference between the boxes. What is left is about
+* one pass of the follower's loop(), the frame is only seen when
+* service() reads it.
+*
+*	TickSync g_Sync(Serial, g_Ticker, TickSync::eFollower, 115200, &g_Runner);
+*
+*	void setup()
+*	{
+*		Serial.begin(115200);
+*		g_Sync.begin();
+*	}
+*
+*	void loop()
+*	{
+*		g_Runner.service();
+*		g_Sync.service();
+*	}
+*
+* @note - neither box can sleep between deadlines: a sleeping LedRunner
+*  only comes back to loop() at its next deadline, which in a long hold
+*  is minutes away. A follower has to read Serial within a few ms of
+*  each frame, and the master has to send one about once a second.
+*/
+class TickSync
+{
+public:
+	enum Role
+	{
+		eMaster,
+		eFollower
+	};
+
+	enum
+	{
+		eStreamSync = 0xa5,			// same as LEDStream
+		eFrameTime = 0x02,
+		eTimeBytes = 6,
+		eFrameBytes = eTimeBytes + 4,
+		eDefaultInterval = 100,		// ticks between frames
+		eMaxSlip = 2				// ticks a follower can be out before it jumps
+	};
+
+	TickSync(Stream& a_Serial, TickScheduler& a_Scheduler, Role a_Role, uint32_t a_Baud, LedRunner* a_Runner = NULL);
+
+	void begin(uint16_t a_Interval = eDefaultInterval);
+	void service(uint32_t a_Now);
+
+	/**
+	* Send or take in a time frame
+	*/
+	void service(void) { service(micros()); }
+
+	/**
+	* Getter for the m_Syncs
+	*
+	* @return - number of time frames sent or followed
+	*/
+	uint32_t getSyncs(void) const { return m_Syncs; }
+
+	/**
+	* Getter for the m_Jumps
+	*
+	* @return - number of times the follower was too far out and jumped
+	*/
+	uint16_t getJumps(void) const { return m_Jumps; }
+
+	/**
+	* Getter for the m_BadFrames
+	*
+	* @return - number of time frames with a bad checksum
+	*/
+	uint16_t getBadFrames(void) const { return m_BadFrames; }
+
+	/**
+	* Getter for the m_Error
+	*
+	* @return - microseconds the follower's next deadline was behind the master's at the last frame
+	*/
+	int32_t getError(void) const { return m_Error; }
+
+protected:
+	void send(uint32_t a_Now);
+	void parse(uint8_t a_Byte, uint32_t a_Now);
+	void follow(uint32_t a_Ticks, uint16_t a_Lead, uint32_t a_Now);
+	void pending(uint32_t& a_Ticks, int32_t& a_Lead);
+
+	Stream& m_Serial;
+	TickScheduler& m_Scheduler;
+	LedRunner* m_Runner;			// NULL if there are no state machines to seek
+	Role m_Role;
+	uint16_t m_Delay;				// us from a frame going out to its last byte coming in
+
+	// master
+	uint16_t m_Interval;
+	uint32_t m_NextSend;			// micros() the next frame goes out at
+	int m_TxEmpty;					// availableForWrite() with nothing to send
+
+	// follower
+	uint8_t m_Frame[eTimeBytes];
+	uint8_t m_Pos;					// bytes of the frame seen, 0 while looking for SYNC
+	uint8_t m_Sum;
+	int32_t m_Trim;					// period trim, 1/256 us
+	uint32_t m_LastTicks;			// where the last frame was followed
+	bool m_Tracking;				// m_LastTicks is good for a rate
+
+	uint32_t m_Syncs;
+	uint16_t m_Jumps;
+	uint16_t m_BadFrames;
+	int32_t m_Error;
+};
+
+#endif
@@ -10,27 +10,28 @@
 extern DigitalOut g_DisplayPower;
 
 /**
-* Create the LedStateMachine object, and reset the m_MessageQueue
+* Create the LedStateMachine object, and reset the m_Queue
 *
-* @param [in] a_SpiLeds - a TLC59711 shared between this object and others
-* @param [in] a_MessageQueue - a PacketQueue shared between this object and others
+* @param [in] a_SpiLeds - a TLC59711Async shared between this object and others
+* @param [in] a_MessageLanes - the PacketLanes shared between this object and the producers
 */
-LedStateMachine::LedStateMachine(TLC59711& a_SpiLeds, PacketQueue& a_MessageQueue) : m_SpiLeds(a_SpiLeds), m_MessageQueue(a_MessageQueue), m_CurrentGroupId(0xff), m_DismissGroup(false)
+LedStateMachine::LedStateMachine(TLC59711Async& a_SpiLeds, PacketLanes& a_MessageLanes) : Core(a_SpiLeds, a_MessageLanes), m_CurrentGroupId(0xff), m_DismissGroup(false)
 {
 	// Note - RgbLeds are clear by their constructor
 	reset();
 }
 
 /**
-* Reset all member variables, including resetting the m_MessageQueue and shutting off the LEDs
+* Reset all member variables, including resetting the m_Queue and shutting off the LEDs
 */
 void LedStateMachine::reset(void)
 {
 	m_State = eStateIdle;
 	m_Preemptable = false;
 	m_CurrentGroupId = 0xff;
+	m_SuspendedLanes = 0;
 
-	m_MessageQueue.reset();
+	m_Queue.reset();
 	turnOffLeds();
 }
 
@@ -39,31 +40,134 @@ void LedStateMachine::reset(void)
 */
 void LedStateMachine::turnOffLeds(void)
 {
-	m_SpiLeds.clear();
-	m_SpiLeds.write();
+	m_Output.clear();
+	m_Output.write();
 }
 
 /**
-* Get the next message from the queue
+* Take the next group off the queue, and turn the display driver on for it
 *
-* @return - a pointer to a Packet object, or NULL if repititions are exhausted
+* @return - false if there is no group to play
 */
-Packet* LedStateMachine::nextMessage(void)
+bool LedStateMachine::startGroup(void)
 {
-	if (++m_CurrentIndex == m_NumInGroup)
+	Packet *l_Msg;
+
+	m_NumInGroup = 0;
+	while (m_Queue.get(&l_Msg))
 	{
-		// Are we done
-		if (0 == --m_Repetitions)
+		if (0 == m_NumInGroup++)
 		{
-			m_MessageQueue.consumerRelease();
-			return NULL;
+			m_CurrentMsg = l_Msg;
+			m_Preemptable = m_CurrentMsg->getFlags() &  HeadsUpMessageProtocol::ePreemptable;
+			m_CurrentGroupId = m_CurrentMsg->getGroupId();
+			m_Repetitions = m_CurrentMsg->getRepetitions();
 		}
-		else
+		// last message - then leave
+		if (l_Msg->getFlags() & HeadsUpMessageProtocol::eLastInGroupMask)
 		{
-			m_CurrentIndex = 0;
+			break;
 		}
 	}
-	return m_MessageQueue.retrieveNextMessage(m_CurrentMsg);
+
+	// the driver stays on from one group to a preempting one
+	g_DisplayPower = (m_NumInGroup != 0);
+	return (m_NumInGroup != 0);
+}
+
+/**
+* Take the times and levels of the step about to play
+*/
+void LedStateMachine::beginStep(void)
+{
+	m_EasingTime = m_CurrentMsg->getEasing();
+	m_Duration = m_CurrentMsg->getDuration();
+	copyLevels(m_EndLeds, (const RgbLed*)m_CurrentMsg->getLeds());
+}
+
+/**
+* Start the frame's easing and work out its first tick
+*/
+void LedStateMachine::beginEasing(void)
+{
+	m_Easing.init(m_CurrentLeds, m_EndLeds, m_EasingTime);
+	m_Easing.calc(m_CurrentLeds);
+}
+
+/**
+* One more tick of the frame's easing
+*/
+void LedStateMachine::ease(void)
+{
+	m_Easing.calc(m_CurrentLeds);
+}
+
+/**
+* Get the next message from the queue
+*
+* @return - false if repititions are exhausted, and the group is released
+*/
+bool LedStateMachine::nextStep(void)
+{
+	if (!nextInGroup())
+	{
+		m_Queue.consumerRelease();
+		return false;
+	}
+	return NULL != (m_CurrentMsg = m_Queue.retrieveNextMessage(m_CurrentMsg));
+}
+
+/**
+* Put the group playing aside and start the one waiting in a_Lane, in
+* time for it to show this tick
+*
+* @param [in] a_Lane - a lane above the one playing, with a group to start
+*/
+void LedStateMachine::preempt(uint8_t a_Lane)
+{
+	uint8_t l_Lane = m_Queue.getLane();
+	Suspended& l_Suspended = m_Suspended[l_Lane];
+
+	savePosition(l_Suspended.m_Position);
+	l_Suspended.m_CurrentMsg = m_CurrentMsg;
+	l_Suspended.m_CurrentGroupId = m_CurrentGroupId;
+	l_Suspended.m_Preemptable = m_Preemptable;
+	l_Suspended.m_Easing = m_Easing;
+	m_SuspendedLanes |= 1 << l_Lane;
+
+	m_Queue.select(a_Lane);
+	if (startGroup())
+	{
+		// the display driver is already on, so no delay
+		m_CurrentIndex = 0;
+		m_State = eStateMessageBegin;
+	}
+	else
+	{
+		resume(l_Lane);
+	}
+}
+
+/**
+* Pick up the group a_Lane put aside where it stopped
+*
+* @param [in] a_Lane - a lane with a group in m_Suspended
+*/
+void LedStateMachine::resume(uint8_t a_Lane)
+{
+	Suspended& l_Suspended = m_Suspended[a_Lane];
+
+	m_Queue.select(a_Lane);
+	restorePosition(l_Suspended.m_Position);
+	m_CurrentMsg = l_Suspended.m_CurrentMsg;
+	m_CurrentGroupId = l_Suspended.m_CurrentGroupId;
+	m_Preemptable = l_Suspended.m_Preemptable;
+	m_Easing = l_Suspended.m_Easing;
+	m_SuspendedLanes &= ~(1 << a_Lane);
+
+	// put its levels back up, the group that preempted it left its own
+	g_DisplayPower = 1;
+	showStep();
 }
 
 /**
@@ -73,7 +177,8 @@ Packet* LedStateMachine::nextMessage(void)
 */
 bool LedStateMachine::updateState(void)
 {
-	Packet *l_Msg;
+	int l_Ready;
+	int l_Suspended;
 
 	// check to see if the group need to be dismissed
 	// This is usually done with the side button
@@ -82,142 +187,43 @@ bool LedStateMachine::updateState(void)
 		// only dismiss if the SM is active
 		if (m_State != eStateIdle)
 		{
-			m_MessageQueue.consumerRelease();		// release 
+			m_Queue.consumerRelease();		// release 
 			m_State = eStateIdle;
-			m_CurrentGroupId = 0xff;
-			m_Preemptable = false;
+			endGroup();
 			turnOffLeds();
 		}
 
 		m_DismissGroup = false;
 	}
-	switch (m_State)
-	{
-		case eStateIdle:
-			m_NumInGroup = 0;
-			g_DisplayPower = 0;
-			while (m_MessageQueue.get(&l_Msg))
-			{
-				if (0 == m_NumInGroup++)
-				{
-					// turn the LED display driver power on and then delay
-					// for 10 ms
-					m_State = eStateDelay;
-					g_DisplayPower = 1;
-					m_CountDown = 1;
-
-					m_CurrentIndex = 0;
-					m_CurrentMsg = l_Msg;
-					m_Preemptable = m_CurrentMsg->getFlags() &  HeadsUpMessageProtocol::ePreemptable;
-					m_CurrentGroupId = m_CurrentMsg->getGroupId();
-					m_Repetitions = m_CurrentMsg->getRepetitions();
-				}
-				// last message - then leave
-				if (l_Msg->getFlags() & HeadsUpMessageProtocol::eLastInGroupMask)
-				{
-					break;
-				}
-			}
-			// return true if there are LED messages to process
-			// return false if we are idle and there are no LED messages
-			//
-			return (m_NumInGroup != 0);
-		case eStateDelay:
-			if (0 == --m_CountDown)
-			{
-				m_State = eStateMessageBegin;
-			}
-			break;
-		case eStateMessageBegin:
-			m_EasingTime = m_CurrentMsg->getEasing();
-			m_Duration = m_CurrentMsg->getDuration();
-			if (m_EasingTime)
-			{
-
-				m_State = eStateEasing;
-				m_CountDown = m_EasingTime;
-				memcpy(m_EndLeds, m_CurrentMsg->getLeds(), sizeof(m_CurrentLeds));
-				for (int i=0; i<RgbLed::m_NumberOfLeds; i++)
-				{
-					m_Easing[i].init(m_CurrentLeds[i], m_EndLeds[i], m_EasingTime);
-				}
-				for (int i=0; i<RgbLed::m_NumberOfLeds; i++)
-				{
-					m_Easing[i].calc(m_CurrentLeds[i]);
-				}
-			}
-			else
-			{
-				m_State = eStateSteady;
-				m_CountDown = m_Duration;
-				memcpy(m_CurrentLeds, m_CurrentMsg->getLeds(), sizeof(m_CurrentLeds));
-			}
-			m_SpiLeds.setLeds(&m_CurrentLeds);
-			m_SpiLeds.write();
 
-			break;
-		case eStateEasing:
-			// are we done with Easing
-			if (0 == --m_CountDown)
-			{
-				// reconcile that easing may have not ended precicely on the correct value
-				// so just copy in the correct values 
-				memcpy(m_CurrentLeds, m_CurrentMsg->getLeds(), sizeof(m_CurrentLeds));
-				m_CountDown = m_Duration;
-				if (m_CountDown)
-				{
-					m_State = eStateSteady;
-					m_CountDown = m_Duration;
-				}
-				else
-				{
-					if (NULL != (m_CurrentMsg = nextMessage()))
-					{
-						m_State = eStateMessageBegin;
-					}
-					else
-					{
-						m_State = eStateIdle;
-						m_Preemptable = false;
-						m_CurrentGroupId = 0xff;
-					}
-				}
-			}
-			else
-			{
-				// Ease on down the road
-				for (int i=0; i < RgbLed::m_NumberOfLeds; i++)
-				{
-					m_Easing[i].calc(m_CurrentLeds[i]);
-				}
-			}
-			// write the new values
-			m_SpiLeds.setLeds(&m_CurrentLeds);
-			m_SpiLeds.write();
-			break;
-		case eStateSteady:
-			if (0 == --m_CountDown)
+	// a higher lane takes over from a preemptable group, and once it is
+	// done the highest group put aside goes on before any new group
+	// from its lane or below
+	l_Ready = m_Queue.getReadyLane();
+	if (m_State != eStateIdle)
+	{
+		if (l_Ready > m_Queue.getLane() && m_Preemptable)
+		{
+			preempt(l_Ready);
+		}
+	}
+	else
+	{
+		for (l_Suspended = PacketLanes::eMaxLanes - 1; l_Suspended >= 0; l_Suspended--)
+		{
+			if (m_SuspendedLanes & (1 << l_Suspended))
 			{
-				// STEADY State is done so go to next MSG
-				if (NULL != (m_CurrentMsg = nextMessage()))
-				{
-					m_State = eStateMessageBegin;
-				}
-				else
-				{
-					m_State = eStateIdle;
-					m_Preemptable = false;
-					m_CurrentGroupId = 0xff;
-#if 0
-					void (*__restart_vector)(void) = (void(*)())0xc0;
-					__restart_vector();
-#endif
-				}
+				break;
 			}
-			break;
-		default:
-			break;
+		}
+		if (l_Suspended >= 0 && l_Suspended >= l_Ready)
+		{
+			resume(l_Suspended);
+		}
+		else if (l_Ready >= 0)
+		{
+			m_Queue.select(l_Ready);
+		}
 	}
-	return true;
+	return Core::updateState();
 }
-
@@ -9,16 +9,35 @@
 
 #include "mbed.h"
 #include "hump.h"
-#include "packet_queue.h"
+#include "packet_lanes.h"
 #include "rgb_led.h"
-#include "TLC59711.h"
+#include "tlc59711_async.h"
+#include "LEDStateMachine/LedCore.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /**
 * The Easing class will control the rate and brightness of the LEDs
+*
+* It eases a whole frame, every color of every LED, in one pass over
+* flat arrays of 17.15 fixed point lanes instead of an object per LED,
+* and gives the same values bit for bit as easing each color on its own.
+*
+* With SSE2 (host builds) four lanes go in each add and come out as
+* bytes with two packs. On a Cortex-M each lane is one 32 bit add: its
+* 16 bit SIMD adds are too narrow for a 17.15 value, and the fades would
+* change.
 */
 class Easing
 {
 public:
+	enum
+	{
+		eLanes = RgbLed::m_NumberOfLeds * 3,
+		ePadded = (eLanes + 3) & ~3		// whole SSE2 registers
+	};
+
 	/**
 	* Create the Easing object
 	*/
@@ -27,88 +46,104 @@ public:
 	/**
 	* The clear function will set the increment member variables to 0
 	*/
-	void clear(void) { m_RedInc = m_GreenInc = m_BlueInc = 0; }
+	void clear(void) { memset(m_Inc, 0, sizeof(m_Inc)); memset(m_Accum, 0, sizeof(m_Accum)); }
 
 	/**
-	* The init function initializes the accumulator, increment and times member variables
+	* The init function initializes the accumulator and increment member variables
 	*
-	* @param [in] a_StartLed - a RgbLed used to determine initial values for accumulator member variables
-	* @param [in] a_EndLed - a RgbLed used to determine final values for increment member variables
-	* @param [in] m_EasingTime - the total time the easing shall take to get from a_StartLed to a_EndLed
+	* @param [in] a_StartLeds - the frame the easing starts from
+	* @param [in] a_EndLeds - the frame the easing ends on
+	* @param [in] a_EasingTime - the total time the easing shall take to get from a_StartLeds to a_EndLeds
 	*/
-	void init(RgbLed& a_StartLed, RgbLed& a_EndLed, uint16_t m_EasingTime)
+	void init(RgbLed* a_StartLeds, RgbLed* a_EndLeds, uint16_t a_EasingTime)
 	{
-		m_Times = 0;
-
-		m_RedAccum = ((int32_t)a_StartLed.getRed()) << 15;
-		m_GreenAccum = ((int32_t)a_StartLed.getGreen()) << 15;
-		m_BlueAccum = ((int32_t)a_StartLed.getBlue()) << 15;
-
-		m_RedInc = ((((int32_t)a_EndLed.getRed()) << 15) - m_RedAccum) / m_EasingTime;
-		m_GreenInc = ((((int32_t)a_EndLed.getGreen()) << 15) - m_GreenAccum) / m_EasingTime;
-		m_BlueInc = ((((int32_t)a_EndLed.getBlue()) << 15) - m_BlueAccum) / m_EasingTime;
+		for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+		{
+			lane(i * 3, a_StartLeds[i].getRed(), a_EndLeds[i].getRed(), a_EasingTime);
+			lane(i * 3 + 1, a_StartLeds[i].getGreen(), a_EndLeds[i].getGreen(), a_EasingTime);
+			lane(i * 3 + 2, a_StartLeds[i].getBlue(), a_EndLeds[i].getBlue(), a_EasingTime);
+		}
 	}
 
 	/**
-	* The calcFirst function is intended to smooth out the easing in a situation when the easing time 
-	* does not fit into nicely even slices.	This will apply a fix to the first easing calculation.
+	* The calc will move every lane on by its increment and put the frame in a_Leds
 	*
-	* @param [out] a_Led - a RgbLed that will be updated based on the internal increment member variables
+	* @param [out] a_Leds - the frame, updated from the accumulators
 	*/
-	void calcFirst(RgbLed& a_Led)
+	void calc(RgbLed* a_Leds)
 	{
-		// Put the ticks in the right place, say easing is 2, so the ticks
-		// are 1/4 and 3/4 so the first time we add half the easing value
-		++m_Times;
-		a_Led.setRed(((((int32_t) a_Led.getRed()) << 15) + m_RedInc/2) >> 15);
-		a_Led.setGreen(((((int32_t) a_Led.getGreen()) << 15) + m_GreenInc/2) >> 15);
-		a_Led.setBlue(((((int32_t) a_Led.getBlue()) << 15) + m_BlueInc/2) >> 15);
+#ifdef __SSE2__
+		uint8_t l_Values[ePadded];
+
+		for (int l = 0; l < ePadded; l += 4)
+		{
+			__m128i l_Accum = _mm_add_epi32(_mm_loadu_si128((const __m128i*)&m_Accum[l]), _mm_loadu_si128((const __m128i*)&m_Inc[l]));
+			__m128i l_Value = _mm_srli_epi32(l_Accum, 15);
+			int32_t l_Bytes;
+
+			_mm_storeu_si128((__m128i*)&m_Accum[l], l_Accum);
+			l_Value = _mm_packs_epi32(l_Value, l_Value);
+			l_Bytes = _mm_cvtsi128_si32(_mm_packus_epi16(l_Value, l_Value));
+			memcpy(&l_Values[l], &l_Bytes, 4);
+		}
+
+		for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+		{
+			a_Leds[i].setRed(l_Values[i * 3]);
+			a_Leds[i].setGreen(l_Values[i * 3 + 1]);
+			a_Leds[i].setBlue(l_Values[i * 3 + 2]);
+		}
+#else
+		for (int i = 0; i < RgbLed::m_NumberOfLeds; i++)
+		{
+			m_Accum[i * 3] += m_Inc[i * 3];
+			m_Accum[i * 3 + 1] += m_Inc[i * 3 + 1];
+			m_Accum[i * 3 + 2] += m_Inc[i * 3 + 2];
+			a_Leds[i].setRed(m_Accum[i * 3] >> 15);
+			a_Leds[i].setGreen(m_Accum[i * 3 + 1] >> 15);
+			a_Leds[i].setBlue(m_Accum[i * 3 + 2] >> 15);
+		}
+#endif
 	}
 
+protected:
 	/**
-	* The calc will update the internal increment and accumulator member variables
-	*
-	* @param [out] a_Led - a RgbLed that will be updated based on the internal increment and accumulator member variables
+	* Work out one lane's start and increment
 	*/
-	void calc(RgbLed& a_Led)
+	void lane(int a_Lane, uint8_t a_Start, uint8_t a_End, uint16_t a_EasingTime)
 	{
-		++m_Times;
-
-		m_RedAccum += m_RedInc;
-		m_GreenAccum += m_GreenInc;
-		m_BlueAccum += m_BlueInc;
-
-		a_Led.setRed(m_RedAccum >> 15);
-		a_Led.setGreen(m_GreenAccum >> 15);
-		a_Led.setBlue(m_BlueAccum >> 15);
+		m_Accum[a_Lane] = ((int32_t)a_Start) << 15;
+		m_Inc[a_Lane] = ((((int32_t)a_End) << 15) - m_Accum[a_Lane]) / a_EasingTime;
 	}
 
-protected:
-	int m_Times;
-	int32_t m_RedInc;
-	int32_t m_GreenInc;
-	int32_t m_BlueInc;
-	int32_t m_RedAccum;
-	int32_t m_GreenAccum;
-	int32_t m_BlueAccum;
+	int32_t m_Accum[ePadded];		// LED * 3 + color, the padding stays 0
+	int32_t m_Inc[ePadded];
 };
 
 /**
 * The LedStateMachine class will manage the LEDs
+*
+* The run through the states is LedCore's, the same one the Arduino
+* library's LedStateMachine uses. m_Output is the TLC59711Async and m_Queue
+* the PacketLanes; each step's levels are the RgbLed arrays of LedCore,
+* copied with loops unrolled for RgbLed::m_NumberOfLeds and eased a
+* frame at a time.
+*
+* A group in a higher lane preempts a preemptable group playing from a
+* lower one, and shows on the tick it is seen. The group it took over
+* from is put aside, its position, easing and step in m_Suspended for
+* its lane, and picks up where it stopped once no higher group is left
+* to play. A lane with a group put aside starts no other until that one
+* is done, its queue keeps the packets until then, so each lane needs
+* one slot.
 */
-class LedStateMachine
+class LedStateMachine : public LedCore<LedStateMachine, RgbLed, RgbLed::m_NumberOfLeds, PacketLanes, TLC59711Async>
 {
-public:
-	enum LedStateMachineStates
-	{
-		eStateIdle,
-		eStateDelay,
-		eStateMessageBegin,
-		eStateEasing,
-		eStateSteady
-	};
+	typedef LedCore<LedStateMachine, RgbLed, RgbLed::m_NumberOfLeds, PacketLanes, TLC59711Async> Core;
+	friend Core;
 
-	LedStateMachine(TLC59711& a_SpiLeds, PacketQueue& a_MsgQueue);
+public:
+	LedStateMachine(TLC59711Async& a_SpiLeds, PacketLanes& a_MsgLanes);
 	void reset(void);
 	void turnOffLeds(void);
 	bool updateState(void);
@@ -126,31 +161,58 @@ public:
 
 	bool isActiveGroupPreemptable(void)	{ return m_Preemptable;		}
 
+	/**
+	* Getter for the m_SuspendedLanes
+	*
+	* @return - a bit for each lane with a group put aside
+	*/
+	uint8_t getSuspendedLanes(void)		{ return m_SuspendedLanes;	}
+
 protected:
-	Packet* nextMessage(void);
+	// LedCore's hooks
+	bool startGroup(void);
+	void beginStep(void);
+	void beginEasing(void);
+	void ease(void);
+	bool nextStep(void);
 
-	TLC59711& m_SpiLeds;
+	void preempt(uint8_t a_Lane);
+	void resume(uint8_t a_Lane);
 
-	PacketQueue& m_MessageQueue;
+	/**
+	* Put the levels out on the TLC59711s, at the start of each step and
+	* every tick of an easing. write() only starts the transfer, and skips
+	* frames the chips already show.
+	*/
+	void showStep(void)		{ m_Output.setLeds(&m_CurrentLeds); m_Output.write(); }
+	void showEasing(void)	{ showStep(); }
 
-	LedStateMachineStates m_State;
-	uint16_t m_CountDown;
-	uint16_t m_Duration;
-	uint16_t m_EasingTime;
-	uint16_t m_Repetitions;
-	uint8_t m_NumInGroup;
-	uint8_t m_CurrentIndex;
+	/**
+	* The group is done, nothing is active
+	*/
+	void endGroup(void)		{ m_Preemptable = false; m_CurrentGroupId = 0xff; }
 
 	Packet* m_CurrentMsg;
-	Packet* m_CurrentCmd;
 	uint8_t m_CurrentGroupId;
 	bool m_DismissGroup;
 	bool m_Preemptable;			// indicates if the active message is preemptable
 
-	RgbLed m_EndLeds[RgbLed::m_NumberOfLeds];
-	RgbLed m_CurrentLeds[RgbLed::m_NumberOfLeds];
+	Easing m_Easing;
+
+	/**
+	* A group put aside by a higher one
+	*/
+	struct Suspended
+	{
+		Core::Position m_Position;
+		Packet* m_CurrentMsg;
+		uint8_t m_CurrentGroupId;
+		bool m_Preemptable;
+		Easing m_Easing;
+	};
 
-	Easing m_Easing[RgbLed::m_NumberOfLeds];
+	Suspended m_Suspended[PacketLanes::eMaxLanes];	// by lane
+	uint8_t m_SuspendedLanes;						// a bit for each lane in m_Suspended
 };
 
 #endif
@@ -0,0 +1,61 @@
+/**
+* @file packet_lanes.cpp
+* @brief implements the PacketLanes object
+*
+* Copyright (c) 2016 Heads Up Display, Inc
+*/
+#include "defines.h"
+#include "packet_lanes.h"
+
+/**
+* Create a PacketLanes object over an array of PacketQueues
+*
+* @param a_Lanes - the queues, lowest priority first
+* @param a_Count - number of queues, up to eMaxLanes
+*/
+PacketLanes::PacketLanes(PacketQueue** a_Lanes, uint8_t a_Count)
+{
+	if (a_Count > eMaxLanes)
+	{
+		a_Count = eMaxLanes;
+	}
+	for (uint8_t i = 0; i < a_Count; i++)
+	{
+		m_Lanes[i] = a_Lanes[i];
+	}
+	m_Count = a_Count;
+	m_Lane = 0;
+}
+
+/**
+* Reset every lane, and play from the lowest
+*
+* @note - neither the producers nor the consumer may be using the queues
+*/
+void PacketLanes::reset(void)
+{
+	for (uint8_t i = 0; i < m_Count; i++)
+	{
+		m_Lanes[i]->reset();
+	}
+	m_Lane = 0;
+}
+
+/**
+* Find the highest lane with a group to start
+*
+* @note - consumer side only
+*
+* @return - the lane, or -1 if no lane has one
+*/
+int PacketLanes::getReadyLane(void)
+{
+	for (int i = m_Count - 1; i >= 0; i--)
+	{
+		if (m_Lanes[i]->canGet())
+		{
+			return i;
+		}
+	}
+	return -1;
+}
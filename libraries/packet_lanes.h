@@ -0,0 +1,75 @@
+/**
+* @file packet_lanes.h
+* @brief defines the PacketLanes class
+*
+* Copyright (c) 2016 Heads Up Display, Inc
+*/
+#ifndef __PACKET_LANES__
+#define __PACKET_LANES__
+
+#include "mbed.h"
+#include "packet_queue.h"
+
+/**
+* The PacketLanes class puts PacketQueues of different priorities in
+* front of the LedStateMachine
+*
+* Each lane is a PacketQueue of its own, with its own producer, lane 0
+* the lowest priority. The state machine plays from the selected lane
+* through the same get(), retrieveNextMessage() and consumerRelease()
+* a single PacketQueue has, and asks getReadyLane() each tick whether a
+* higher lane has a group waiting to take over.
+*/
+class PacketLanes
+{
+public:
+	enum { eMaxLanes = 4 };
+
+	PacketLanes(PacketQueue** a_Lanes, uint8_t a_Count);
+
+	void reset(void);
+	int getReadyLane(void);
+
+	/**
+	* Play from a_Lane from now on
+	*
+	* @param [in] a_Lane - the lane, 0 to getNumberOfLanes() - 1
+	*/
+	void select(uint8_t a_Lane)						{ m_Lane = a_Lane;						}
+
+	/**
+	* Getter for the m_Lane
+	*
+	* @return - the lane being played from
+	*/
+	uint8_t getLane(void)							{ return m_Lane;						}
+
+	/**
+	* Getter for the m_Count
+	*
+	* @return - the number of lanes
+	*/
+	uint8_t getNumberOfLanes(void)					{ return m_Count;						}
+
+	/**
+	* The selected lane's get(), see PacketQueue
+	*/
+	bool get(Packet** a_Item)						{ return m_Lanes[m_Lane]->get(a_Item);	}
+
+	/**
+	* The selected lane's retrieveNextMessage(), see PacketQueue
+	*/
+	Packet* retrieveNextMessage(Packet* a_Item)		{ return m_Lanes[m_Lane]->retrieveNextMessage(a_Item); }
+
+	/**
+	* The selected lane's consumerRelease(), see PacketQueue
+	*/
+	void consumerRelease(void)						{ m_Lanes[m_Lane]->consumerRelease();	}
+
+protected:
+	PacketQueue* m_Lanes[eMaxLanes];	// lowest priority first
+	uint8_t m_Count;
+	uint8_t m_Lane;						// the lane being played from
+};
+
+#endif
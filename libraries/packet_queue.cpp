@@ -1,6 +1,6 @@
 /**
 * @file packet_queue.cpp
-* @brief implements the Easing and LedStateMachine objects
+* @brief implements the PacketQueue object
 *
 * Copyright (c) 2016 Heads Up Display, Inc
 */
@@ -36,6 +36,212 @@ PacketQueue::~PacketQueue()
 {
 }
 
+#ifdef PACKET_QUEUE_SPSC
+/**
+* Reset the queue
+*
+* @note - neither the producer nor the consumer may be using the queue
+*/
+void PacketQueue::reset(void)
+{
+	m_ProdWrIndex = m_Head;
+	m_ProdRdIndex = m_Head;
+	m_ConRdIndex = m_Head;
+	m_Written = 0;
+	m_Committed = 0;
+	m_Read = 0;
+	m_Released = 0;
+}
+
+/**
+* Add item to queue
+*
+* @param a_Item - item to add
+* @return true if item added, false if queue full
+*/
+bool PacketQueue::put(Packet* a_Item)
+{
+	return putIrq(a_Item);
+}
+
+/**
+* Add item to queue, from a thread or an IRQ handler
+*
+* @note - producer side only
+*
+* @param a_Item - item to add
+* @return true if item added, false if queue full
+*/
+bool PacketQueue::putIrq(Packet* a_Item)
+{
+	Packet* l_Slot = reserveIrq();
+
+	if (NULL == l_Slot)
+	{
+		return false;
+	}
+	*l_Slot = *a_Item;
+	return true;
+}
+
+/**
+* Claim the next slot so a packet can be built in place
+*
+* @return the slot, or NULL if queue full
+*/
+Packet* PacketQueue::reserve(void)
+{
+	return reserveIrq();
+}
+
+/**
+* Claim the next slot so a packet can be built in place, from a thread or
+* an IRQ handler. The slot counts as put, the consumer sees it at the
+* next producerCommit().
+*
+* @note - producer side only
+*
+* @return the slot, or NULL if queue full
+*/
+Packet* PacketQueue::reserveIrq(void)
+{
+	Packet* l_Slot = m_ProdWrIndex;
+
+	// slots only come back once the consumer releases a whole group
+	if (m_Written - m_Released >= (uint32_t)m_Count)
+	{
+		return NULL;
+	}
+
+	// adjust the pointer/check for overflow
+	if (++m_ProdWrIndex >= m_Tail)
+	{
+		m_ProdWrIndex = m_Head;
+	}
+	m_Written++;
+
+	return l_Slot;
+}
+
+/**
+* Give back the last slot claimed by reserve(), say when the packet
+* being built turned out to be bad. Slots already committed stay put.
+*/
+void PacketQueue::unreserve(void)
+{
+	unreserveIrq();
+}
+
+/**
+* Give back the last slot claimed by reserveIrq(), from a thread or an
+* IRQ handler. Slots already committed stay put.
+*
+* @note - producer side only
+*/
+void PacketQueue::unreserveIrq(void)
+{
+	if (m_Written == m_Committed)
+	{
+		return;
+	}
+
+	if (m_ProdWrIndex == m_Head)
+	{
+		m_ProdWrIndex = m_Tail;
+	}
+	--m_ProdWrIndex;
+	m_Written--;
+}
+
+/**
+* Update the consumer data to indicate that an entire group
+* has been written so that it can be seen by the consumer
+*
+* @note - producer side only
+*/
+void PacketQueue::producerCommit(void)
+{
+	// the packets have to be in memory before the consumer sees the count
+	__DMB();
+	m_Committed = m_Written;
+}
+
+/**
+* Get an item from the queue
+*
+* @param a_Item - pointer to the item to get
+* @return true if item fetched, false if queue is empty
+*/
+bool PacketQueue::get(Packet** a_Item)
+{
+	return getIrq(a_Item);
+}
+
+/**
+* Get an item from the queue, from a thread or an IRQ handler
+*
+* @note - consumer side only
+*
+* @param a_Item - pointer to the item to get
+* @return true if item fetched, false if queue is empty
+*/
+bool PacketQueue::getIrq(Packet** a_Item)
+{
+	if (m_Read == m_Committed)
+	{
+		return false;
+	}
+	// don't read the packet before the count that covers it
+	__DMB();
+
+	// hand out the item/adjust the pointer/check for overflow
+	*a_Item = m_ConRdIndex++;
+	if (m_ConRdIndex >= m_Tail)
+	{
+		m_ConRdIndex = m_Head;
+	}
+	m_Read++;
+
+	return true;
+}
+
+/**
+* Update the producer data to indicate that an entire group
+*  is completed so that the slots are freed to write to
+*
+* @note - consumer side only
+*/
+void PacketQueue::consumerRelease(void)
+{
+	m_ProdRdIndex = m_ConRdIndex;
+
+	// finish with the packets before the producer can overwrite them
+	__DMB();
+	m_Released = m_Read;
+}
+
+/**
+* Peek at the entry at the top of the queue
+*
+* @note - consumer side only, and only committed entries are seen
+*
+* @param [out] a_Item the item to copy the top queue item into
+* @return the entry at the top of the queue
+*/
+bool PacketQueue::peek(Packet* a_Item)
+{
+	if (m_Released == m_Committed)
+	{
+		return false;
+	}
+	__DMB();
+
+	// copy the item
+	*a_Item = *m_ProdRdIndex;
+	return true;
+}
+
+#else
 /**
 * Reset the queue
 */
@@ -77,13 +283,50 @@ bool PacketQueue::put(Packet* a_Item)
 */
 bool PacketQueue::putIrq(Packet* a_Item)
 {
-	bool a_Result = false;
+	Packet* l_Slot = reserveIrq();
+
+	if (NULL == l_Slot)
+	{
+		return false;
+	}
+
+	// copy the item
+	*l_Slot = *a_Item;
+	return true;
+}
+
+/**
+* Claim the next slot so a packet can be built in place
+*
+* @return the slot, or NULL if queue full
+*/
+Packet* PacketQueue::reserve(void)
+{
+	Packet* l_Slot;
+
+	m_Mutex.lock();
+	l_Slot = reserveIrq();
+	m_Mutex.unlock();
+
+	return l_Slot;
+}
+
+/**
+* Claim the next slot from an IRQ handler so a packet can be built in
+* place. The slot counts as put, the consumer sees it at the next
+* producerCommit().
+*
+* @return the slot, or NULL if queue full
+*/
+Packet* PacketQueue::reserveIrq(void)
+{
+	Packet* l_Slot = NULL;
 
 	// check for room
 	if (m_ProdCount < m_Count)
 	{
-		// copy the item/adjust the pointer/check for overflow
-		*m_ProdWrIndex++ =*a_Item;
+		// adjust the pointer/check for overflow
+		l_Slot = m_ProdWrIndex++;
 		if (m_ProdWrIndex >= m_Tail)
 		{
 			m_ProdWrIndex = m_Head;
@@ -92,13 +335,38 @@ bool PacketQueue::putIrq(Packet* a_Item)
 		// increment the count
 		m_ProdCount++;
 		m_NumPendingPuts++;
-
-		// set the result to 0k
-		a_Result = true;
 	}
 
-	// return the status
-	return a_Result;
+	return l_Slot;
+}
+
+/**
+* Give back the last slot claimed by reserve(), say when the packet
+* being built turned out to be bad. Slots already committed stay put.
+*/
+void PacketQueue::unreserve(void)
+{
+	m_Mutex.lock();
+	unreserveIrq();
+	m_Mutex.unlock();
+}
+
+/**
+* Give back the last slot claimed by reserveIrq(), from an IRQ handler.
+* Slots already committed stay put.
+*/
+void PacketQueue::unreserveIrq(void)
+{
+	if (m_NumPendingPuts)
+	{
+		if (m_ProdWrIndex == m_Head)
+		{
+			m_ProdWrIndex = m_Tail;
+		}
+		--m_ProdWrIndex;
+		m_ProdCount--;
+		m_NumPendingPuts--;
+	}
 }
 
 /**
@@ -164,6 +432,8 @@ bool PacketQueue::getIrq(Packet** a_Item)
 	return a_Result;
 }
 
+#endif
+
 /**
 * Just retrieve the next packet without modifying
 * queue data. Returns a pointer to the next packet
@@ -212,6 +482,7 @@ Packet* PacketQueue::retrieveNextMessage(Packet* a_Item)
 }
 
 
+#ifndef PACKET_QUEUE_SPSC
 /**
 * Update the producer data to indicate that an entire group
 *  is completed so that the slots are freed to write to
@@ -248,4 +519,4 @@ bool PacketQueue::peek(Packet* a_Item)
 	// return the status
 	return a_Result;
 }
-
+#endif
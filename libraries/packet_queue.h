@@ -7,12 +7,28 @@
 #ifndef __PACKET_QUEUE__
 #define __PACKET_QUEUE__
 
+#include "defines.h"
 #include "mbed.h"
 #include "rtos.h"
 #include "hump.h"
 
 /**
 * The PacketQueue class will manage the packets in a queue
+*
+* A producer can build packets in place instead of copying them in with
+* put(): reserve() hands out the next free slot, which the consumer sees
+* once producerCommit() is called, the same as a put().
+*
+* With PACKET_QUEUE_SPSC defined (in defines.h) the queue takes no locks.
+* It is then only safe for one producer and one consumer, each of which
+* may be a thread or an IRQ handler. Each side owns its own indices and
+* publishes a free running count to the other side: the producer publishes
+* m_Committed in producerCommit(), the consumer publishes m_Released in
+* consumerRelease(). A memory barrier before each publish makes sure the
+* packets are in place before the other side sees the count move. Groups
+* work the same way as with the Mutex: the consumer sees nothing of a
+* group until it is committed, and the producer cannot reuse any of its
+* slots until the whole group is released.
 */
 class PacketQueue
 {
@@ -23,6 +39,10 @@ public:
 	void reset(void);
 	bool put(Packet* a_Item);
 	bool putIrq(Packet* a_Item);
+	Packet* reserve(void);
+	Packet* reserveIrq(void);
+	void unreserve(void);
+	void unreserveIrq(void);
 	void producerCommit(void);
 	bool get(Packet** a_Item);
 	bool getIrq(Packet** a_Item);
@@ -35,20 +55,49 @@ public:
 	* 
 	* @return the number of items in the queue
 	*/
+#ifdef PACKET_QUEUE_SPSC
+	int getNumberOfItems(void) { return (int)(m_Written - m_Released); }
+#else
 	int getNumberOfItems(void) { return m_ProdCount; }
+#endif
 
 	/**
 	* Indicates if the queue is empty
 	*
 	*	@return bool indicating empty
 	*/
-	bool isEmpty(void) { return m_ProdCount == 0; }
+	bool isEmpty(void) { return getNumberOfItems() == 0; }
+
+	/**
+	* Indicates if get() has a committed item to hand out
+	*
+	* @note - consumer side only
+	*
+	* @return true if get() would return an item
+	*/
+#ifdef PACKET_QUEUE_SPSC
+	bool canGet(void) { return m_Read != m_Committed; }
+#else
+	bool canGet(void) { return m_ConCount != 0; }
+#endif
 
 protected:
-	Mutex m_Mutex;					// lock for the queue data structures
 	int m_Count;						// number of items in the queue
 	Packet* m_Head;					// pointer to the head of the queue
 	Packet* m_Tail;					// pointer to the tail of the queue
+#ifdef PACKET_QUEUE_SPSC
+	// producer side
+	Packet* m_ProdWrIndex;	// producer write index
+	volatile uint32_t m_Written;	// number of puts
+	volatile uint32_t m_Committed;	// number of puts the consumer can see
+
+	// consumer side
+	Packet* m_ProdRdIndex;	// first packet of the group being played
+	Packet* m_ConRdIndex;		// consumer read index
+	volatile uint32_t m_Read;		// number of gets
+	volatile uint32_t m_Released;	// number of gets the producer can reuse
+#else
+	Mutex m_Mutex;					// lock for the queue data structures
 	Packet* m_ProdRdIndex;	// producer read index
 	Packet* m_ProdWrIndex;	// producer write index
 	Packet* m_ConRdIndex;		// consumer read index
@@ -57,5 +106,6 @@ protected:
 	int m_ConCount;					// number of items in queue for consumer
 	int m_NumPendingPuts;		// Number of puts that have not yet been committed
 	int m_NumPendingGets;		// Number of gets that have not yet been released
+#endif
 };
 #endif
@@ -0,0 +1,176 @@
+/**
+* @file tlc59711_async.cpp
+* @brief implements the TLC59711Async object
+*
+* Copyright (c) 2016 Heads Up Display, Inc
+*/
+#include "defines.h"
+#include "tlc59711_async.h"
+
+/**
+* Create a TLC59711Async object, with every LED off
+*
+* @param [in] a_Spi - the SPI bus the TLC59711 chain is on, set up for it
+* @param [in] a_Brightness - the global brightness of each color, 0 to 0x7f
+*/
+TLC59711Async::TLC59711Async(SPI& a_Spi, uint8_t a_Brightness) : m_Spi(a_Spi)
+#if DEVICE_SPI_ASYNCH
+	, m_Done(this, &TLC59711Async::done)
+#endif
+{
+	// write command 0x25, OUTTMG = 1, EXTGCK = 0, TMGRST = 1, DSPRPT = 1,
+	// BLANK = 0, then the brightness of blue, green and red
+	a_Brightness &= 0x7f;
+	m_Command = ((uint32_t)0x25 << 26) | ((uint32_t)0x16 << 21) | ((uint32_t)a_Brightness << 14) | ((uint32_t)a_Brightness << 7) | a_Brightness;
+
+	m_Back = 0;
+	m_Busy = false;
+	m_Pending = false;
+	m_Shown = false;
+	m_Transfers = 0;
+	m_Skipped = 0;
+	clear();
+}
+
+/**
+* Set every LED of the back frame off
+*/
+void TLC59711Async::clear(void)
+{
+	setLeds(NULL);
+}
+
+/**
+* Encode the levels into the back frame, for the next write()
+*
+* @param [in] a_Leds - the levels of every LED, NULL for all off
+*/
+void TLC59711Async::setLeds(RgbLed (*a_Leds)[RgbLed::m_NumberOfLeds])
+{
+	// take back a frame done() has not started yet, it is about to be
+	// encoded over
+	core_util_critical_section_enter();
+	m_Pending = false;
+	core_util_critical_section_exit();
+
+	encode(a_Leds ? *a_Leds : NULL);
+	m_Dirty = true;
+}
+
+/**
+* Send the back frame, unless the chips already show it
+*
+* @note - this does not wait for the bus: the frame is sent now if it is
+*  free, or by done() when the frame on it is out
+*/
+void TLC59711Async::write(void)
+{
+	if (!m_Dirty)
+	{
+		++m_Skipped;
+		return;
+	}
+	m_Dirty = false;
+
+	// the front frame is the last one started, on the wire or out
+	if (m_Shown && 0 == memcmp(m_Frames[m_Back], m_Frames[m_Back ^ 1], eFrameBytes))
+	{
+		++m_Skipped;
+		return;
+	}
+
+	core_util_critical_section_enter();
+	if (m_Busy)
+	{
+		m_Pending = true;
+	}
+	else
+	{
+		start();
+	}
+	core_util_critical_section_exit();
+}
+
+/**
+* Encode a frame into the back buffer, the last chip of the chain first
+*
+* @param [in] a_Leds - the levels of every LED, NULL for all off
+*/
+void TLC59711Async::encode(RgbLed* a_Leds)
+{
+	uint8_t* l_Out = m_Frames[m_Back];
+
+	for (int c = eChips - 1; c >= 0; c--)
+	{
+		*l_Out++ = m_Command >> 24;
+		*l_Out++ = m_Command >> 16;
+		*l_Out++ = m_Command >> 8;
+		*l_Out++ = m_Command;
+
+		// the channels go out from OUTR3 down to OUTB0, MSB first, and an
+		// 8 bit level v is v * 257 in 16 bits, the same byte twice
+		for (int i = eLedsPerChip - 1; i >= 0; i--)
+		{
+			int l_Led = c * eLedsPerChip + i;
+			uint8_t l_Red = 0;
+			uint8_t l_Green = 0;
+			uint8_t l_Blue = 0;
+
+			if (a_Leds && l_Led < RgbLed::m_NumberOfLeds)
+			{
+				l_Red = a_Leds[l_Led].getRed();
+				l_Green = a_Leds[l_Led].getGreen();
+				l_Blue = a_Leds[l_Led].getBlue();
+			}
+			*l_Out++ = l_Red;
+			*l_Out++ = l_Red;
+			*l_Out++ = l_Green;
+			*l_Out++ = l_Green;
+			*l_Out++ = l_Blue;
+			*l_Out++ = l_Blue;
+		}
+	}
+}
+
+/**
+* Put the back frame on the wire and make it the front one
+*
+* @note - called with interrupts off, or from the IRQ
+*/
+void TLC59711Async::start(void)
+{
+	uint8_t* l_Frame = m_Frames[m_Back];
+
+	m_Back ^= 1;
+	m_Busy = true;
+	m_Shown = true;
+	++m_Transfers;
+#if DEVICE_SPI_ASYNCH
+	m_Spi.transfer((const uint8_t*)l_Frame, eFrameBytes, (uint8_t*)NULL, 0, m_Done, SPI_EVENT_COMPLETE);
+#else
+	m_Spi.write((const char*)l_Frame, eFrameBytes, NULL, 0);
+	done(0);
+#endif
+}
+
+/**
+* A frame is out, start the pending one if there is one
+*
+* @note - this is called from the SPI IRQ
+*
+* @param [in] a_Event - the SPI_EVENT flags of the transfer
+*/
+void TLC59711Async::done(int a_Event)
+{
+	(void)a_Event;
+
+	if (m_Pending)
+	{
+		m_Pending = false;
+		start();
+	}
+	else
+	{
+		m_Busy = false;
+	}
+}
@@ -0,0 +1,97 @@
+/**
+* @file tlc59711_async.h
+* @brief defines the TLC59711Async class
+*
+* Copyright (c) 2016 Heads Up Display, Inc
+*/
+#ifndef __TLC59711_ASYNC__
+#define __TLC59711_ASYNC__
+
+#include "mbed.h"
+#include "rgb_led.h"
+
+/**
+* The TLC59711Async class puts RgbLed frames out on a chain of TLC59711s
+* without waiting on the SPI bus
+*
+* It has the clear(), setLeds() and write() of the TLC59711 class, so the
+* LedStateMachine drives it the same way, but write() only starts the
+* transfer: the SPI's DMA (or its interrupt) sends the frame while the
+* next tick is worked out, and done() is called from the IRQ when it is
+* out. There are two frame buffers. setLeds() encodes into the back one,
+* write() swaps them and starts the front one on the wire.
+*
+* If a transfer is still going when write() is called the new frame is
+* left pending and done() starts it. A setLeds() takes a pending frame
+* back before encoding over it, so a frame is never changed while it is
+* on the wire and the last frame written is always the one the chips end
+* up showing. Frames the same as the last one sent are not sent again,
+* so a steady step costs nothing on the bus.
+*
+* @note - the TLC59711s latch when the clock stops for 8 of its periods;
+*  starting the next transfer from the IRQ takes longer than that at the
+*  bus speeds the chips are run at
+* @note - targets without DEVICE_SPI_ASYNCH send the frame in write(),
+*  blocking, as TLC59711 did
+*/
+class TLC59711Async
+{
+public:
+	enum
+	{
+		eLedsPerChip = 4,
+		eChips = (RgbLed::m_NumberOfLeds + eLedsPerChip - 1) / eLedsPerChip,
+		eChipBytes = 4 + eLedsPerChip * 3 * 2,		// the command word and a 16 bit level per channel
+		eFrameBytes = eChips * eChipBytes
+	};
+
+	TLC59711Async(SPI& a_Spi, uint8_t a_Brightness = 0x7f);
+
+	void clear(void);
+	void setLeds(RgbLed (*a_Leds)[RgbLed::m_NumberOfLeds]);
+	void write(void);
+
+	/**
+	* Getter for the m_Busy
+	*
+	* @return - true while a frame is on the wire
+	*/
+	bool isBusy(void) const			{ return m_Busy;		}
+
+	/**
+	* Getter for the m_Transfers
+	*
+	* @return - frames started on the wire
+	*/
+	uint32_t getTransfers(void) const	{ return m_Transfers;	}
+
+	/**
+	* Getter for the m_Skipped
+	*
+	* @return - writes that were not sent, the chips already had the frame
+	*/
+	uint32_t getSkipped(void) const		{ return m_Skipped;		}
+
+protected:
+	void encode(RgbLed* a_Leds);
+	void start(void);
+	void done(int a_Event);
+
+	SPI& m_Spi;
+	uint32_t m_Command;					// the command word, with the brightness
+
+	uint8_t m_Frames[2][eFrameBytes];
+	volatile uint8_t m_Back;			// the frame setLeds() encodes into
+	volatile bool m_Busy;				// a frame is on the wire
+	volatile bool m_Pending;			// the back frame goes out when the wire is free
+	bool m_Dirty;						// the back frame has not been written yet
+	bool m_Shown;						// the front frame has been sent, the chips have it
+
+	uint32_t m_Transfers;
+	uint32_t m_Skipped;
+#if DEVICE_SPI_ASYNCH
+	event_callback_t m_Done;
+#endif
+};
+
+#endif